@@ -0,0 +1,716 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017-2024, plures
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Kernel throughput benchmark.  Sweeps functions x dtypes x layouts x sizes x
+ * thread counts and writes one record per measurement to stdout, either as
+ * CSV (default) or as JSON lines (-j).  Skipped combinations are reported
+ * on stderr.
+ *
+ * Fields:
+ *
+ *   function, dtype, layout, size, threads: the configuration
+ *   seconds:          best time of one kernel application
+ *   elements_per_sec: output elements per second
+ *   gb_per_sec:       bytes read and written per second (10^9 bytes)
+ *   efficiency:       speedup over the first thread count, divided by the
+ *                     ratio of the thread counts
+ */
+
+
+#ifndef _MSC_VER
+  #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ndtypes.h"
+#include "xnd.h"
+#include "gumath.h"
+
+
+#define MAX_ITEMS 64
+#define NSAMPLES 5
+
+static const char *default_functions = "copy,sqrt,sin,add,multiply,equal";
+static const char *default_dtypes = "int64,float32,float64";
+static const char *default_layouts = "C,F,strided,broadcast,optional,var";
+static const char *default_sizes = "1000,100000,10000000";
+static const char *default_threads = "1,2,4";
+
+enum layout { C, F, Strided, Broadcast, Optional, Var, NumLayouts };
+
+static const char *layout_names[NumLayouts] = {
+  "C", "F", "strided", "broadcast", "optional", "var"
+};
+
+
+/****************************************************************************/
+/*                              Command line                                */
+/****************************************************************************/
+
+typedef struct {
+    int n;
+    char *items[MAX_ITEMS];
+} list_t;
+
+static void
+usage(void)
+{
+    fprintf(stderr,
+        "usage: gm_bench [-f functions] [-d dtypes] [-l layouts] [-s sizes]\n"
+        "                [-t threads] [-m seconds] [-j]\n\n"
+        "  -f  comma separated function names (default: %s)\n"
+        "  -d  comma separated dtypes (default: %s)\n"
+        "  -l  comma separated layouts (default: %s)\n"
+        "  -s  comma separated number of elements (default: %s)\n"
+        "  -t  comma separated thread counts (default: %s)\n"
+        "  -m  minimum duration of a single sample (default: 0.01)\n"
+        "  -j  write JSON lines instead of CSV\n",
+        default_functions, default_dtypes, default_layouts, default_sizes,
+        default_threads);
+}
+
+/* Split a comma separated list in place. */
+static int
+split(list_t *lst, char *s)
+{
+    lst->n = 0;
+
+    while (*s != '\0') {
+        char *end = strchr(s, ',');
+        if (lst->n == MAX_ITEMS) {
+            fprintf(stderr, "gm_bench: too many list items\n");
+            return -1;
+        }
+        lst->items[lst->n++] = s;
+        if (end == NULL) {
+            break;
+        }
+        *end = '\0';
+        s = end+1;
+    }
+
+    return 0;
+}
+
+static int
+parse_int64_list(int64_t *v, list_t *lst)
+{
+    for (int i = 0; i < lst->n; i++) {
+        char *end;
+        v[i] = strtoll(lst->items[i], &end, 10);
+        if (*end != '\0' || v[i] <= 0) {
+            fprintf(stderr, "gm_bench: invalid number: '%s'\n", lst->items[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/****************************************************************************/
+/*                                 Timing                                   */
+/****************************************************************************/
+
+static double
+now(void)
+{
+#ifdef _MSC_VER
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Time 'iters' applications of the kernel. */
+static double
+run(const gm_kernel_t *kernel, const xnd_t args[], int nargs, int outer_dims,
+    int64_t nthreads, int64_t iters, ndt_context_t *ctx)
+{
+    xnd_t stack[NDT_MAX_ARGS];
+    double start = now();
+
+    for (int64_t k = 0; k < iters; k++) {
+        memcpy(stack, args, nargs * sizeof *stack);
+        if (gm_apply_thread(kernel, stack, outer_dims, nthreads, ctx) < 0) {
+            return -1;
+        }
+    }
+
+    return now() - start;
+}
+
+/* Best time of a single application. */
+static double
+measure(const gm_kernel_t *kernel, const xnd_t args[], int nargs,
+        int outer_dims, int64_t nthreads, double min_time, ndt_context_t *ctx)
+{
+    int64_t iters = 1;
+    double t, best;
+
+    for (;;) {
+        t = run(kernel, args, nargs, outer_dims, nthreads, iters, ctx);
+        if (t < 0) {
+            return -1;
+        }
+        if (t >= min_time || iters >= (INT64_C(1) << 40)) {
+            break;
+        }
+        iters = t <= 0 ? iters * 16 : (int64_t)(iters * (min_time / t) * 1.2) + 1;
+    }
+
+    best = t / (double)iters;
+    for (int i = 1; i < NSAMPLES; i++) {
+        t = run(kernel, args, nargs, outer_dims, nthreads, iters, ctx);
+        if (t < 0) {
+            return -1;
+        }
+        t /= (double)iters;
+        if (t < best) {
+            best = t;
+        }
+    }
+
+    return best;
+}
+
+
+/****************************************************************************/
+/*                                Arguments                                 */
+/****************************************************************************/
+
+typedef struct {
+    const ndt_t *type;      /* type of the allocated memory */
+    const ndt_t *view;      /* type passed to the kernel */
+    xnd_master_t *master;
+    int64_t nelem;          /* number of elements accessed */
+    int64_t nbytes;         /* number of bytes accessed */
+} arg_t;
+
+static void
+arg_clear(arg_t *a)
+{
+    if (a->master != NULL) {
+        xnd_del(a->master);
+    }
+    ndt_decref(a->view);
+    ndt_decref(a->type);
+    memset(a, 0, sizeof *a);
+}
+
+static void
+fill(char *ptr, const ndt_t *dtype, int64_t n)
+{
+    int64_t i;
+
+#define FILL(type, expr) \
+    for (i = 0; i < n; i++) {                        \
+        type _x = (type)(expr);                      \
+        memcpy(ptr + i * sizeof _x, &_x, sizeof _x); \
+    }                                                \
+    break
+
+    switch (dtype->tag) {
+    case Bool: FILL(bool, i % 2);
+    case Int8: FILL(int8_t, i % 100 + 1);
+    case Int16: FILL(int16_t, i % 100 + 1);
+    case Int32: FILL(int32_t, i % 100 + 1);
+    case Int64: FILL(int64_t, i % 100 + 1);
+    case Uint8: FILL(uint8_t, i % 100 + 1);
+    case Uint16: FILL(uint16_t, i % 100 + 1);
+    case Uint32: FILL(uint32_t, i % 100 + 1);
+    case Uint64: FILL(uint64_t, i % 100 + 1);
+    case Float32: FILL(float, 0.5 + (double)(i % 1000) / 1000);
+    case Float64: FILL(double, 0.5 + (double)(i % 1000) / 1000);
+    default:
+        memset(ptr, 0, n * dtype->datasize);
+        break;
+    }
+
+#undef FILL
+}
+
+static const ndt_t *
+var_type(const ndt_t *dtype, int64_t rows, int64_t cols, ndt_context_t *ctx)
+{
+    ndt_offsets_t *inner, *outer;
+    const ndt_t *t, *u;
+    int32_t *v;
+
+    if ((rows+1) > INT32_MAX || rows * cols > INT32_MAX) {
+        ndt_err_format(ctx, NDT_ValueError, "var dimension is too large");
+        return NULL;
+    }
+
+    inner = ndt_offsets_new((int32_t)(rows+1), ctx);
+    if (inner == NULL) {
+        return NULL;
+    }
+    v = (int32_t *)inner->v;
+    for (int64_t i = 0; i <= rows; i++) {
+        v[i] = (int32_t)(i * cols);
+    }
+
+    outer = ndt_offsets_new(2, ctx);
+    if (outer == NULL) {
+        ndt_decref_offsets(inner);
+        return NULL;
+    }
+    v = (int32_t *)outer->v;
+    v[0] = 0;
+    v[1] = (int32_t)rows;
+
+    t = ndt_var_dim(dtype, inner, 0, NULL, false, ctx);
+    ndt_decref_offsets(inner);
+    if (t == NULL) {
+        ndt_decref_offsets(outer);
+        return NULL;
+    }
+
+    u = ndt_var_dim(t, outer, 0, NULL, false, ctx);
+    ndt_decref_offsets(outer);
+    ndt_decref(t);
+
+    return u;
+}
+
+static const ndt_t *
+fixed_type(const ndt_t *dtype, int64_t rows, int64_t cols, int64_t step,
+           ndt_context_t *ctx)
+{
+    const ndt_t *t, *u;
+
+    t = ndt_fixed_dim(dtype, cols, step, ctx);
+    if (t == NULL) {
+        return NULL;
+    }
+
+    if (rows == 0) {
+        return t;
+    }
+
+    u = ndt_fixed_dim(t, rows, step == INT64_MAX ? INT64_MAX : step * cols, ctx);
+    ndt_decref(t);
+    return u;
+}
+
+/*
+ * Allocate argument 'k' of a function with 'rows x cols' elements in the
+ * given layout.
+ */
+static int
+arg_new(arg_t *a, enum layout layout, int k, const char *dtype_s,
+        int64_t rows, int64_t cols, ndt_context_t *ctx)
+{
+    const ndt_t *dtype = NULL;
+    char buf[256];
+
+    memset(a, 0, sizeof *a);
+
+    snprintf(buf, sizeof buf, "%s%s", layout == Optional ? "?" : "", dtype_s);
+    dtype = ndt_from_string(buf, ctx);
+    if (dtype == NULL) {
+        return -1;
+    }
+    if (!ndt_is_concrete(dtype) || ndt_is_abstract(dtype)) {
+        ndt_err_format(ctx, NDT_ValueError, "dtype must be concrete");
+        goto error;
+    }
+
+    a->nelem = rows * cols;
+
+    switch (layout) {
+    case C: case Optional:
+        a->type = fixed_type(dtype, rows, cols, INT64_MAX, ctx);
+        break;
+    case F: {
+        char *s = ndt_as_string(dtype, ctx);
+        if (s == NULL) {
+            goto error;
+        }
+        snprintf(buf, sizeof buf, "!%" PRIi64 " * %" PRIi64 " * %s", rows, cols, s);
+        ndt_free(s);
+        a->type = ndt_from_string(buf, ctx);
+        break;
+    }
+    case Strided:
+        /* Every other element of a (rows x 2*cols) array. */
+        a->type = fixed_type(dtype, rows, 2*cols, INT64_MAX, ctx);
+        if (a->type == NULL) {
+            goto error;
+        }
+        a->view = fixed_type(dtype, rows, cols, 2, ctx);
+        break;
+    case Broadcast:
+        /* The second argument is broadcast along the rows. */
+        if (k == 1) {
+            a->nelem = cols;
+            a->type = fixed_type(dtype, 0, cols, INT64_MAX, ctx);
+        }
+        else {
+            a->type = fixed_type(dtype, rows, cols, INT64_MAX, ctx);
+        }
+        break;
+    case Var:
+        a->type = var_type(dtype, rows, cols, ctx);
+        break;
+    default:
+        ndt_err_format(ctx, NDT_RuntimeError, "invalid layout");
+        goto error;
+    }
+
+    if (a->type == NULL || (layout == Strided && a->view == NULL)) {
+        goto error;
+    }
+    if (a->view == NULL) {
+        ndt_incref(a->type);
+        a->view = a->type;
+    }
+
+    a->master = xnd_empty_from_type(a->type, XND_OWN_EMBEDDED, ctx);
+    if (a->master == NULL) {
+        goto error;
+    }
+
+    fill(a->master->master.ptr, ndt_dtype(a->type),
+         a->type->datasize / ndt_dtype(a->type)->datasize);
+
+    a->nbytes = a->nelem * dtype->datasize;
+    if (layout == Optional) {
+        /* All values are valid. */
+        const int64_t nbytes = (a->nelem + 7) / 8;
+        memset(a->master->master.bitmap.data, 0xff, nbytes);
+        a->nbytes += nbytes;
+    }
+
+    ndt_decref(dtype);
+    return 0;
+
+error:
+    ndt_decref(dtype);
+    arg_clear(a);
+    return -1;
+}
+
+
+/****************************************************************************/
+/*                                Benchmark                                 */
+/****************************************************************************/
+
+static void
+print_record(bool json, const char *func, const char *dtype, enum layout layout,
+             int64_t size, int64_t nthreads, double seconds, int64_t nelem,
+             int64_t nbytes, double efficiency)
+{
+    const double eps = (double)nelem / seconds;
+    const double gbps = (double)nbytes / seconds * 1e-9;
+
+    if (json) {
+        printf("{\"function\": \"%s\", \"dtype\": \"%s\", \"layout\": \"%s\", "
+               "\"size\": %" PRIi64 ", \"threads\": %" PRIi64 ", "
+               "\"seconds\": %.6e, \"elements_per_sec\": %.6e, "
+               "\"gb_per_sec\": %.4f, \"efficiency\": ",
+               func, dtype, layout_names[layout], size, nthreads, seconds,
+               eps, gbps);
+        if (efficiency < 0) {
+            printf("null}\n");
+        }
+        else {
+            printf("%.4f}\n", efficiency);
+        }
+    }
+    else {
+        printf("%s,%s,%s,%" PRIi64 ",%" PRIi64 ",%.6e,%.6e,%.4f,",
+               func, dtype, layout_names[layout], size, nthreads, seconds,
+               eps, gbps);
+        if (efficiency >= 0) {
+            printf("%.4f", efficiency);
+        }
+        printf("\n");
+    }
+
+    fflush(stdout);
+}
+
+static void
+skip(const char *func, const char *dtype, enum layout layout, int64_t size,
+     ndt_context_t *ctx)
+{
+    fprintf(stderr, "skip: %s,%s,%s,%" PRIi64 ": %s\n", func, dtype,
+            layout_names[layout], size, ndt_context_msg(ctx));
+    ndt_err_clear(ctx);
+}
+
+static int
+bench(const gm_tbl_t *tbl, const char *func, const char *dtype,
+      enum layout layout, int64_t size, const int64_t *threads, int nthreads,
+      double min_time, bool json, ndt_context_t *ctx)
+{
+    arg_t args[NDT_MAX_ARGS];
+    const ndt_t *types[NDT_MAX_ARGS];
+    int64_t li[NDT_MAX_ARGS] = {0};
+    xnd_master_t *out[NDT_MAX_ARGS] = {NULL};
+    xnd_t stack[NDT_MAX_ARGS];
+    ndt_apply_spec_t spec = ndt_apply_spec_empty;
+    const gm_func_t *f;
+    gm_kernel_t kernel;
+    int64_t rows, cols, nbytes, nelem;
+    double base = -1;
+    int nin, i;
+
+    f = gm_tbl_find(tbl, func, ctx);
+    if (f == NULL) {
+        return -1;
+    }
+    if (f->nkernels == 0) {
+        return 0;
+    }
+
+    nin = (int)f->kernels[0].sig->Function.nin;
+    if (layout == Broadcast && nin != 2) {
+        return 0;
+    }
+
+    /* Two-dimensional to distinguish C and Fortran order. */
+    cols = size < 1024 ? size : 1024;
+    rows = size / cols;
+
+    for (i = 0; i < nin; i++) {
+        if (arg_new(&args[i], layout, i, dtype, rows, cols, ctx) < 0) {
+            for (int k = 0; k < i; k++) {
+                arg_clear(&args[k]);
+            }
+            skip(func, dtype, layout, size, ctx);
+            return 0;
+        }
+        types[i] = args[i].view;
+    }
+
+    kernel = gm_select(&spec, tbl, func, types, li, nin, 0, false, NULL, ctx);
+    if (kernel.set == NULL) {
+        skip(func, dtype, layout, size, ctx);
+        goto out;
+    }
+
+    nbytes = 0;
+    for (i = 0; i < nin; i++) {
+        stack[i] = args[i].master->master;
+        stack[i].type = spec.types[i];
+        nbytes += args[i].nbytes;
+    }
+
+    nelem = rows * cols;
+    for (i = 0; i < spec.nout; i++) {
+        const ndt_t *t = spec.types[nin+i];
+        out[i] = xnd_empty_from_type(t, XND_OWN_EMBEDDED, ctx);
+        if (out[i] == NULL) {
+            skip(func, dtype, layout, size, ctx);
+            goto out;
+        }
+        stack[nin+i] = out[i]->master;
+        nbytes += nelem * ndt_dtype(t)->datasize;
+        if (ndt_is_optional(ndt_dtype(t))) {
+            nbytes += (nelem + 7) / 8;
+        }
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        double t = measure(&kernel, stack, spec.nargs, spec.outer_dims,
+                           threads[i], min_time, ctx);
+        if (t < 0) {
+            skip(func, dtype, layout, size, ctx);
+            goto out;
+        }
+
+        if (i == 0) {
+            base = t;
+        }
+
+        print_record(json, func, dtype, layout, size, threads[i], t, nelem,
+                     nbytes, i == 0 ? 1.0 : (base / t) * threads[0] / threads[i]);
+    }
+
+out:
+    for (i = 0; i < spec.nout; i++) {
+        if (out[i] != NULL) {
+            xnd_del(out[i]);
+        }
+    }
+    ndt_apply_spec_clear(&spec);
+    for (i = 0; i < nin; i++) {
+        arg_clear(&args[i]);
+    }
+
+    return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    NDT_STATIC_CONTEXT(ctx);
+    char *functions_s = NULL, *dtypes_s = NULL, *layouts_s = NULL;
+    char *sizes_s = NULL, *threads_s = NULL;
+    list_t functions, dtypes, layouts, sizes_l, threads_l;
+    enum layout layout_v[MAX_ITEMS];
+    int64_t sizes[MAX_ITEMS];
+    int64_t threads[MAX_ITEMS];
+    double min_time = 0.01;
+    bool json = false;
+    gm_tbl_t *tbl = NULL;
+    int ret = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        char **dest = NULL;
+
+        if (strcmp(opt, "-j") == 0) {
+            json = true;
+            continue;
+        }
+        if (strcmp(opt, "-h") == 0) {
+            usage();
+            return 0;
+        }
+        if (i+1 == argc) {
+            usage();
+            return 1;
+        }
+
+        if (strcmp(opt, "-f") == 0) dest = &functions_s;
+        else if (strcmp(opt, "-d") == 0) dest = &dtypes_s;
+        else if (strcmp(opt, "-l") == 0) dest = &layouts_s;
+        else if (strcmp(opt, "-s") == 0) dest = &sizes_s;
+        else if (strcmp(opt, "-t") == 0) dest = &threads_s;
+        else if (strcmp(opt, "-m") == 0) {
+            min_time = strtod(argv[++i], NULL);
+            if (min_time <= 0) {
+                usage();
+                return 1;
+            }
+            continue;
+        }
+        else {
+            usage();
+            return 1;
+        }
+
+        *dest = argv[++i];
+    }
+
+    functions_s = strdup(functions_s ? functions_s : default_functions);
+    dtypes_s = strdup(dtypes_s ? dtypes_s : default_dtypes);
+    layouts_s = strdup(layouts_s ? layouts_s : default_layouts);
+    sizes_s = strdup(sizes_s ? sizes_s : default_sizes);
+    threads_s = strdup(threads_s ? threads_s : default_threads);
+    if (!functions_s || !dtypes_s || !layouts_s || !sizes_s || !threads_s) {
+        fprintf(stderr, "gm_bench: out of memory\n");
+        goto finish;
+    }
+
+    if (split(&functions, functions_s) < 0 || split(&dtypes, dtypes_s) < 0 ||
+        split(&layouts, layouts_s) < 0 || split(&sizes_l, sizes_s) < 0 ||
+        split(&threads_l, threads_s) < 0 ||
+        parse_int64_list(sizes, &sizes_l) < 0 ||
+        parse_int64_list(threads, &threads_l) < 0) {
+        goto finish;
+    }
+
+    for (int i = 0; i < layouts.n; i++) {
+        int k;
+        for (k = 0; k < NumLayouts; k++) {
+            if (strcmp(layouts.items[i], layout_names[k]) == 0) {
+                break;
+            }
+        }
+        if (k == NumLayouts) {
+            fprintf(stderr, "gm_bench: invalid layout: '%s'\n", layouts.items[i]);
+            goto finish;
+        }
+        layout_v[i] = (enum layout)k;
+    }
+
+    if (ndt_init(&ctx) < 0 || xnd_init_float(&ctx) < 0) {
+        ndt_err_fprint(stderr, &ctx);
+        goto finish;
+    }
+    gm_init();
+
+    tbl = gm_tbl_new(&ctx);
+    if (tbl == NULL ||
+        gm_init_cpu_unary_kernels(tbl, &ctx) < 0 ||
+        gm_init_cpu_binary_kernels(tbl, &ctx) < 0) {
+        ndt_err_fprint(stderr, &ctx);
+        goto finish;
+    }
+
+    if (json == false) {
+        printf("function,dtype,layout,size,threads,seconds,elements_per_sec,"
+               "gb_per_sec,efficiency\n");
+    }
+
+    for (int i = 0; i < functions.n; i++)
+    for (int j = 0; j < dtypes.n; j++)
+    for (int k = 0; k < layouts.n; k++)
+    for (int l = 0; l < sizes_l.n; l++) {
+        if (bench(tbl, functions.items[i], dtypes.items[j], layout_v[k],
+                  sizes[l], threads, threads_l.n, min_time, json, &ctx) < 0) {
+            ndt_err_fprint(stderr, &ctx);
+            goto finish;
+        }
+    }
+
+    ret = 0;
+
+finish:
+    if (tbl != NULL) {
+        gm_tbl_del(tbl);
+    }
+    ndt_finalize();
+    free(functions_s);
+    free(dtypes_s);
+    free(layouts_s);
+    free(sizes_s);
+    free(threads_s);
+    return ret;
+}
@@ -38,6 +38,9 @@
 #include <ndtypes.h>
 #include <xnd.h>
 #include <gumath.h>
+#include "lookup.h"
+#include "stats.h"
+#include "trace.h"
 
 
 /* flags that apply to all arguments */
@@ -63,6 +66,29 @@
 #define REQ_INNER_X(flags) ((flags&INNER_X) == INNER_X)
 
 
+/* Cache budget for blocked loops; 0 disables blocking. */
+static int64_t gm_block_cache_size = GM_BLOCK_CACHE_SIZE;
+
+int64_t
+gm_get_block_cache_size(void)
+{
+    return gm_block_cache_size;
+}
+
+int
+gm_set_block_cache_size(int64_t size, ndt_context_t *ctx)
+{
+    if (size < 0) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "block cache size must be greater than or equal to 0");
+        return -1;
+    }
+
+    gm_block_cache_size = size;
+    return 0;
+}
+
+
 static int
 sum_inner_dimensions(const xnd_t stack[], int nargs, int outer_dims)
 {
@@ -90,9 +116,9 @@ opt_safe(int outer, ndt_context_t *ctx)
     return true;
 }
 
-int
-gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
-         ndt_context_t *ctx)
+static int
+_gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
+          ndt_context_t *ctx)
 {
     const int nargs = (int)kernel->set->sig->Function.nargs;
 
@@ -118,6 +144,11 @@ gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
             return -1;
         }
 
+        if (kernel->block > 0) {
+            return gm_xnd_map_blocked(kernel->set->OptS, stack, nargs,
+                                      outer_dims, kernel->block, ctx);
+        }
+
         return gm_xnd_map(kernel->set->OptS, stack, nargs, outer_dims-1, ctx);
     }
 
@@ -158,47 +189,256 @@ gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
     return -1;
 }
 
+/*
+ * Apply the kernel with the outer dimensions visited in the order chosen by
+ * ndt_select_kernel_strategy().  The permuted types describe the same memory,
+ * so only the types on the stack are replaced.
+ */
+static int
+apply_ordered(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
+              ndt_context_t *ctx)
+{
+    const int nargs = (int)kernel->set->sig->Function.nargs;
+    ALLOCA(xnd_t, permuted, nargs);
+    int p[NDT_MAX_DIM];
+    int i, k, ret;
+
+    if (kernel->nperm == 0) {
+        return _gm_apply(kernel, stack, outer_dims, ctx);
+    }
+
+    if (kernel->nperm != outer_dims) {
+        ndt_err_format(ctx, NDT_RuntimeError,
+            "internal error: loop order does not match outer dimensions");
+        return -1;
+    }
+
+    for (i = 0; i < nargs; i++) {
+        const ndt_t *t = stack[i].type;
+
+        for (k = 0; k < outer_dims; k++) {
+            p[k] = kernel->perm[k];
+        }
+        for (k = outer_dims; k < t->ndim; k++) {
+            p[k] = k;
+        }
+
+        permuted[i] = stack[i];
+        permuted[i].type = ndt_transpose(t, p, t->ndim, ctx);
+        if (permuted[i].type == NULL) {
+            for (k = 0; k < i; k++) {
+                ndt_decref(permuted[k].type);
+            }
+            return -1;
+        }
+    }
+
+    ret = _gm_apply(kernel, permuted, outer_dims, ctx);
+
+    for (i = 0; i < nargs; i++) {
+        ndt_decref(permuted[i].type);
+    }
+
+    return ret;
+}
+
+int
+gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
+         ndt_context_t *ctx)
+{
+    const bool stats = gm_stats_active() && kernel->stats != NULL;
+    const bool trace = gm_trace_enabled() && kernel->name != NULL;
+    int64_t start = 0;
+    int ret;
+
+    if (!stats && !trace) {
+        return apply_ordered(kernel, stack, outer_dims, ctx);
+    }
+
+    if (trace) {
+        gm_trace_apply(GM_TRACE_APPLY, kernel, stack, -1, true, 0);
+    }
+    if (stats) {
+        start = gm_stats_now();
+    }
+
+    ret = apply_ordered(kernel, stack, outer_dims, ctx);
+
+    if (stats) {
+        gm_stats_apply(kernel, stack, start, false);
+    }
+    if (trace) {
+        gm_trace_apply(GM_TRACE_APPLY, kernel, stack, -1, false, ret);
+    }
+
+    return ret;
+}
+
+/* Statistics slot of a selected kernel. */
+int
+gm_kernel_slot(const gm_kernel_t *kernel)
+{
+    switch (kernel->flag) {
+    case OPT_C: return GM_SLOT_OPTC;
+    case OPT_Z: return GM_SLOT_OPTZ;
+    case OPT_S: return GM_SLOT_OPTS;
+    case INNER_C: return GM_SLOT_C;
+    case INNER_F: return GM_SLOT_FORTRAN;
+    case INNER_S: return GM_SLOT_STRIDED;
+    case INNER_X: return GM_SLOT_XND;
+    default: return -1;
+    }
+}
+
+/*
+ * Return the tile size for a blocked OptS loop or 0 if blocking does not
+ * pay off.  Blocking is used for elementwise kernels when the innermost loop
+ * is contiguous for some arguments while others are contiguous in the next
+ * dimension, i.e. in the typical add(a, b.T) case.  The tile size is chosen
+ * such that one tile of every argument fits into the cache budget.  If not
+ * even the smallest tile fits, blocking is not used.
+ */
+static int64_t
+select_block(const ndt_apply_spec_t *spec, ndt_context_t *ctx)
+{
+    const int outer = spec->outer_dims;
+    const int64_t cache_size = gm_block_cache_size;
+    const int last = spec->nperm ? spec->perm[outer-1] : outer-1;
+    const int prev = spec->nperm ? spec->perm[outer-2] : outer-2;
+    bool inner_unit = false, outer_unit = false;
+    int64_t itemsize = 1;
+    int64_t block = 0;
+    ndt_ndarray_t x;
+    uint32_t probe;
+    int ret;
+
+    if (cache_size == 0 || outer < 2 || spec->nargs == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < spec->nargs; i++) {
+        probe = ndt_probe_begin(ctx);
+        ret = ndt_as_ndarray(&x, spec->types[i], ctx);
+        ndt_probe_end(ctx, probe);
+        if (ret < 0) {
+            ndt_err_clear(ctx);
+            return 0;
+        }
+        if (x.ndim != outer) {
+            return 0;
+        }
+
+        if (x.steps[last] == 1 || x.steps[last] == -1) {
+            inner_unit = true;
+        }
+        else if (x.steps[prev] == 1 || x.steps[prev] == -1) {
+            outer_unit = true;
+        }
+
+        if (x.itemsize > itemsize) {
+            itemsize = x.itemsize;
+        }
+    }
+
+    if (!inner_unit || !outer_unit) {
+        return 0;
+    }
+
+    /* Largest power-of-two tile in [8, 1024] with nargs tiles in the budget. */
+    for (int64_t b = 8; b <= 1024; b *= 2) {
+        if (b * b * itemsize * spec->nargs > cache_size) {
+            break;
+        }
+        block = b;
+    }
+
+    if (block == 0 || (x.shape[last] <= block && x.shape[prev] <= block)) {
+        return 0;
+    }
+
+    return block;
+}
+
+/*
+ * Select the fastest kernel slot for the layout in 'spec'.  If a slower slot
+ * is chosen, 'reason' is set to GM_REASON_MISSING if a faster slot would have
+ * been possible for the layout but is not implemented, to GM_REASON_LAYOUT
+ * otherwise.
+ */
 static gm_kernel_t
 select_kernel(const ndt_apply_spec_t *spec, const gm_kernel_set_t *set,
-              ndt_context_t *ctx)
+              int *reason, ndt_context_t *ctx)
 {
-    gm_kernel_t kernel = {0U, NULL};
+    gm_kernel_t kernel;
+    bool missing = false;
 
+    /* The loop order is only copied if present. */
+    kernel.flag = 0U;
     kernel.set = set;
+    kernel.nperm = spec->nperm;
+    if (spec->nperm > 0) {
+        memcpy(kernel.perm, spec->perm, spec->nperm);
+    }
+    kernel.block = 0;
+    kernel.stats = NULL;
+    kernel.name = NULL;
 
-    if (REQ_LOOP_C(spec->flags) && set->OptC != NULL) {
-        kernel.flag = OPT_C;
-        return kernel;
+    *reason = -1;
+
+    if (REQ_LOOP_C(spec->flags)) {
+        if (set->OptC != NULL) {
+            kernel.flag = OPT_C;
+            return kernel;
+        }
+        missing = true;
     }
 
-    if (REQ_LOOP_Z(spec->flags) && set->OptZ != NULL) {
-        kernel.flag = OPT_Z;
-        return kernel;
+    *reason = GM_REASON_LAYOUT;
+
+    if (REQ_LOOP_Z(spec->flags)) {
+        if (set->OptZ != NULL) {
+            kernel.flag = OPT_Z;
+            goto slower;
+        }
+        missing = true;
     }
 
-    if (REQ_LOOP_S(spec->flags) && set->OptS != NULL) {
-        kernel.flag = OPT_S;
-        return kernel;
+    if (REQ_LOOP_S(spec->flags)) {
+        if (set->OptS != NULL) {
+            kernel.flag = OPT_S;
+            kernel.block = select_block(spec, ctx);
+            goto slower;
+        }
+        missing = true;
     }
 
-    if (REQ_INNER_C(spec->flags) && set->C != NULL) {
-        kernel.flag = INNER_C;
-        return kernel;
+    if (REQ_INNER_C(spec->flags)) {
+        if (set->C != NULL) {
+            kernel.flag = INNER_C;
+            goto slower;
+        }
+        missing = true;
     }
 
-    if (REQ_INNER_F(spec->flags) && set->Fortran != NULL) {
-        kernel.flag = INNER_F;
-        return kernel;
+    if (REQ_INNER_F(spec->flags)) {
+        if (set->Fortran != NULL) {
+            kernel.flag = INNER_F;
+            goto slower;
+        }
+        missing = true;
     }
 
-    if (REQ_INNER_S(spec->flags) && set->Strided != NULL) {
-        kernel.flag = INNER_S;
-        return kernel;
+    if (REQ_INNER_S(spec->flags)) {
+        if (set->Strided != NULL) {
+            kernel.flag = INNER_S;
+            goto slower;
+        }
+        missing = true;
     }
 
     if (REQ_INNER_X(spec->flags) && set->Xnd != NULL) {
         kernel.flag = INNER_X;
-        return kernel;
+        goto slower;
     }
 
     kernel.set = NULL;
@@ -214,16 +454,25 @@ select_kernel(const ndt_apply_spec_t *spec, const gm_kernel_set_t *set,
         set->Strided ? "Strided" : "_");
 
     return kernel;
+
+slower:
+    if (missing) {
+        *reason = GM_REASON_MISSING;
+    }
+    return kernel;
 }
 
-/* Look up a multimethod by name and select a kernel. */
-gm_kernel_t
-gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const char *name,
-          const ndt_t *types[], const int64_t li[], int nin, int nout,
-          bool check_broadcast, const xnd_t args[], ndt_context_t *ctx)
+static gm_kernel_t
+_gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const char *name,
+           const ndt_t *types[], const int64_t li[], int nin, int nout,
+           bool check_broadcast, const xnd_t args[], ndt_context_t *ctx)
 {
-    gm_kernel_t empty_kernel = {0U, NULL};
+    static const gm_kernel_t empty_kernel = {0U, NULL, 0, {0}, 0, NULL, NULL};
+    const gm_kernel_set_t *set = NULL;
     const gm_func_t *f;
+    gm_kernel_t kernel;
+    int64_t start = 0, mid = 0;
+    int reason;
     char *s;
     int i;
 
@@ -232,24 +481,59 @@ gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const char *name,
         return empty_kernel;
     }
 
+    const bool stats = gm_stats_active() && f->stats != NULL;
+    if (stats) {
+        start = gm_stats_now();
+    }
+
     if (f->typecheck != NULL) {
-        const gm_kernel_set_t *set = f->typecheck(spec, f, types, li, nin, nout,
-                                                  check_broadcast, ctx);
+        set = f->typecheck(spec, f, types, li, nin, nout, check_broadcast, ctx);
         if (set == NULL) {
+            if (stats) {
+                gm_stats_select(f->stats, gm_stats_now()-start, 0,
+                                GM_REASON_NO_MATCH);
+            }
             return empty_kernel;
         }
-        return select_kernel(spec, set, ctx);
     }
+    else {
+        /* Rejected candidates are expected, their messages are never used. */
+        const uint32_t probe = ndt_probe_begin(ctx);
+        gm_lookup_iter_t it;
+
+        gm_lookup_iter_init(&it, f->lookup, types, nin);
+        while ((i = gm_lookup_next(&it)) >= 0) {
+            if (ndt_matcher_typecheck(spec, f->kernels[i].matcher, types, li,
+                                      nin, nout, check_broadcast,
+                                      f->kernels[i].constraint, args, ctx) < 0) {
+                ndt_err_clear(ctx);
+                continue;
+            }
+            set = &f->kernels[i];
+            break;
+        }
 
-    for (i = 0; i < f->nkernels; i++) {
-        const gm_kernel_set_t *set = &f->kernels[i];
-        if (ndt_typecheck(spec, set->sig, types, li, nin, nout,
-                          check_broadcast, set->constraint, args,
-                          ctx) < 0) {
-            ndt_err_clear(ctx);
-            continue;
+        ndt_probe_end(ctx, probe);
+    }
+
+    if (set != NULL) {
+        if (stats) {
+            mid = gm_stats_now();
+        }
+
+        kernel = select_kernel(spec, set, &reason, ctx);
+        kernel.stats = f->stats;
+        kernel.name = f->name;
+
+        if (stats && kernel.set != NULL) {
+            gm_stats_select(f->stats, mid-start, gm_stats_now()-mid, reason);
         }
-        return select_kernel(spec, set, ctx);
+
+        return kernel;
+    }
+
+    if (stats) {
+        gm_stats_select(f->stats, gm_stats_now()-start, 0, GM_REASON_NO_MATCH);
     }
 
     s = ndt_list_as_string(types, nin, ctx);
@@ -263,3 +547,25 @@ gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const char *name,
 
     return empty_kernel;
 }
+
+/* Look up a multimethod by name and select a kernel. */
+gm_kernel_t
+gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const char *name,
+          const ndt_t *types[], const int64_t li[], int nin, int nout,
+          bool check_broadcast, const xnd_t args[], ndt_context_t *ctx)
+{
+    gm_kernel_t kernel;
+
+    if (!gm_trace_enabled()) {
+        return _gm_select(spec, tbl, name, types, li, nin, nout,
+                          check_broadcast, args, ctx);
+    }
+
+    gm_trace_select(name, types, nin, NULL, true, 0);
+    kernel = _gm_select(spec, tbl, name, types, li, nin, nout,
+                        check_broadcast, args, ctx);
+    gm_trace_select(name, types, nin, &kernel, false,
+                    kernel.set == NULL ? -1 : 0);
+
+    return kernel;
+}
@@ -40,6 +40,7 @@
 #include <assert.h>
 #include <ndtypes.h>
 #include <gumath.h>
+#include "lookup.h"
 
 
 /******************************************************************************/
@@ -64,16 +65,38 @@ gm_func_new(const char *name, ndt_context_t *ctx)
     f->typecheck = NULL;
     f->nkernels = 0;
 
+    f->stats = ndt_calloc(1, sizeof *f->stats);
+    if (f->stats == NULL) {
+        ndt_free(f->name);
+        ndt_free(f);
+        return ndt_memory_error(ctx);
+    }
+
+    f->lookup = gm_lookup_new(ctx);
+    if (f->lookup == NULL) {
+        ndt_free(f->stats);
+        ndt_free(f->name);
+        ndt_free(f);
+        return NULL;
+    }
+
     return f;
 }
 
 void
 gm_func_del(gm_func_t *f)
 {
+    if (f == NULL) {
+        return;
+    }
+
     ndt_free(f->name);
+    ndt_free(f->stats);
+    gm_lookup_del(f->lookup);
 
     for (int i = 0; i < f->nkernels; i++) {
         ndt_decref(f->kernels[i].sig);
+        ndt_matcher_del(f->kernels[i].matcher);
     }
 
     ndt_free(f);
@@ -96,21 +119,17 @@ gm_add_func(gm_tbl_t *tbl, const char *name, ndt_context_t *ctx)
     return f;
 }
 
-int
-gm_add_kernel(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx)
+/*
+ * Append a kernel set to 'f'.  Functions with a custom typecheck never use
+ * the matchers or the lookup index, so these are only built for functions
+ * that are dispatched by gm_select() itself.
+ */
+static int
+add_kernel(gm_func_t *f, const gm_kernel_init_t *k, ndt_context_t *ctx)
 {
-    gm_func_t *f = gm_tbl_find(tbl, k->name, ctx);
     gm_kernel_set_t kernel;
     const ndt_t *t;
 
-    if (f == NULL) {
-        ndt_err_clear(ctx);
-        f = gm_add_func(tbl, k->name, ctx);
-        if (f == NULL) {
-            return -1;
-        }
-    }
-
     t = ndt_from_string_v(k->sig, ctx);
     if (t == NULL) {
         return -1;
@@ -123,6 +142,21 @@ gm_add_kernel(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx)
         return -1;
     }
 
+    kernel.matcher = NULL;
+    if (f->typecheck == NULL) {
+        kernel.matcher = ndt_matcher_new(t, ctx);
+        if (kernel.matcher == NULL) {
+            ndt_decref(t);
+            return -1;
+        }
+
+        if (gm_lookup_add(f->lookup, f->nkernels, t, ctx) < 0) {
+            ndt_matcher_del(kernel.matcher);
+            ndt_decref(t);
+            return -1;
+        }
+    }
+
     kernel.sig = t;
     kernel.constraint = k->constraint;
     kernel.OptC = k->OptC;
@@ -138,44 +172,39 @@ gm_add_kernel(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx)
 }
 
 int
-gm_add_kernel_typecheck(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx,
-                        gm_typecheck_t typecheck)
+gm_add_kernel(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx)
 {
+    const uint32_t probe = ndt_probe_begin(ctx);
     gm_func_t *f = gm_tbl_find(tbl, k->name, ctx);
-    gm_kernel_set_t kernel;
-    const ndt_t *t;
 
+    ndt_probe_end(ctx, probe);
     if (f == NULL) {
         ndt_err_clear(ctx);
         f = gm_add_func(tbl, k->name, ctx);
         if (f == NULL) {
             return -1;
         }
-        f->typecheck = typecheck;
     }
 
-    t = ndt_from_string_v(k->sig, ctx);
-    if (t == NULL) {
-        return -1;
-    }
+    return add_kernel(f, k, ctx);
+}
 
-    if (f->nkernels == GM_MAX_KERNELS) {
-        ndt_decref(t);
-        ndt_err_format(ctx, NDT_RuntimeError,
-            "%s: maximum number of kernels reached for", f->name);
-        return -1;
-    }
+int
+gm_add_kernel_typecheck(gm_tbl_t *tbl, const gm_kernel_init_t *k, ndt_context_t *ctx,
+                        gm_typecheck_t typecheck)
+{
+    const uint32_t probe = ndt_probe_begin(ctx);
+    gm_func_t *f = gm_tbl_find(tbl, k->name, ctx);
 
-    kernel.sig = t;
-    kernel.constraint = k->constraint;
-    kernel.OptC = k->OptC;
-    kernel.OptZ = k->OptZ;
-    kernel.OptS = k->OptS;
-    kernel.C = k->C;
-    kernel.Fortran = k->Fortran;
-    kernel.Xnd = k->Xnd;
-    kernel.Strided = k->Strided;
+    ndt_probe_end(ctx, probe);
+    if (f == NULL) {
+        ndt_err_clear(ctx);
+        f = gm_add_func(tbl, k->name, ctx);
+        if (f == NULL) {
+            return -1;
+        }
+        f->typecheck = typecheck;
+    }
 
-    f->kernels[f->nkernels++] = kernel;
-    return 0;
+    return add_kernel(f, k, ctx);
 }
@@ -0,0 +1,586 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+
+
+/****************************************************************************/
+/*                       Fused elementwise expressions                      */
+/****************************************************************************/
+
+/*
+ * A fused expression is a list of elementwise gufunc applications.  Slots
+ * 0..nin-1 are the inputs, slot nin+k is the result of operation k and the
+ * result of the last operation is the output.
+ *
+ * The expression is evaluated in chunks along the innermost dimension.
+ * Intermediate results are kept in chunk-sized buffers, so no temporaries
+ * of the size of the output are allocated and every input is read once.
+ */
+
+typedef struct {
+    char *name;
+    int nargs;
+    int args[GM_FUSE_MAX_OP_ARGS];
+} fuse_op_t;
+
+struct _gm_fuse {
+    const gm_tbl_t *tbl;
+    int nin;
+    int nops;
+    fuse_op_t ops[GM_FUSE_MAX_OPS];
+};
+
+typedef struct {
+    int64_t step;       /* step in the chunked dimension */
+    const ndt_t *dtype; /* owned */
+    const ndt_t *row;   /* 1D type of a full chunk, owned */
+    const ndt_t *tail;  /* 1D type of the last partial chunk, owned or NULL */
+    char *buf;          /* chunk buffer for intermediate results */
+} fuse_slot_t;
+
+typedef struct {
+    const gm_fuse_t *f;
+    fuse_slot_t *slots;
+    gm_kernel_t *kernels;
+    int64_t n;          /* length of the chunked dimension */
+    int64_t chunk;      /* chunk length */
+} fuse_state_t;
+
+
+gm_fuse_t *
+gm_fuse_new(const gm_tbl_t *tbl, int nin, ndt_context_t *ctx)
+{
+    gm_fuse_t *f;
+
+    if (nin < 0 || nin >= NDT_MAX_ARGS) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "number of fused inputs must be in [0, %d]", NDT_MAX_ARGS-1);
+        return NULL;
+    }
+
+    f = ndt_calloc(1, sizeof *f);
+    if (f == NULL) {
+        return ndt_memory_error(ctx);
+    }
+
+    f->tbl = tbl;
+    f->nin = nin;
+    f->nops = 0;
+
+    return f;
+}
+
+void
+gm_fuse_del(gm_fuse_t *f)
+{
+    if (f == NULL) {
+        return;
+    }
+
+    for (int k = 0; k < f->nops; k++) {
+        ndt_free(f->ops[k].name);
+    }
+
+    ndt_free(f);
+}
+
+/* Append an operation and return the slot of its result. */
+int
+gm_fuse_add(gm_fuse_t *f, const char *name, const int args[], int nargs,
+            ndt_context_t *ctx)
+{
+    const int nslots = f->nin + f->nops;
+    fuse_op_t *op;
+
+    if (f->nops == GM_FUSE_MAX_OPS || nslots+1 >= NDT_MAX_ARGS) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "fused expression has too many operations");
+        return -1;
+    }
+
+    if (nargs < 1 || nargs > GM_FUSE_MAX_OP_ARGS) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "fused operation must have between 1 and %d arguments",
+            GM_FUSE_MAX_OP_ARGS);
+        return -1;
+    }
+
+    for (int i = 0; i < nargs; i++) {
+        if (args[i] < 0 || args[i] >= nslots) {
+            ndt_err_format(ctx, NDT_ValueError,
+                "fused operation argument %d out of range", args[i]);
+            return -1;
+        }
+    }
+
+    if (gm_tbl_find(f->tbl, name, ctx) == NULL) {
+        return -1;
+    }
+
+    op = &f->ops[f->nops];
+    op->name = ndt_strdup(name, ctx);
+    if (op->name == NULL) {
+        return -1;
+    }
+
+    op->nargs = nargs;
+    for (int i = 0; i < nargs; i++) {
+        op->args[i] = args[i];
+    }
+
+    f->nops++;
+
+    return nslots;
+}
+
+/*
+ * Select the kernel for operation k.  For nout == 0 the result type is
+ * inferred (the caller provides a contiguous buffer), for nout == 1 the
+ * last entry of 'types' is the type of the output chunk.
+ */
+static int
+select_op(gm_kernel_t *kernel, const ndt_t **dtype, const gm_fuse_t *f,
+          int k, const ndt_t *types[], int nout, ndt_context_t *ctx)
+{
+    const fuse_op_t *op = &f->ops[k];
+    ndt_apply_spec_t spec = ndt_apply_spec_empty;
+    int64_t li[GM_FUSE_MAX_OP_ARGS+1] = {0};
+    const ndt_t *t;
+
+    *kernel = gm_select(&spec, f->tbl, op->name, types, li, op->nargs, nout,
+                        false, NULL, ctx);
+    if (kernel->set == NULL) {
+        return -1;
+    }
+
+    if (spec.nout != 1 || spec.outer_dims != 1 ||
+        spec.types[op->nargs]->ndim != 1) {
+        ndt_err_format(ctx, NDT_TypeError,
+            "function '%s' cannot be fused: not an elementwise function with "
+            "a single return value", op->name);
+        ndt_apply_spec_clear(&spec);
+        return -1;
+    }
+
+    t = ndt_dtype(spec.types[op->nargs]);
+    if (ndt_is_optional(t)) {
+        ndt_err_format(ctx, NDT_NotImplementedError,
+            "fused expressions do not support optional dtypes");
+        ndt_apply_spec_clear(&spec);
+        return -1;
+    }
+
+    ndt_incref(t);
+    *dtype = t;
+    ndt_apply_spec_clear(&spec);
+
+    return 0;
+}
+
+const ndt_t *
+gm_fuse_typecheck(const gm_fuse_t *f, const ndt_t *types[], ndt_context_t *ctx)
+{
+    const int nslots = f->nin + f->nops;
+    const ndt_t **dtypes;
+    const ndt_t **rows;
+    const ndt_t *shape = NULL;
+    const ndt_t *res = NULL;
+    gm_kernel_t kernel;
+    int i, k;
+
+    if (f->nops == 0) {
+        ndt_err_format(ctx, NDT_ValueError, "fused expression is empty");
+        return NULL;
+    }
+
+    dtypes = ndt_calloc(nslots, sizeof *dtypes);
+    rows = ndt_calloc(nslots, sizeof *rows);
+    if (dtypes == NULL || rows == NULL) {
+        (void)ndt_memory_error(ctx);
+        goto out;
+    }
+
+    for (i = 0; i < f->nin; i++) {
+        if (!ndt_is_ndarray(types[i]) || ndt_is_abstract(types[i])) {
+            ndt_err_format(ctx, NDT_TypeError,
+                "fused expressions require concrete ndarray arguments");
+            goto out;
+        }
+        if (shape == NULL && types[i]->ndim > 0) {
+            shape = types[i];
+        }
+
+        dtypes[i] = ndt_dtype(types[i]);
+        ndt_incref(dtypes[i]);
+        rows[i] = ndt_fixed_dim(dtypes[i], 1, 1, ctx);
+        if (rows[i] == NULL) {
+            goto out;
+        }
+    }
+
+    for (k = 0; k < f->nops; k++) {
+        const fuse_op_t *op = &f->ops[k];
+        const ndt_t *args[GM_FUSE_MAX_OP_ARGS];
+        const int s = f->nin + k;
+
+        for (i = 0; i < op->nargs; i++) {
+            args[i] = rows[op->args[i]];
+        }
+
+        if (select_op(&kernel, &dtypes[s], f, k, args, 0, ctx) < 0) {
+            goto out;
+        }
+
+        rows[s] = ndt_fixed_dim(dtypes[s], 1, 1, ctx);
+        if (rows[s] == NULL) {
+            goto out;
+        }
+    }
+
+    if (shape == NULL) {
+        res = dtypes[nslots-1];
+        ndt_incref(res);
+    }
+    else {
+        res = ndt_copy_contiguous_dtype(shape, dtypes[nslots-1], 0, ctx);
+    }
+
+out:
+    for (i = 0; i < nslots; i++) {
+        if (dtypes) ndt_decref(dtypes[i]);
+        if (rows) ndt_decref(rows[i]);
+    }
+    ndt_free(dtypes);
+    ndt_free(rows);
+
+    return res;
+}
+
+
+/****************************************************************************/
+/*                                Evaluation                                */
+/****************************************************************************/
+
+static inline xnd_t
+slot_chunk(const fuse_state_t *st, const xnd_t xs[], int s, int64_t start,
+           bool full)
+{
+    const gm_fuse_t *f = st->f;
+    const fuse_slot_t *slot = &st->slots[s];
+    const int nslots = f->nin + f->nops;
+    xnd_t x;
+
+    if (s < f->nin || s == nslots-1) {
+        const xnd_t *v = &xs[s < f->nin ? s : f->nin];
+        x.bitmap = v->bitmap;
+        x.ptr = v->ptr;
+        /* The data pointer of a scalar already includes the index. */
+        x.index = v->type->ndim == 0 ? 0 : v->index + start * slot->step;
+    }
+    else {
+        x.bitmap = xnd_bitmap_empty;
+        x.ptr = slot->buf;
+        x.index = 0;
+    }
+
+    x.type = full ? slot->row : slot->tail;
+
+    return x;
+}
+
+static int
+fuse_chunks(const fuse_state_t *st, const xnd_t xs[], ndt_context_t *ctx)
+{
+    const gm_fuse_t *f = st->f;
+    xnd_t stack[GM_FUSE_MAX_OP_ARGS+1];
+
+    for (int64_t c = 0; c < st->n; c += st->chunk) {
+        const bool full = c + st->chunk <= st->n;
+
+        for (int k = 0; k < f->nops; k++) {
+            const fuse_op_t *op = &f->ops[k];
+            int i;
+
+            for (i = 0; i < op->nargs; i++) {
+                stack[i] = slot_chunk(st, xs, op->args[i], c, full);
+            }
+            stack[i] = slot_chunk(st, xs, f->nin+k, c, full);
+
+            if (gm_apply(&st->kernels[k], stack, 1, ctx) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Loop over all but the innermost dimension; scalars are not advanced. */
+static int
+fuse_loop(const fuse_state_t *st, const xnd_t xs[], int nx, int ndim,
+          ndt_context_t *ctx)
+{
+    ALLOCA(xnd_t, next, nx);
+    int64_t shape;
+
+    if (ndim <= 1) {
+        return fuse_chunks(st, xs, ctx);
+    }
+
+    shape = xs[nx-1].type->FixedDim.shape;
+
+    for (int64_t i = 0; i < shape; i++) {
+        for (int k = 0; k < nx; k++) {
+            next[k] = xs[k].type->ndim == 0 ? xs[k]
+                                            : xnd_fixed_dim_next(&xs[k], i);
+        }
+
+        if (fuse_loop(st, next, nx, ndim-1, ctx) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+make_rows(fuse_slot_t *slot, const fuse_state_t *st, ndt_context_t *ctx)
+{
+    const int64_t rem = st->n % st->chunk;
+
+    slot->row = ndt_fixed_dim(slot->dtype, st->chunk, slot->step, ctx);
+    if (slot->row == NULL) {
+        return -1;
+    }
+
+    if (rem != 0) {
+        slot->tail = ndt_fixed_dim(slot->dtype, rem, slot->step, ctx);
+        if (slot->tail == NULL) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int64_t
+chunk_size(int nslots, int64_t itemsize)
+{
+    int64_t cache_size = gm_get_block_cache_size();
+    int64_t n;
+
+    if (cache_size == 0) {
+        cache_size = GM_BLOCK_CACHE_SIZE;
+    }
+
+    /* Let the chunks of all slots use a multiple of the L1 budget. */
+    n = (GM_FUSE_CACHE_FACTOR * cache_size) / (nslots * itemsize);
+    n = n < 64 ? 64 : n > 8192 ? 8192 : n;
+
+    return n & ~(int64_t)15;
+}
+
+/*
+ * Evaluate the fused expression.  'stack' contains the nin inputs followed
+ * by the output.  Inputs are either scalars or have the shape of the output.
+ */
+int
+gm_fuse_apply(const gm_fuse_t *f, xnd_t stack[], ndt_context_t *ctx)
+{
+    const int nin = f->nin;
+    const int nslots = nin + f->nops;
+    const ndt_t *out = stack[nin].type;
+    const ndt_t *types[GM_FUSE_MAX_OP_ARGS+1];
+    ALLOCA(int64_t, steps, nin+1);
+    fuse_state_t st = {f, NULL, NULL, 0, 0};
+    ndt_ndarray_t a, b;
+    int64_t itemsize = 1;
+    bool collapse = true;
+    int ndim, i, k;
+    int ret = -1;
+
+    if (f->nops == 0) {
+        ndt_err_format(ctx, NDT_ValueError, "fused expression is empty");
+        return -1;
+    }
+
+    if (ndt_as_ndarray(&a, out, ctx) < 0) {
+        return -1;
+    }
+    ndim = a.ndim;
+
+    for (i = 0; i <= nin; i++) {
+        const ndt_t *t = stack[i].type;
+
+        if (ndt_as_ndarray(&b, t, ctx) < 0) {
+            return -1;
+        }
+
+        if (ndt_is_optional(ndt_dtype(t))) {
+            ndt_err_format(ctx, NDT_NotImplementedError,
+                "fused expressions do not support optional dtypes");
+            return -1;
+        }
+
+        steps[i] = 0;
+        if (b.ndim != 0) {
+            if (b.ndim != ndim ||
+                memcmp(b.shape, a.shape, ndim * sizeof a.shape[0]) != 0) {
+                ndt_err_format(ctx, NDT_ValueError,
+                    "operands of a fused expression must be scalars or have "
+                    "the shape of the output");
+                return -1;
+            }
+            if (!ndt_is_c_contiguous(t)) {
+                collapse = false;
+            }
+            steps[i] = b.steps[ndim-1];
+        }
+
+        if (b.itemsize > itemsize) {
+            itemsize = b.itemsize;
+        }
+    }
+
+    if (ndim == 0) {
+        st.n = 1;
+    }
+    else if (collapse) {
+        st.n = ndt_nelem(out);
+        for (i = 0; i <= nin; i++) {
+            steps[i] = stack[i].type->ndim == 0 ? 0 : 1;
+        }
+    }
+    else {
+        st.n = a.shape[ndim-1];
+    }
+
+    st.chunk = chunk_size(nslots, itemsize);
+    if (st.chunk > st.n) {
+        st.chunk = st.n == 0 ? 1 : st.n;
+    }
+
+    st.slots = ndt_calloc(nslots, sizeof *st.slots);
+    st.kernels = ndt_calloc(f->nops, sizeof *st.kernels);
+    if (st.slots == NULL || st.kernels == NULL) {
+        (void)ndt_memory_error(ctx);
+        goto out;
+    }
+
+    /* The output occupies the slot of the last result. */
+    for (i = 0; i <= nin; i++) {
+        fuse_slot_t *slot = &st.slots[i < nin ? i : nslots-1];
+
+        slot->step = steps[i];
+        slot->dtype = ndt_dtype(stack[i].type);
+        ndt_incref(slot->dtype);
+    }
+
+    for (i = 0; i < nin; i++) {
+        if (make_rows(&st.slots[i], &st, ctx) < 0) {
+            goto out;
+        }
+    }
+
+    for (k = 0; k < f->nops; k++) {
+        const fuse_op_t *op = &f->ops[k];
+        fuse_slot_t *slot = &st.slots[nin+k];
+
+        for (i = 0; i < op->nargs; i++) {
+            types[i] = st.slots[op->args[i]].row;
+        }
+
+        if (k == f->nops-1) {
+            const ndt_t *dtype;
+
+            if (make_rows(slot, &st, ctx) < 0) {
+                goto out;
+            }
+            types[i] = slot->row;
+
+            if (select_op(&st.kernels[k], &dtype, f, k, types, 1, ctx) < 0) {
+                goto out;
+            }
+            ndt_decref(dtype);
+        }
+        else {
+            if (select_op(&st.kernels[k], &slot->dtype, f, k, types, 0, ctx) < 0) {
+                goto out;
+            }
+
+            slot->step = 1;
+            if (make_rows(slot, &st, ctx) < 0) {
+                goto out;
+            }
+
+            slot->buf = ndt_aligned_calloc(slot->dtype->align,
+                                           st.chunk * slot->dtype->datasize);
+            if (slot->buf == NULL) {
+                (void)ndt_memory_error(ctx);
+                goto out;
+            }
+        }
+    }
+
+    if (st.n == 0) {
+        ret = 0;
+    }
+    else if (collapse || ndim <= 1) {
+        ret = fuse_chunks(&st, stack, ctx);
+    }
+    else {
+        ret = fuse_loop(&st, stack, nin+1, ndim, ctx);
+    }
+
+out:
+    if (st.slots != NULL) {
+        for (i = 0; i < nslots; i++) {
+            ndt_decref(st.slots[i].dtype);
+            ndt_decref(st.slots[i].row);
+            ndt_decref(st.slots[i].tail);
+            ndt_aligned_free(st.slots[i].buf);
+        }
+    }
+    ndt_free(st.slots);
+    ndt_free(st.kernels);
+
+    return ret;
+}
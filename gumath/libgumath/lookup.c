@@ -0,0 +1,254 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+#include "lookup.h"
+
+
+/*
+ * Kernels are indexed by the dtype of their first input.  If the dtype of
+ * an input in a signature is primitive, it must be equal to the dtype of a
+ * matching argument, so each call only needs to try the kernels in the bucket
+ * of its first argument and the kernels whose first input is not indexed
+ * (typevars, kinds, records, ...).  The dtypes of the next inputs are used
+ * as a cheap filter before the full type check.
+ */
+
+#define GM_LOOKUP_KEYS (2 * Typevar + 2)
+
+typedef struct {
+    int size;
+    int alloc;
+    int32_t *kernels;
+} bucket_t;
+
+typedef struct {
+    int nin;
+    uint8_t key[GM_LOOKUP_ARGS];
+} entry_t;
+
+struct _gm_lookup {
+    bucket_t buckets[GM_LOOKUP_KEYS];
+    bucket_t any;
+    int nkernels;
+    int alloc;
+    entry_t *kernels;
+};
+
+
+/* 0 for dtypes that are not indexed. */
+static uint8_t
+dtype_key(const ndt_t *t)
+{
+    const ndt_t *dtype = ndt_dtype(t);
+
+    switch (dtype->tag) {
+    case Bool:
+    case Int8: case Int16: case Int32: case Int64:
+    case Uint8: case Uint16: case Uint32: case Uint64:
+    case BFloat16: case Float16: case Float32: case Float64:
+    case BComplex32: case Complex32: case Complex64: case Complex128:
+    case String:
+        return (uint8_t)(2 * dtype->tag + ndt_is_optional(dtype));
+    default:
+        return 0;
+    }
+}
+
+static int
+bucket_append(bucket_t *b, int32_t n, ndt_context_t *ctx)
+{
+    if (b->size == b->alloc) {
+        int alloc = b->alloc == 0 ? 8 : 2 * b->alloc;
+        int32_t *kernels = ndt_realloc(b->kernels, alloc, sizeof *kernels);
+        if (kernels == NULL) {
+            (void)ndt_memory_error(ctx);
+            return -1;
+        }
+        b->kernels = kernels;
+        b->alloc = alloc;
+    }
+
+    b->kernels[b->size++] = n;
+    return 0;
+}
+
+gm_lookup_t *
+gm_lookup_new(ndt_context_t *ctx)
+{
+    gm_lookup_t *t = ndt_calloc(1, sizeof *t);
+
+    if (t == NULL) {
+        return ndt_memory_error(ctx);
+    }
+
+    return t;
+}
+
+void
+gm_lookup_del(gm_lookup_t *t)
+{
+    if (t == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < GM_LOOKUP_KEYS; i++) {
+        ndt_free(t->buckets[i].kernels);
+    }
+    ndt_free(t->any.kernels);
+    ndt_free(t->kernels);
+    ndt_free(t);
+}
+
+/* Add kernel set 'n' with signature 'sig'.  Kernels are added in order. */
+int
+gm_lookup_add(gm_lookup_t *t, int n, const ndt_t *sig, ndt_context_t *ctx)
+{
+    entry_t *entry;
+
+    if (n != t->nkernels) {
+        ndt_err_format(ctx, NDT_RuntimeError,
+            "kernel lookup: kernels must be added in order");
+        return -1;
+    }
+
+    if (t->nkernels == t->alloc) {
+        int alloc = t->alloc == 0 ? 8 : 2 * t->alloc;
+        entry_t *kernels = ndt_realloc(t->kernels, alloc, sizeof *kernels);
+        if (kernels == NULL) {
+            (void)ndt_memory_error(ctx);
+            return -1;
+        }
+        t->kernels = kernels;
+        t->alloc = alloc;
+    }
+
+    entry = &t->kernels[n];
+    entry->nin = -1;
+    for (int i = 0; i < GM_LOOKUP_ARGS; i++) {
+        entry->key[i] = 0;
+    }
+
+    if (sig->tag == Function) {
+        entry->nin = (int)sig->Function.nin;
+        for (int i = 0; i < entry->nin && i < GM_LOOKUP_ARGS; i++) {
+            entry->key[i] = dtype_key(sig->Function.types[i]);
+        }
+    }
+
+    if (bucket_append(entry->key[0] ? &t->buckets[entry->key[0]] : &t->any,
+                      n, ctx) < 0) {
+        return -1;
+    }
+
+    t->nkernels++;
+    return 0;
+}
+
+void
+gm_lookup_iter_init(gm_lookup_iter_t *it, const gm_lookup_t *t,
+                    const ndt_t *types[], int nin)
+{
+    it->lookup = t;
+    it->i = 0;
+    it->j = 0;
+    it->nin = nin;
+
+    for (int k = 0; k < GM_LOOKUP_ARGS; k++) {
+        it->key[k] = k < nin ? dtype_key(types[k]) : 0;
+    }
+
+    if (it->key[0] != 0) {
+        it->bucket = t->buckets[it->key[0]].kernels;
+        it->nbucket = t->buckets[it->key[0]].size;
+    }
+    else {
+        it->bucket = NULL;
+        it->nbucket = 0;
+    }
+}
+
+static inline bool
+may_match(const entry_t *entry, const gm_lookup_iter_t *it)
+{
+    if (entry->nin < 0) {
+        return true;
+    }
+
+    if (entry->nin != it->nin) {
+        return false;
+    }
+
+    for (int k = 1; k < GM_LOOKUP_ARGS && k < it->nin; k++) {
+        if (entry->key[k] != 0 && entry->key[k] != it->key[k]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Return the next candidate kernel set, -1 if there are no more candidates. */
+int
+gm_lookup_next(gm_lookup_iter_t *it)
+{
+    const gm_lookup_t *t = it->lookup;
+
+    for (;;) {
+        const int32_t a = it->i < it->nbucket ? it->bucket[it->i] : INT32_MAX;
+        const int32_t b = it->j < t->any.size ? t->any.kernels[it->j] : INT32_MAX;
+        int32_t n;
+
+        if (a == INT32_MAX && b == INT32_MAX) {
+            return -1;
+        }
+
+        if (a < b) {
+            n = a;
+            it->i++;
+        }
+        else {
+            n = b;
+            it->j++;
+        }
+
+        if (may_match(&t->kernels[n], it)) {
+            return n;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#ifndef LOOKUP_H
+#define LOOKUP_H
+
+
+#include <stdint.h>
+#include <ndtypes.h>
+#include <gumath.h>
+
+
+/*****************************************************************************/
+/*                  Kernel lookup index by input dtypes                      */
+/*****************************************************************************/
+
+/* Number of leading inputs whose dtypes are recorded for each kernel. */
+#define GM_LOOKUP_ARGS 4
+
+/*
+ * Iterator over the kernel sets of a function that can match the given
+ * input types, in registration order.
+ */
+typedef struct {
+    const gm_lookup_t *lookup;
+    const int32_t *bucket;
+    int nbucket;
+    int i;      /* position in 'bucket' */
+    int j;      /* position in the list of kernels without an indexed dtype */
+    int nin;
+    uint8_t key[GM_LOOKUP_ARGS];
+} gm_lookup_iter_t;
+
+gm_lookup_t *gm_lookup_new(ndt_context_t *ctx);
+void gm_lookup_del(gm_lookup_t *t);
+int gm_lookup_add(gm_lookup_t *t, int n, const ndt_t *sig, ndt_context_t *ctx);
+void gm_lookup_iter_init(gm_lookup_iter_t *it, const gm_lookup_t *t,
+                         const ndt_t *types[], int nin);
+int gm_lookup_next(gm_lookup_iter_t *it);
+
+
+#endif /* LOOKUP_H */
@@ -0,0 +1,225 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#ifndef _MSC_VER
+  #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+#include "stats.h"
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+/*****************************************************************************/
+/*                              Call statistics                              */
+/*****************************************************************************/
+
+/*
+ * Statistics are disabled by default.  When enabled, gm_select() records the
+ * time spent in type checking and kernel selection and the reason for not
+ * choosing the fastest kernel slot.  gm_apply() and gm_apply_thread() record
+ * the kernel time, the number of bytes of all arguments and the threading
+ * decision.  The counters live in the gm_func_t and are updated under a lock.
+ */
+
+GM_STATS_ATOMIC(bool) gm_stats_on = false;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define STATS_LOCK() pthread_mutex_lock(&stats_mutex)
+#define STATS_UNLOCK() pthread_mutex_unlock(&stats_mutex)
+#else
+#define STATS_LOCK()
+#define STATS_UNLOCK()
+#endif
+
+static const char *slot_names[GM_NUM_SLOTS] = {
+  "OptC", "OptZ", "OptS", "C", "Fortran", "Strided", "Xnd"
+};
+
+static const char *reason_names[GM_NUM_REASONS] = {
+  "layout", "missing_kernel", "no_match", "one_thread", "small", "not_ndarray"
+};
+
+
+void
+gm_stats_enable(bool enable)
+{
+    gm_stats_store(&gm_stats_on, enable);
+}
+
+bool
+gm_stats_enabled(void)
+{
+    return gm_stats_load(&gm_stats_on);
+}
+
+const char *
+gm_stats_slot_name(int slot)
+{
+    return 0 <= slot && slot < GM_NUM_SLOTS ? slot_names[slot] : NULL;
+}
+
+const char *
+gm_stats_reason_name(int reason)
+{
+    return 0 <= reason && reason < GM_NUM_REASONS ? reason_names[reason] : NULL;
+}
+
+/* Copy the statistics of 'f'. */
+void
+gm_stats_get(gm_stats_t *stats, const gm_func_t *f)
+{
+    STATS_LOCK();
+    if (f->stats == NULL) {
+        memset(stats, 0, sizeof *stats);
+    }
+    else {
+        *stats = *f->stats;
+    }
+    STATS_UNLOCK();
+}
+
+static int
+reset(const gm_func_t *f, void *state)
+{
+    (void)state;
+
+    if (f->stats != NULL) {
+        memset(f->stats, 0, sizeof *f->stats);
+    }
+
+    return 0;
+}
+
+/* Clear the statistics of all functions in 'tbl'. */
+void
+gm_stats_reset(const gm_tbl_t *tbl)
+{
+    STATS_LOCK();
+    (void)gm_tbl_map(tbl, reset, NULL);
+    STATS_UNLOCK();
+}
+
+
+/*****************************************************************************/
+/*                              Internal interface                           */
+/*****************************************************************************/
+
+/* Monotonic time in nanoseconds. */
+int64_t
+gm_stats_now(void)
+{
+    struct timespec ts;
+
+#ifdef _MSC_VER
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+    return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+}
+
+/* Record a gm_select() call; 'reason' is -1 if the fastest slot was chosen. */
+void
+gm_stats_select(gm_stats_t *stats, int64_t typecheck_ns, int64_t select_ns,
+                int reason)
+{
+    STATS_LOCK();
+    stats->selects++;
+    stats->typecheck_ns += typecheck_ns;
+    stats->select_ns += select_ns;
+    if (reason >= 0) {
+        stats->reasons[reason]++;
+    }
+    STATS_UNLOCK();
+}
+
+void
+gm_stats_reason(gm_stats_t *stats, int reason)
+{
+    STATS_LOCK();
+    stats->reasons[reason]++;
+    STATS_UNLOCK();
+}
+
+static int64_t
+nbytes(const ndt_t *t)
+{
+    if (ndt_is_ndarray(t)) {
+        return ndt_nelem(t) * ndt_dtype(t)->datasize;
+    }
+
+    return t->datasize;
+}
+
+/* Record a kernel application that started at 'start'. */
+void
+gm_stats_apply(const gm_kernel_t *kernel, const xnd_t stack[], int64_t start,
+               bool threaded)
+{
+    const int64_t elapsed = gm_stats_now() - start;
+    const int nargs = (int)kernel->set->sig->Function.nargs;
+    const int slot = gm_kernel_slot(kernel);
+    int64_t bytes = 0;
+
+    if (slot < 0) {
+        return;
+    }
+
+    for (int i = 0; i < nargs; i++) {
+        bytes += nbytes(stack[i].type);
+    }
+
+    STATS_LOCK();
+    gm_slot_stats_t *s = &kernel->stats->slots[slot];
+    s->calls++;
+    s->threaded += threaded;
+    s->bytes += bytes;
+    s->kernel_ns += elapsed;
+    STATS_UNLOCK();
+}
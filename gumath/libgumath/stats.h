@@ -0,0 +1,86 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#ifndef STATS_H
+#define STATS_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+
+#ifndef _MSC_VER
+  #include <stdatomic.h>
+#endif
+
+
+/*****************************************************************************/
+/*                   Internal interface for call statistics                  */
+/*****************************************************************************/
+
+/*
+ * The flag is read by calls that run without the GIL.  It does not guard
+ * other data, so relaxed ordering suffices.
+ */
+#if defined(_MSC_VER)
+  #define GM_STATS_ATOMIC(T) T volatile
+  #define gm_stats_load(p) (*(p))
+  #define gm_stats_store(p, v) (void)(*(p) = (v))
+#else
+  #define GM_STATS_ATOMIC(T) _Atomic(T)
+  #define gm_stats_load(p) atomic_load_explicit(p, memory_order_relaxed)
+  #define gm_stats_store(p, v) atomic_store_explicit(p, v, memory_order_relaxed)
+#endif
+
+extern GM_STATS_ATOMIC(bool) gm_stats_on;
+
+static inline bool
+gm_stats_active(void)
+{
+    return gm_stats_load(&gm_stats_on);
+}
+
+int64_t gm_stats_now(void);
+int gm_kernel_slot(const gm_kernel_t *kernel);
+
+void gm_stats_select(gm_stats_t *stats, int64_t typecheck_ns, int64_t select_ns,
+                     int reason);
+void gm_stats_reason(gm_stats_t *stats, int reason);
+void gm_stats_apply(const gm_kernel_t *kernel, const xnd_t stack[],
+                    int64_t start, bool threaded);
+
+
+#endif /* STATS_H */
@@ -38,6 +38,8 @@
 #include <ndtypes.h>
 #include <xnd.h>
 #include <gumath.h>
+#include "stats.h"
+#include "trace.h"
 
 
 #include "config.h"
@@ -52,6 +54,7 @@ struct thread_info {
     int nrows;
     int ncols;
     const gm_kernel_t *kernel;
+    const gm_kernel_t *traced;
     xnd_t **slices;
     int outer_dims;
     ndt_context_t ctx;
@@ -90,35 +93,34 @@ apply_thread(void *arg)
         stack[i] = tinfo->slices[i][tinfo->tnum];
     }
 
-    gm_apply(tinfo->kernel, stack, tinfo->outer_dims, &tinfo->ctx);
+    if (tinfo->traced == NULL) {
+        gm_apply(tinfo->kernel, stack, tinfo->outer_dims, &tinfo->ctx);
+        return NULL;
+    }
+
+    gm_trace_apply(GM_TRACE_CHUNK, tinfo->traced, stack, tinfo->tnum, true, 0);
+    int ret = gm_apply(tinfo->kernel, stack, tinfo->outer_dims, &tinfo->ctx);
+    gm_trace_apply(GM_TRACE_CHUNK, tinfo->traced, stack, tinfo->tnum, false, ret);
+
     return NULL;
 }
 
-int
-gm_apply_thread(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
-                const int64_t nthreads, ndt_context_t *ctx)
+/* Split the arguments and apply the kernel in 'nthreads' worker threads. */
+static int
+apply_threads(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
+              const int64_t nthreads, bool trace, ndt_context_t *ctx)
 {
     const int nrows = (int)kernel->set->sig->Function.nargs;
     ALLOCA(xnd_t *, slices, nrows);
     ALLOCA(int, nslices, nrows);
     struct thread_info *tinfo;
+    gm_kernel_t worker_kernel;
     int ncols, tnum;
-    bool use_threads = true;
-
-    if (nthreads <= 1 || nrows == 0 || outer_dims == 0) {
-        use_threads = false;
-    }
-
-    for (int i = 0; i < nrows; i++) {
-        const ndt_t *t = stack[i].type;
-        if (!ndt_is_ndarray(t) || ndt_nelem(t) < GM_THREAD_CUTOFF) {
-            use_threads = false;
-        }
-    }
 
-    if (!use_threads) {
-        return gm_apply(kernel, stack, outer_dims, ctx);
-    }
+    /* The call is recorded as a whole, the workers only emit chunk events. */
+    worker_kernel = *kernel;
+    worker_kernel.stats = NULL;
+    worker_kernel.name = NULL;
 
     for (int i = 0; i < nrows; i++) {
         int64_t ncols = nthreads;
@@ -149,7 +151,8 @@ gm_apply_thread(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
 
     for (tnum = 0; tnum < ncols; tnum++) {
         tinfo[tnum].tnum = tnum;
-        tinfo[tnum].kernel = kernel;
+        tinfo[tnum].kernel = &worker_kernel;
+        tinfo[tnum].traced = trace ? kernel : NULL;
         tinfo[tnum].nrows = nrows;
         tinfo[tnum].ncols = ncols;
         tinfo[tnum].slices = slices;
@@ -187,4 +190,62 @@ gm_apply_thread(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
 
     return ndt_err_occurred(ctx) ? -1 : 0;
 }
+
+int
+gm_apply_thread(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims,
+                const int64_t nthreads, ndt_context_t *ctx)
+{
+    const int nrows = (int)kernel->set->sig->Function.nargs;
+    const bool stats = gm_stats_active() && kernel->stats != NULL;
+    const bool trace = gm_trace_enabled() && kernel->name != NULL;
+    int reason = -1;
+    int64_t start = 0;
+    int ret;
+
+    if (nthreads <= 1) {
+        reason = GM_REASON_ONE_THREAD;
+    }
+    else if (nrows == 0 || outer_dims == 0) {
+        reason = GM_REASON_NOT_NDARRAY;
+    }
+
+    for (int i = 0; i < nrows && reason < 0; i++) {
+        const ndt_t *t = stack[i].type;
+        if (!ndt_is_ndarray(t)) {
+            reason = GM_REASON_NOT_NDARRAY;
+        }
+        else if (ndt_nelem(t) < GM_THREAD_CUTOFF) {
+            reason = GM_REASON_SMALL;
+        }
+    }
+
+    if (reason >= 0) {
+        if (stats) {
+            gm_stats_reason(kernel->stats, reason);
+        }
+        return gm_apply(kernel, stack, outer_dims, ctx);
+    }
+
+    if (!stats && !trace) {
+        return apply_threads(kernel, stack, outer_dims, nthreads, false, ctx);
+    }
+
+    if (trace) {
+        gm_trace_apply(GM_TRACE_APPLY, kernel, stack, -1, true, 0);
+    }
+    if (stats) {
+        start = gm_stats_now();
+    }
+
+    ret = apply_threads(kernel, stack, outer_dims, nthreads, trace, ctx);
+
+    if (stats) {
+        gm_stats_apply(kernel, stack, start, true);
+    }
+    if (trace) {
+        gm_trace_apply(GM_TRACE_APPLY, kernel, stack, -1, false, ret);
+    }
+
+    return ret;
+}
 #endif
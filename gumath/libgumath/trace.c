@@ -0,0 +1,350 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+#include "stats.h"
+#include "trace.h"
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+/*****************************************************************************/
+/*                                 Trace hook                                */
+/*****************************************************************************/
+
+/*
+ * The record is NULL unless tracing is enabled, so the disabled path is a
+ * single load and branch at the call sites.  Replaced records are never
+ * freed, since calls in other threads may still use them.  Hooks are set
+ * rarely, writers are serialized by a mutex.
+ */
+GM_TRACE_ATOMIC(gm_trace_t *) gm_trace = NULL;
+static gm_trace_t *gm_trace_retired = NULL;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define TRACE_LOCK() pthread_mutex_lock(&trace_mutex)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&trace_mutex)
+#else
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif
+
+int
+gm_set_trace_hook(gm_trace_hook_t hook, void *data, ndt_context_t *ctx)
+{
+    gm_trace_t *t = NULL;
+    gm_trace_t *old;
+
+    if (hook != NULL) {
+        t = ndt_alloc_size(sizeof *t);
+        if (t == NULL) {
+            (void)ndt_memory_error(ctx);
+            return -1;
+        }
+        t->retired = NULL;
+        t->hook = hook;
+        t->data = data;
+    }
+
+    TRACE_LOCK();
+    old = gm_trace_load(&gm_trace);
+    gm_trace_store(&gm_trace, t);
+    if (old != NULL) {
+        old->retired = gm_trace_retired;
+        gm_trace_retired = old;
+    }
+    TRACE_UNLOCK();
+
+    return 0;
+}
+
+gm_trace_hook_t
+gm_get_trace_hook(void)
+{
+    const gm_trace_t *t = gm_trace_load(&gm_trace);
+    return t != NULL ? t->hook : NULL;
+}
+
+static uint64_t
+thread_id(void)
+{
+#ifdef HAVE_PTHREAD_H
+    return (uint64_t)(uintptr_t)pthread_self();
+#else
+    return 0;
+#endif
+}
+
+static void
+emit(gm_trace_event_t *event)
+{
+    const gm_trace_t *t = gm_trace_load(&gm_trace);
+
+    if (t != NULL) {
+        event->thread = thread_id();
+        t->hook(event, t->data);
+    }
+}
+
+void
+gm_trace_select(const char *name, const ndt_t *types[], int nin,
+                const gm_kernel_t *kernel, bool begin, int status)
+{
+    gm_trace_event_t event;
+
+    event.kind = GM_TRACE_SELECT;
+    event.begin = begin;
+    event.status = status;
+    event.name = name;
+    event.slot = kernel != NULL && kernel->set != NULL ? gm_kernel_slot(kernel) : -1;
+    event.nargs = nin;
+    event.types = types;
+    event.worker = -1;
+
+    emit(&event);
+}
+
+void
+gm_trace_apply(enum gm_trace_kind kind, const gm_kernel_t *kernel,
+               const xnd_t stack[], int worker, bool begin, int status)
+{
+    const int nargs = (int)kernel->set->sig->Function.nargs;
+    ALLOCA(const ndt_t *, types, nargs);
+    gm_trace_event_t event;
+
+    for (int i = 0; i < nargs; i++) {
+        types[i] = stack[i].type;
+    }
+
+    event.kind = kind;
+    event.begin = begin;
+    event.status = status;
+    event.name = kernel->name;
+    event.slot = gm_kernel_slot(kernel);
+    event.nargs = nargs;
+    event.types = types;
+    event.worker = worker;
+
+    emit(&event);
+}
+
+
+/*****************************************************************************/
+/*                           Chrome trace writer                             */
+/*****************************************************************************/
+
+/*
+ * Write the events in the Chrome trace event format (a JSON array of
+ * duration events), which can be loaded into chrome://tracing or Perfetto.
+ */
+
+static FILE *chrome_fp = NULL;
+static bool chrome_first = true;
+static int64_t chrome_start = 0;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t chrome_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CHROME_LOCK() pthread_mutex_lock(&chrome_mutex)
+#define CHROME_UNLOCK() pthread_mutex_unlock(&chrome_mutex)
+#else
+#define CHROME_LOCK()
+#define CHROME_UNLOCK()
+#endif
+
+static const char *kind_names[] = { "select", "apply", "chunk" };
+
+/* Append the shapes of the arguments as "(2, 3), ()". */
+static void
+format_shapes(char *buf, size_t size, const gm_trace_event_t *event)
+{
+    size_t n = 0;
+
+    buf[0] = '\0';
+
+    for (int i = 0; i < event->nargs && n < size; i++) {
+        const ndt_t *t = event->types[i];
+
+        n += snprintf(buf+n, size-n, "%s(", i == 0 ? "" : ", ");
+
+        for (int k = 0; t->ndim > 0 && n < size; k++) {
+            if (t->tag == FixedDim) {
+                n += snprintf(buf+n, size-n, "%s%" PRIi64, k == 0 ? "" : ", ",
+                              t->FixedDim.shape);
+                t = t->FixedDim.type;
+            }
+            else if (t->tag == VarDim) {
+                n += snprintf(buf+n, size-n, "%svar", k == 0 ? "" : ", ");
+                t = t->VarDim.type;
+            }
+            else {
+                break;
+            }
+        }
+
+        if (n < size) {
+            n += snprintf(buf+n, size-n, ")");
+        }
+    }
+}
+
+static void
+chrome_hook(const gm_trace_event_t *event, void *data)
+{
+    const double ts = (double)(gm_stats_now() - chrome_start) * 1e-3;
+    const char *slot = gm_stats_slot_name(event->slot);
+    char shapes[512];
+
+    (void)data;
+
+    if (event->begin) {
+        format_shapes(shapes, sizeof shapes, event);
+    }
+
+    CHROME_LOCK();
+
+    if (chrome_fp == NULL) {
+        CHROME_UNLOCK();
+        return;
+    }
+
+    fprintf(chrome_fp,
+        "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%s\", "
+        "\"ts\": %.3f, \"pid\": 1, \"tid\": %" PRIu64,
+        chrome_first ? "" : ",\n",
+        event->name ? event->name : "",
+        kind_names[event->kind],
+        event->begin ? "B" : "E",
+        ts, event->thread);
+
+    if (event->begin) {
+        fprintf(chrome_fp, ", \"args\": {\"shapes\": \"%s\"", shapes);
+        if (event->worker >= 0) {
+            fprintf(chrome_fp, ", \"worker\": %d", event->worker);
+        }
+        fprintf(chrome_fp, "}}");
+    }
+    else {
+        fprintf(chrome_fp, ", \"args\": {\"kernel\": \"%s\", \"status\": %d}}",
+                slot ? slot : "", event->status);
+    }
+
+    chrome_first = false;
+
+    CHROME_UNLOCK();
+}
+
+/* Start writing all events to 'path'. */
+int
+gm_trace_chrome_start(const char *path, ndt_context_t *ctx)
+{
+    FILE *fp;
+
+    CHROME_LOCK();
+
+    if (chrome_fp != NULL) {
+        CHROME_UNLOCK();
+        ndt_err_format(ctx, NDT_RuntimeError, "chrome trace is already active");
+        return -1;
+    }
+
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        CHROME_UNLOCK();
+        ndt_err_format(ctx, NDT_OSError, "could not open '%s'", path);
+        return -1;
+    }
+
+    if (gm_set_trace_hook(chrome_hook, NULL, ctx) < 0) {
+        CHROME_UNLOCK();
+        fclose(fp);
+        return -1;
+    }
+
+    fputs("[\n", fp);
+    chrome_fp = fp;
+    chrome_first = true;
+    chrome_start = gm_stats_now();
+
+    CHROME_UNLOCK();
+
+    return 0;
+}
+
+/*
+ * Stop tracing and close the file.  Calls that are in flight in other threads
+ * may lose their exit events.
+ */
+int
+gm_trace_chrome_stop(ndt_context_t *ctx)
+{
+    int ret;
+
+    CHROME_LOCK();
+
+    if (chrome_fp == NULL) {
+        CHROME_UNLOCK();
+        ndt_err_format(ctx, NDT_RuntimeError, "chrome trace is not active");
+        return -1;
+    }
+
+    if (gm_get_trace_hook() == chrome_hook) {
+        (void)gm_set_trace_hook(NULL, NULL, ctx);
+    }
+
+    fputs("\n]\n", chrome_fp);
+    ret = fclose(chrome_fp);
+    chrome_fp = NULL;
+
+    CHROME_UNLOCK();
+
+    if (ret != 0) {
+        ndt_err_format(ctx, NDT_OSError, "could not write chrome trace");
+        return -1;
+    }
+
+    return 0;
+}
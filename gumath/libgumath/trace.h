@@ -0,0 +1,90 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ndtypes.h>
+#include <xnd.h>
+#include <gumath.h>
+
+#ifdef _MSC_VER
+  #include <windows.h>
+#else
+  #include <stdatomic.h>
+#endif
+
+
+/*****************************************************************************/
+/*                       Internal interface for tracing                      */
+/*****************************************************************************/
+
+/*
+ * The hook and its data are published together: readers load a single
+ * pointer and never see a hook with the data of another one.
+ */
+typedef struct gm_trace {
+    struct gm_trace *retired;
+    gm_trace_hook_t hook;
+    void *data;
+} gm_trace_t;
+
+#if defined(_MSC_VER)
+  #define GM_TRACE_ATOMIC(T) T volatile
+  #define gm_trace_load(p) InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+  #define gm_trace_store(p, v) (void)InterlockedExchangePointer((PVOID volatile *)(p), (v))
+#else
+  #define GM_TRACE_ATOMIC(T) _Atomic(T)
+  #define gm_trace_load(p) atomic_load_explicit(p, memory_order_acquire)
+  #define gm_trace_store(p, v) atomic_store_explicit(p, v, memory_order_release)
+#endif
+
+extern GM_TRACE_ATOMIC(gm_trace_t *) gm_trace;
+
+static inline bool
+gm_trace_enabled(void)
+{
+    return gm_trace_load(&gm_trace) != NULL;
+}
+
+void gm_trace_select(const char *name, const ndt_t *types[], int nin,
+                     const gm_kernel_t *kernel, bool begin, int status);
+void gm_trace_apply(enum gm_trace_kind kind, const gm_kernel_t *kernel,
+                    const xnd_t stack[], int worker, bool begin, int status);
+
+
+#endif /* TRACE_H */
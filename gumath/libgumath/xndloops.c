@@ -240,3 +240,140 @@ _gm_xnd_map(const gm_xnd_kernel_t f, xnd_t stack[], const int nargs,
         return -1;
     }
 }
+
+
+/****************************************************************************/
+/*                         Blocked loop for 1D kernels                      */
+/****************************************************************************/
+
+/*
+ * Visit the last two outer dimensions in square tiles of 'block' elements.
+ * The kernel is called on the rows of each tile.  'rows' and 'tail' are
+ * the 1D row types for a full and a partial tile.
+ */
+static int
+_gm_xnd_map_blocked(const gm_xnd_kernel_t f, xnd_t stack[], const int nargs,
+                    const int outer_dims, const int64_t block,
+                    const ndt_t *rows[], const ndt_t *tail[],
+                    ndt_context_t *ctx)
+{
+    ALLOCA(xnd_t, next, nargs);
+    ALLOCA(int64_t, s0, nargs);
+    ALLOCA(int64_t, s1, nargs);
+    const ndt_t *t = stack[0].type;
+    int64_t n0, n1;
+
+    if (outer_dims > 2) {
+        const int64_t shape = t->FixedDim.shape;
+
+        for (int64_t i = 0; i < shape; i++) {
+            for (int k = 0; k < nargs; k++) {
+                next[k] = xnd_fixed_dim_next(&stack[k], i);
+            }
+
+            if (_gm_xnd_map_blocked(f, next, nargs, outer_dims-1, block,
+                                    rows, tail, ctx) < 0) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    n0 = t->FixedDim.shape;
+    n1 = t->FixedDim.type->FixedDim.shape;
+
+    for (int k = 0; k < nargs; k++) {
+        const ndt_t *u = stack[k].type;
+        s0[k] = u->Concrete.FixedDim.step;
+        s1[k] = u->FixedDim.type->Concrete.FixedDim.step;
+        next[k].bitmap = stack[k].bitmap;
+        next[k].ptr = stack[k].ptr;
+    }
+
+    for (int64_t i0 = 0; i0 < n0; i0 += block) {
+        const int64_t imax = i0+block < n0 ? i0+block : n0;
+
+        for (int64_t j0 = 0; j0 < n1; j0 += block) {
+            const ndt_t **r = j0+block <= n1 ? rows : tail;
+
+            for (int64_t i = i0; i < imax; i++) {
+                for (int k = 0; k < nargs; k++) {
+                    next[k].index = stack[k].index + i*s0[k] + j0*s1[k];
+                    next[k].type = r[k];
+                }
+
+                if (f(next, ctx) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Blocked variant of gm_xnd_map() for kernels that take a strided 1D row
+ * (OptS).  All arguments must be ndarrays with exactly 'outer_dims' fixed
+ * dimensions.  This keeps both operands of a transposed access in cache.
+ */
+int
+gm_xnd_map_blocked(const gm_xnd_kernel_t f, xnd_t stack[], const int nargs,
+                   const int outer_dims, const int64_t block,
+                   ndt_context_t *ctx)
+{
+    ALLOCA(const ndt_t *, rows, nargs);
+    ALLOCA(const ndt_t *, tail, nargs);
+    int64_t n1;
+    int ret = -1;
+    int k;
+
+    if (outer_dims < 2 || nargs == 0 || block <= 0) {
+        ndt_err_format(ctx, NDT_RuntimeError,
+            "internal error: invalid arguments for blocked loop");
+        return -1;
+    }
+
+    for (k = 0; k < nargs; k++) {
+        const ndt_t *t = stack[k].type;
+        if (t->tag != FixedDim || t->ndim != outer_dims ||
+            have_stored_index(t)) {
+            ndt_err_format(ctx, NDT_RuntimeError,
+                "internal error: blocked loop requires ndarrays");
+            return -1;
+        }
+        rows[k] = tail[k] = NULL;
+    }
+
+    n1 = ndt_logical_dim_at(stack[0].type, outer_dims-1)->FixedDim.shape;
+
+    for (k = 0; k < nargs; k++) {
+        const ndt_t *u = ndt_logical_dim_at(stack[k].type, outer_dims-1);
+        const ndt_t *dtype = u->FixedDim.type;
+        const int64_t step = u->Concrete.FixedDim.step;
+
+        rows[k] = ndt_fixed_dim(dtype, block, step, ctx);
+        if (rows[k] == NULL) {
+            goto out;
+        }
+
+        if (n1%block != 0) {
+            tail[k] = ndt_fixed_dim(dtype, n1%block, step, ctx);
+            if (tail[k] == NULL) {
+                goto out;
+            }
+        }
+    }
+
+    ret = _gm_xnd_map_blocked(f, stack, nargs, outer_dims, block, rows, tail,
+                              ctx);
+
+out:
+    for (k = 0; k < nargs; k++) {
+        ndt_decref(rows[k]);
+        ndt_decref(tail[k]);
+    }
+
+    return ret;
+}
@@ -56,8 +56,12 @@ except ImportError:
     _cd = None
 
 
-__all__ = ['cuda', 'fold', 'functions', 'get_max_threads', 'gufunc', 'reduce',
-           'set_max_threads', 'unsafe_add_kernel', 'vfold', 'xndvectorize']
+__all__ = ['clear_pool', 'clear_stats', 'cuda', 'fold', 'functions', 'fuse',
+           'fused', 'get_block_cache_size', 'get_max_threads', 'get_pool_limit',
+           'get_stats_enabled', 'gufunc', 'reduce', 'set_block_cache_size',
+           'set_max_threads', 'set_pool_limit', 'set_stats_enabled',
+           'start_trace', 'stats', 'stop_trace', 'unsafe_add_kernel', 'vfold',
+           'xndvectorize']
 
 
 # ==============================================================================
@@ -196,6 +200,102 @@ maxcast = {
 }
 
 
+# ==============================================================================
+#                         Fused elementwise expressions
+# ==============================================================================
+
+class _FuseTrace(object):
+    def __init__(self, nparams):
+        self.nparams = nparams
+        self.constants = []
+        self.ops = []
+
+class _FuseExpr(object):
+    """Placeholder for an argument, a constant or an intermediate result
+       while tracing a fused expression."""
+
+    def __init__(self, trace, ref):
+        self._trace = trace
+        self._ref = ref
+
+    def _arg(self, v):
+        if isinstance(v, _FuseExpr):
+            if v._trace is not self._trace:
+                raise ValueError("cannot mix placeholders of different traces")
+            return v._ref
+        if not isinstance(v, xnd):
+            v = xnd(v)
+        if v.ndim != 0:
+            raise ValueError("constants in fused expressions must be scalars")
+        self._trace.constants.append(v)
+        return ('const', len(self._trace.constants)-1)
+
+    def apply(self, f, *args):
+        """Apply the elementwise gufunc 'f' to self and 'args'."""
+        refs = [self._ref] + [self._arg(v) for v in args]
+        self._trace.ops.append((f, refs))
+        return _FuseExpr(self._trace, ('op', len(self._trace.ops)-1))
+
+    def _rapply(self, f, other):
+        return _FuseExpr(self._trace, self._arg(other)).apply(f, self)
+
+    def __add__(self, other): return self.apply(_fn.add, other)
+    def __sub__(self, other): return self.apply(_fn.subtract, other)
+    def __mul__(self, other): return self.apply(_fn.multiply, other)
+    def __truediv__(self, other): return self.apply(_fn.divide, other)
+    def __floordiv__(self, other): return self.apply(_fn.floor_divide, other)
+    def __mod__(self, other): return self.apply(_fn.remainder, other)
+    def __pow__(self, other): return self.apply(_fn.power, other)
+    def __radd__(self, other): return self._rapply(_fn.add, other)
+    def __rsub__(self, other): return self._rapply(_fn.subtract, other)
+    def __rmul__(self, other): return self._rapply(_fn.multiply, other)
+    def __rtruediv__(self, other): return self._rapply(_fn.divide, other)
+    def __rfloordiv__(self, other): return self._rapply(_fn.floor_divide, other)
+    def __rmod__(self, other): return self._rapply(_fn.remainder, other)
+    def __rpow__(self, other): return self._rapply(_fn.power, other)
+    def __neg__(self): return self.apply(_fn.negative)
+    def __abs__(self): return self.apply(_fn.abs)
+
+def fuse(func):
+    """Trace the elementwise expression 'func' and return a callable that
+       evaluates it in a single pass over its arguments.  The expression
+       may use arithmetic operators, scalar constants and other elementwise
+       gufuncs via 'x.apply(f, ...)':
+
+           f = fuse(lambda a, b, c: a * b + c.apply(functions.sin))
+           f(x, y, z)
+
+       Intermediate results are computed chunkwise and never allocated at
+       full size.  Arguments must be scalars or have the same shape."""
+    nparams = func.__code__.co_argcount
+    trace = _FuseTrace(nparams)
+    params = [_FuseExpr(trace, ('param', i)) for i in range(nparams)]
+
+    res = func(*params)
+    if not isinstance(res, _FuseExpr) or res._ref[0] != 'op':
+        raise ValueError("fused expression must apply at least one function")
+
+    nin = nparams + len(trace.constants)
+    def slot(ref):
+        kind, i = ref
+        return i if kind == 'param' else \
+               nparams + i if kind == 'const' else nin + i
+
+    ops = [(f,) + tuple(slot(r) for r in refs) for f, refs in trace.ops]
+    if res._ref[1] != len(ops)-1:
+        raise ValueError("result of fused expression must be its last operation")
+
+    fused_func = fused(nin, ops)
+    constants = tuple(trace.constants)
+
+    def call(*args, out=None):
+        return fused_func(*(args + constants), out=out)
+
+    call.__name__ = getattr(func, '__name__', 'fused')
+    call.__doc__ = func.__doc__
+    return call
+
+
 # ==============================================================================
 #                         Numba's GUVectorize on xnd arrays
 # ==============================================================================
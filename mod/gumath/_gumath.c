@@ -68,6 +68,10 @@ static int Gufunc_CheckExact(const PyObject *v);
 static int Gufunc_Check(const PyObject *v);
 static int Gumath_AddFunctions(PyObject *m, const gm_tbl_t *tbl);
 static int Gumath_AddCudaFunctions(PyObject *m, const gm_tbl_t *tbl);
+#ifdef GM_HAVE_VECTORCALL
+static PyObject *gufunc_vectorcall(PyObject *self, PyObject *const *args,
+                                   size_t nargsf, PyObject *kwnames);
+#endif
 
 
 /* libxnd.so is not linked without at least one xnd symbol. The -no-as-needed
@@ -91,6 +95,19 @@ static PyObject *positional_empty = NULL;
 /* Maximum number of threads */
 static int64_t max_threads = 1;
 
+/* Function tables of all modules, for collecting statistics */
+#define MAX_TABLES 16
+static struct {
+    const gm_tbl_t *tbl;
+    PyObject *module;  /* module name */
+} tables[MAX_TABLES];
+static int ntables = 0;
+
+#ifdef GM_HAVE_VECTORCALL
+/* Keyword arguments of a gufunc call: "out", "dtype", "cls" */
+static PyObject *kwnames_call[3] = {NULL, NULL, NULL};
+#endif
+
 
 /****************************************************************************/
 /*                               Error handling                             */
@@ -122,6 +139,9 @@ gufunc_new(const gm_tbl_t *tbl, const char *name, const uint32_t flags)
 
     self->tbl = tbl;
     self->flags = flags;
+#ifdef GM_HAVE_VECTORCALL
+    self->vectorcall = gufunc_vectorcall;
+#endif
 
     self->name = ndt_strdup(name, &ctx);
     if (self->name == NULL) {
@@ -157,19 +177,10 @@ clear_pystack(PyObject *pystack[], Py_ssize_t len)
 
 static int
 parse_args(PyObject *pystack[NDT_MAX_ARGS], int *py_nin, int *py_nout, int *py_nargs,
-           PyObject *args, PyObject *out)
+           PyObject *const *args, Py_ssize_t nin, PyObject *out)
 {
-    Py_ssize_t nin;
     Py_ssize_t nout;
 
-    if (!args || !PyTuple_Check(args)) {
-        const char *name = args ? Py_TYPE(args)->tp_name : "NULL";
-        PyErr_Format(PyExc_SystemError,
-            "internal error: expected tuple, got '%.200s'", name);
-        return -1;
-    }
-
-    nin = PyTuple_GET_SIZE(args);
     if (nin > NDT_MAX_ARGS) {
         PyErr_Format(PyExc_TypeError,
             "maximum number of arguments is %d, got %n", NDT_MAX_ARGS, nin);
@@ -177,7 +188,7 @@ parse_args(PyObject *pystack[NDT_MAX_ARGS], int *py_nin, int *py_nout, int *py_n
     }
 
     for (Py_ssize_t i = 0; i < nin; i++) {
-        PyObject *v = PyTuple_GET_ITEM(args, i);
+        PyObject *v = args[i];
         if (!Xnd_Check(v)) {
             PyErr_Format(PyExc_TypeError,
                 "expected xnd argument, got '%.200s'", Py_TYPE(v)->tp_name);
@@ -238,15 +249,161 @@ parse_args(PyObject *pystack[NDT_MAX_ARGS], int *py_nin, int *py_nout, int *py_n
     return 0;
 }
 
+/* Elementwise kernels write every element of their outputs. */
+static bool
+is_elementwise(const ndt_apply_spec_t *spec)
+{
+    for (int i = 0; i < spec->nargs; i++) {
+        if (spec->types[i]->ndim != spec->outer_dims) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Allocation flags for an inferred output of type 't'. */
+static uint32_t
+output_flags(const ndt_t *t, uint32_t func_flags, bool elementwise)
+{
+    if (func_flags == GM_CUDA_MANAGED_FUNC) {
+        return XND_CUDA_MANAGED;
+    }
+
+    if (elementwise && !ndt_is_optional(t) && !ndt_subtree_is_optional(t)) {
+        return XND_POOL_DATA|XND_NO_ZERO;
+    }
+
+    return XND_POOL_DATA;
+}
+
+/*
+ * Replace inputs that overlap an explicit 'out' argument by a contiguous
+ * copy.  Inputs that alias an output exactly are left alone if the kernel
+ * is elementwise: each output element only depends on the input elements
+ * at the same position, which are read before they are written.  Returns
+ * the number of copied inputs or -1 on error.
+ */
+static int
+copy_overlapping_inputs(PyObject *pystack[], xnd_t stack[], int nin, int nargs,
+                        bool elementwise, ndt_context_t *ctx)
+{
+    int ncopies = 0;
+
+    for (int i = 0; i < nin; i++) {
+        const XndObject *x = (XndObject *)pystack[i];
+        bool overlap = false;
+
+        for (int k = nin; k < nargs; k++) {
+            const XndObject *y = (XndObject *)pystack[k];
+            const int r = xnd_overlap(&stack[i], &stack[k]);
+
+            if (r == XND_OVERLAP_NONE || (r == XND_OVERLAP_SAME && elementwise)) {
+                continue;
+            }
+
+            /* Non-ndarrays in different memory blocks cannot overlap. */
+            if (x->mblock != y->mblock &&
+                !(ndt_is_ndarray(stack[i].type) && ndt_is_ndarray(stack[k].type))) {
+                continue;
+            }
+
+            overlap = true;
+            break;
+        }
+
+        if (overlap) {
+            const uint32_t flags = x->mblock->xnd->flags;
+            const ndt_t *t;
+            PyObject *copy;
+            xnd_t dest;
+
+            t = ndt_copy_contiguous(stack[i].type, stack[i].index, ctx);
+            if (t == NULL) {
+                return -1;
+            }
+
+            copy = Xnd_EmptyFromType(Py_TYPE(x), t, flags&XND_CUDA_MANAGED);
+            ndt_decref(t);
+            if (copy == NULL) {
+                return -1;
+            }
+
+            dest = *CONST_XND(copy);
+            if (xnd_copy(&dest, &stack[i], flags, ctx) < 0) {
+                Py_DECREF(copy);
+                return -1;
+            }
+
+            Py_SETREF(pystack[i], copy);
+            stack[i] = *CONST_XND(copy);
+            ncopies++;
+        }
+    }
+
+    return ncopies;
+}
+
+/*
+ * Pointer dtypes (string, bytes, ref, ...) point to memory that a concurrent
+ * __setitem__ frees, so kernels on such arguments must run with the GIL held.
+ */
+static bool
+pointer_free(const ndt_apply_spec_t *spec)
+{
+    for (int i = 0; i < spec->nargs; i++) {
+        if (!ndt_is_pointer_free(ndt_dtype(spec->types[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Kernels with floating point arguments expect round-to-nearest. */
+static bool
+needs_rounding(const ndt_apply_spec_t *spec)
+{
+    for (int i = 0; i < spec->nargs; i++) {
+        const ndt_t *dtype = ndt_dtype(spec->types[i]);
+        if (dtype->tag != Bool && !ndt_is_signed(dtype) &&
+            !ndt_is_unsigned(dtype)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* fesetround() is expensive compared to a small kernel, only call it if
+   the mode actually has to change.  Returns the mode to be restored. */
+static inline int
+set_rounding(bool needed)
+{
+    if (needed) {
+        const int rounding = fegetround();
+        if (rounding != FE_TONEAREST) {
+            fesetround(FE_TONEAREST);
+        }
+        return rounding;
+    }
+
+    return FE_TONEAREST;
+}
+
+static inline void
+restore_rounding(int rounding)
+{
+    if (rounding != FE_TONEAREST) {
+        fesetround(rounding);
+    }
+}
+
 static PyObject *
-_gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
+_gufunc_call(GufuncObject *self, PyObject *const *args, Py_ssize_t py_nin,
+             PyObject *out, PyObject *dt, PyObject *cls,
              bool enable_threads, bool check_broadcast)
 {
-    static char *kwlist[] = {"out", "dtype", "cls", NULL};
-    PyObject *out = Py_None;
-    PyObject *dt = Py_None;
-    PyObject *cls = Py_None;
-
     NDT_STATIC_CONTEXT(ctx);
     PyObject *pystack[NDT_MAX_ARGS];
     xnd_t stack[NDT_MAX_ARGS];
@@ -259,11 +416,6 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
     int nin, nout, nargs;
     int k;
 
-    if (!PyArg_ParseTupleAndKeywords(positional_empty, kwargs, "|$OOO", kwlist,
-                                     &out, &dt, &cls)) {
-        return NULL;
-    }
-
     out = out == Py_None ? NULL : out;
     dt = dt == Py_None ? NULL : dt;
     cls = cls == Py_None ? (PyObject *)xnd : cls;
@@ -290,7 +442,7 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
         return NULL;
     }
 
-    if (parse_args(pystack, &nin, &nout, &nargs, args, out) < 0) {
+    if (parse_args(pystack, &nin, &nout, &nargs, args, py_nin, out) < 0) {
         return NULL;
     }
     assert(nout == 0 || dtype == NULL);
@@ -359,9 +511,10 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
 
     if (nout == 0) {
         /* 'out' types have been inferred, create new XndObjects. */
+        const bool elementwise = is_elementwise(&spec);
         for (int i = 0; i < spec.nout; i++) {
             if (ndt_is_concrete(spec.types[nin+i])) {
-                uint32_t flags = self->flags == GM_CUDA_MANAGED_FUNC ? XND_CUDA_MANAGED : 0;
+                uint32_t flags = output_flags(spec.types[nin+i], self->flags, elementwise);
                 PyObject *x = Xnd_EmptyFromType((PyTypeObject *)cls, spec.types[nin+i], flags);
                 if (x == NULL) {
                     clear_pystack(pystack, nin+i);
@@ -380,6 +533,45 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
             }
         }
     }
+    else {
+        /* 'out' has been passed explicitly and may alias an input. */
+        const int ncopies = copy_overlapping_inputs(pystack, stack, spec.nin,
+                                                    spec.nargs,
+                                                    is_elementwise(&spec), &ctx);
+        if (ncopies < 0) {
+            clear_pystack(pystack, spec.nargs);
+            ndt_apply_spec_clear(&spec);
+            if (ndt_err_occurred(&ctx)) {
+                return seterr(&ctx);
+            }
+            return NULL;
+        }
+
+        /*
+         * The copies are C-contiguous, so the loop order and the kernel
+         * selected for the original layout may no longer apply.
+         */
+        if (ncopies > 0) {
+            ndt_apply_spec_clear(&spec);
+
+            for (k = 0; k < nargs; k++) {
+                stack[k] = *CONST_XND(pystack[k]);
+                types[k] = stack[k].type;
+                li[k] = stack[k].index;
+            }
+
+            kernel = gm_select(&spec, self->tbl, self->name, types, li, nin,
+                               nout, check_broadcast, stack, &ctx);
+            if (kernel.set == NULL) {
+                clear_pystack(pystack, nargs);
+                return seterr(&ctx);
+            }
+
+            for (int i = 0; i < spec.nargs; i++) {
+                stack[i].type = spec.types[i];
+            }
+        }
+    }
 
     if (self->flags == GM_CUDA_MANAGED_FUNC) {
     #if HAVE_CUDA
@@ -407,34 +599,40 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
     #endif
     }
     else {
+        /*
+         * The kernel runs without the GIL if all arguments are pointer-free.
+         * 'pystack' owns references to all arguments, so their memory blocks
+         * and types stay valid.  Concurrent writes to the same fixed-size
+         * data from other threads are not synchronized: the affected elements
+         * then have unspecified values.  gm_select() runs with the GIL held
+         * because the function table can be extended at runtime.
+         */
+        const bool release_gil = pointer_free(&spec);
+        PyThreadState *save = NULL;
+        int ret;
+
+        const int rounding = set_rounding(needs_rounding(&spec));
+
+        if (release_gil) {
+            save = PyEval_SaveThread();
+        }
     #ifdef HAVE_PTHREAD_H
-        const int rounding = fegetround();
-        fesetround(FE_TONEAREST);
-
         const int64_t N = enable_threads ? max_threads : 1;
-        const int ret = gm_apply_thread(&kernel, stack, spec.outer_dims, N,
-                                        &ctx);
-        fesetround(rounding);
-
-        if (ret < 0) {
-            clear_pystack(pystack, spec.nargs);
-            ndt_apply_spec_clear(&spec);
-            return seterr(&ctx);
-        }
+        ret = gm_apply_thread(&kernel, stack, spec.outer_dims, N, &ctx);
     #else
-        const int rounding = fegetround();
-        fesetround(FE_TONEAREST);
-
-        const int ret = gm_apply(&kernel, stack, spec.outer_dims, &ctx);
+        ret = gm_apply(&kernel, stack, spec.outer_dims, &ctx);
+    #endif
+        if (release_gil) {
+            PyEval_RestoreThread(save);
+        }
 
-        fesetround(rounding);
+        restore_rounding(rounding);
 
         if (ret < 0) {
             clear_pystack(pystack, spec.nargs);
             ndt_apply_spec_clear(&spec);
             return seterr(&ctx);
         }
-    #endif
     }
 
     nin = spec.nin;
@@ -468,8 +666,74 @@ _gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs,
 static PyObject *
 gufunc_call(GufuncObject *self, PyObject *args, PyObject *kwargs)
 {
-    return _gufunc_call(self, args, kwargs, true, true);
+    static char *kwlist[] = {"out", "dtype", "cls", NULL};
+    PyObject *out = Py_None;
+    PyObject *dt = Py_None;
+    PyObject *cls = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(positional_empty, kwargs, "|$OOO", kwlist,
+                                     &out, &dt, &cls)) {
+        return NULL;
+    }
+
+    return _gufunc_call(self, &PyTuple_GET_ITEM(args, 0), PyTuple_GET_SIZE(args),
+                        out, dt, cls, true, true);
+}
+
+#ifdef GM_HAVE_VECTORCALL
+/* Keyword-only arguments of a vectorcall, without creating a dict. */
+static int
+parse_kwnames(PyObject *kwvalues[], PyObject *const *kwargs, PyObject *kwnames,
+              const char *fname, PyObject *names[], int nnames)
+{
+    const Py_ssize_t nkw = kwnames == NULL ? 0 : PyTuple_GET_SIZE(kwnames);
+
+    for (Py_ssize_t i = 0; i < nkw; i++) {
+        PyObject *key = PyTuple_GET_ITEM(kwnames, i);
+        int k;
+
+        for (k = 0; k < nnames; k++) {
+            if (key == names[k]) {
+                break;
+            }
+        }
+
+        if (k == nnames) {
+            for (k = 0; k < nnames; k++) {
+                if (PyUnicode_Compare(key, names[k]) == 0) {
+                    break;
+                }
+            }
+        }
+
+        if (k == nnames) {
+            PyErr_Format(PyExc_TypeError,
+                "%s() got an unexpected keyword argument '%S'", fname, key);
+            return -1;
+        }
+
+        kwvalues[k] = kwargs[i];
+    }
+
+    return 0;
+}
+
+static PyObject *
+gufunc_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf,
+                  PyObject *kwnames)
+{
+    PyObject *kwvalues[3] = {Py_None, Py_None, Py_None};
+    const Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+
+    if (kwnames != NULL &&
+        parse_kwnames(kwvalues, args+nargs, kwnames, "gufunc", kwnames_call, 3) < 0) {
+        return NULL;
+    }
+
+    return _gufunc_call((GufuncObject *)self, args, nargs,
+                        kwvalues[0], kwvalues[1], kwvalues[2], true, true);
 }
+#endif
 
 static PyObject *
 gufunc_getdevice(GufuncObject *self, PyObject *args GM_UNUSED)
@@ -537,93 +801,684 @@ gufunc_getkernels(GufuncObject *self, PyObject *args GM_UNUSED)
 }
 
 
-static PyGetSetDef gufunc_getsets [] =
-{
-  { "device", (getter)gufunc_getdevice, NULL, NULL, NULL},
-  { "identity", (getter)gufunc_getidentity, (setter)gufunc_setidentity, NULL, NULL},
-  { "kernels", (getter)gufunc_getkernels, NULL, NULL, NULL},
-  { NULL, NULL, NULL, NULL, NULL }
-};
-
-
-static PyTypeObject Gufunc_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "_gumath.gufunc",
-    .tp_basicsize = sizeof(GufuncObject),
-    .tp_dealloc = (destructor)gufunc_dealloc,
-    .tp_hash = PyObject_HashNotImplemented,
-    .tp_call = (ternaryfunc)gufunc_call,
-    .tp_getattro = PyObject_GenericGetAttr,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_getset = gufunc_getsets
-};
-
-
 /****************************************************************************/
-/*                                   C-API                                  */
+/*                              Bound functions                             */
 /****************************************************************************/
 
-struct map_args {
-    PyObject *module;
-    const gm_tbl_t *tbl;
-};
+/*
+ * A call plan for fixed input types: f.bind(*types) runs the kernel selection
+ * once.  Calls then only compare the argument types against the bound types,
+ * allocate the outputs and apply the kernel.
+ */
+typedef struct {
+    PyObject_HEAD
+#ifdef GM_HAVE_VECTORCALL
+    vectorcallfunc vectorcall;
+#endif
+    GufuncObject *func;
+    PyObject *cls;                 /* type of the outputs */
+    PyObject *in;                  /* tuple of bound input types */
+    gm_kernel_t kernel;
+    ndt_apply_spec_t spec;         /* types after broadcasting */
+    uint32_t flags[NDT_MAX_ARGS];  /* output allocation flags */
+    bool rounding;
+    bool release_gil;              /* all dtypes are pointer-free */
+} BoundObject;
 
-static int
-Gufunc_CheckExact(const PyObject *v)
-{
-    return Py_TYPE(v) == &Gufunc_Type;
-}
+static PyTypeObject Bound_Type;
 
-static int
-Gufunc_Check(const PyObject *v)
+static void
+bound_dealloc(BoundObject *self)
 {
-    return PyObject_TypeCheck(v, &Gufunc_Type);
+    ndt_apply_spec_clear(&self->spec);
+    Py_XDECREF(self->in);
+    Py_XDECREF(self->cls);
+    Py_XDECREF(self->func);
+    PyObject_Del(self);
 }
 
-static int
-add_function(const gm_func_t *f, void *args)
+static PyObject *
+bound_call_stack(BoundObject *self, PyObject *const *args, Py_ssize_t nargs)
 {
-    struct map_args *a = (struct map_args *)args;
-    PyObject *func;
+    NDT_STATIC_CONTEXT(ctx);
+    const ndt_apply_spec_t *spec = &self->spec;
+    PyObject *pystack[NDT_MAX_ARGS];
+    xnd_t stack[NDT_MAX_ARGS];
+    int i, ret;
 
-    func = gufunc_new(a->tbl, f->name, GM_CPU_FUNC);
-    if (func == NULL) {
-        return -1;
+    if (nargs != spec->nin) {
+        PyErr_Format(PyExc_TypeError,
+            "bound function takes %d arguments, got %zd", spec->nin, nargs);
+        return NULL;
     }
 
-    return PyModule_AddObject(a->module, f->name, func);
-}
+    for (i = 0; i < spec->nin; i++) {
+        const ndt_t *t = NDT(PyTuple_GET_ITEM(self->in, i));
+        PyObject *v = args[i];
 
-static int
-Gumath_AddFunctions(PyObject *m, const gm_tbl_t *tbl)
-{
-    struct map_args args = {m, tbl};
+        if (!Xnd_Check(v)) {
+            PyErr_Format(PyExc_TypeError,
+                "expected xnd argument, got '%.200s'", Py_TYPE(v)->tp_name);
+            return NULL;
+        }
 
-    if (gm_tbl_map(tbl, add_function, &args) < 0) {
-        return -1;
+        stack[i] = *CONST_XND(v);
+        if (stack[i].type != t && !ndt_equal(stack[i].type, t)) {
+            PyErr_Format(PyExc_TypeError,
+                "argument %d does not have the bound type", i);
+            return NULL;
+        }
+        stack[i].type = spec->types[i];
     }
 
-    return 0;
-}
-
-static int
-add_cuda_function(const gm_func_t *f, void *args)
-{
-    struct map_args *a = (struct map_args *)args;
-    PyObject *func;
+    for (i = 0; i < spec->nout; i++) {
+        PyObject *x = Xnd_EmptyFromType((PyTypeObject *)self->cls,
+                                        spec->types[spec->nin+i],
+                                        self->flags[i]);
+        if (x == NULL) {
+            clear_pystack(pystack, i);
+            return NULL;
+        }
+        pystack[i] = x;
+        stack[spec->nin+i] = *CONST_XND(x);
+    }
 
-    func = gufunc_new(a->tbl, f->name, GM_CUDA_MANAGED_FUNC);
-    if (func == NULL) {
-        return -1;
+    /*
+     * The arguments are kept alive by the caller.  As in _gufunc_call(),
+     * kernels on pointer dtypes run with the GIL held.
+     */
+    PyThreadState *save = NULL;
+    const int rounding = set_rounding(self->rounding);
+    if (self->release_gil) {
+        save = PyEval_SaveThread();
+    }
+#ifdef HAVE_PTHREAD_H
+    ret = gm_apply_thread(&self->kernel, stack, spec->outer_dims, max_threads, &ctx);
+#else
+    ret = gm_apply(&self->kernel, stack, spec->outer_dims, &ctx);
+#endif
+    if (self->release_gil) {
+        PyEval_RestoreThread(save);
     }
+    restore_rounding(rounding);
 
-    return PyModule_AddObject(a->module, f->name, func);
-}
+    if (ret < 0) {
+        clear_pystack(pystack, spec->nout);
+        return seterr(&ctx);
+    }
 
-static int
-Gumath_AddCudaFunctions(PyObject *m, const gm_tbl_t *tbl)
-{
+    switch (spec->nout) {
+    case 0: {
+        Py_RETURN_NONE;
+    }
+    case 1: {
+        return pystack[0];
+    }
+    default: {
+        PyObject *tuple = PyTuple_New(spec->nout);
+        if (tuple == NULL) {
+            clear_pystack(pystack, spec->nout);
+            return NULL;
+        }
+        for (i = 0; i < spec->nout; i++) {
+            PyTuple_SET_ITEM(tuple, i, pystack[i]);
+        }
+        return tuple;
+      }
+    }
+}
+
+static PyObject *
+bound_call(BoundObject *self, PyObject *args, PyObject *kwargs)
+{
+    if (kwargs != NULL && PyDict_GET_SIZE(kwargs) > 0) {
+        PyErr_SetString(PyExc_TypeError,
+            "bound function does not take keyword arguments");
+        return NULL;
+    }
+
+    return bound_call_stack(self, &PyTuple_GET_ITEM(args, 0),
+                            PyTuple_GET_SIZE(args));
+}
+
+#ifdef GM_HAVE_VECTORCALL
+static PyObject *
+bound_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf,
+                 PyObject *kwnames)
+{
+    if (kwnames != NULL && PyTuple_GET_SIZE(kwnames) > 0) {
+        PyErr_SetString(PyExc_TypeError,
+            "bound function does not take keyword arguments");
+        return NULL;
+    }
+
+    return bound_call_stack((BoundObject *)self, args, PyVectorcall_NARGS(nargsf));
+}
+#endif
+
+static PyObject *
+gufunc_bind(GufuncObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = {"cls", NULL};
+    NDT_STATIC_CONTEXT(ctx);
+    PyObject *cls = Py_None;
+    const ndt_t *types[NDT_MAX_ARGS];
+    int64_t li[NDT_MAX_ARGS] = {0};
+    const gm_func_t *f;
+    BoundObject *bound;
+    Py_ssize_t nin, i;
+    int k;
+
+    if (!PyArg_ParseTupleAndKeywords(positional_empty, kwargs, "|$O", kwlist,
+                                     &cls)) {
+        return NULL;
+    }
+
+    cls = cls == Py_None ? (PyObject *)xnd : cls;
+    if (!PyType_Check(cls) || !PyType_IsSubtype((PyTypeObject *)cls, xnd)) {
+        PyErr_SetString(PyExc_TypeError,
+            "the 'cls' argument must be a subtype of 'xnd'");
+        return NULL;
+    }
+
+    if (self->flags & GM_CUDA_MANAGED_FUNC) {
+        PyErr_SetString(PyExc_NotImplementedError,
+            "bind() is not supported for cuda functions");
+        return NULL;
+    }
+
+    nin = PyTuple_GET_SIZE(args);
+    if (nin > NDT_MAX_ARGS) {
+        PyErr_Format(PyExc_TypeError,
+            "maximum number of arguments is %d, got %n", NDT_MAX_ARGS, nin);
+        return NULL;
+    }
+
+    bound = PyObject_New(BoundObject, &Bound_Type);
+    if (bound == NULL) {
+        return NULL;
+    }
+#ifdef GM_HAVE_VECTORCALL
+    bound->vectorcall = bound_vectorcall;
+#endif
+    bound->spec = ndt_apply_spec_empty;
+    Py_INCREF(self);
+    bound->func = self;
+    Py_INCREF(cls);
+    bound->cls = cls;
+
+    bound->in = PyTuple_New(nin);
+    if (bound->in == NULL) {
+        Py_DECREF(bound);
+        return NULL;
+    }
+
+    for (i = 0; i < nin; i++) {
+        PyObject *t = Ndt_FromObject(PyTuple_GET_ITEM(args, i));
+        if (t == NULL) {
+            Py_DECREF(bound);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(bound->in, i, t);
+
+        types[i] = NDT(t);
+        if (!ndt_is_concrete(types[i]) || !ndt_is_ndarray(types[i])) {
+            PyErr_SetString(PyExc_ValueError,
+                "bind() requires concrete types with fixed dimensions");
+            Py_DECREF(bound);
+            return NULL;
+        }
+    }
+
+    /* Constraints may depend on the argument values. */
+    f = gm_tbl_find(self->tbl, self->name, &ctx);
+    if (f == NULL) {
+        Py_DECREF(bound);
+        return seterr(&ctx);
+    }
+    for (k = 0; k < f->nkernels; k++) {
+        if (f->kernels[k].constraint != NULL) {
+            PyErr_SetString(PyExc_ValueError,
+                "bind() does not support functions with constraints");
+            Py_DECREF(bound);
+            return NULL;
+        }
+    }
+
+    bound->kernel = gm_select(&bound->spec, self->tbl, self->name, types, li,
+                              (int)nin, 0, false, NULL, &ctx);
+    if (bound->kernel.set == NULL) {
+        Py_DECREF(bound);
+        return seterr(&ctx);
+    }
+
+    const bool elementwise = is_elementwise(&bound->spec);
+    for (i = 0; i < bound->spec.nout; i++) {
+        const ndt_t *t = bound->spec.types[nin+i];
+        if (!ndt_is_concrete(t)) {
+            PyErr_SetString(PyExc_ValueError,
+                "arguments with abstract types are temporarily disabled");
+            Py_DECREF(bound);
+            return NULL;
+        }
+        bound->flags[i] = output_flags(t, self->flags, elementwise);
+    }
+    bound->rounding = needs_rounding(&bound->spec);
+    bound->release_gil = pointer_free(&bound->spec);
+
+    return (PyObject *)bound;
+}
+
+static PyObject *
+bound_getfunc(BoundObject *self, PyObject *args GM_UNUSED)
+{
+    Py_INCREF(self->func);
+    return (PyObject *)self->func;
+}
+
+static PyObject *
+bound_gettypes(BoundObject *self, PyObject *args GM_UNUSED)
+{
+    Py_INCREF(self->in);
+    return self->in;
+}
+
+static PyGetSetDef bound_getsets [] =
+{
+  { "func", (getter)bound_getfunc, NULL, NULL, NULL},
+  { "types", (getter)bound_gettypes, NULL, NULL, NULL},
+  { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject Bound_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_gumath.bound",
+    .tp_basicsize = sizeof(BoundObject),
+    .tp_dealloc = (destructor)bound_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_call = (ternaryfunc)bound_call,
+    .tp_getattro = PyObject_GenericGetAttr,
+#ifdef GM_HAVE_VECTORCALL
+    .tp_vectorcall_offset = offsetof(BoundObject, vectorcall),
+    .tp_flags = Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_VECTORCALL,
+#else
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+#endif
+    .tp_getset = bound_getsets
+};
+
+
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER) && __GNUC__ >= 8
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+static PyMethodDef gufunc_methods [] =
+{
+  { "bind", (PyCFunction)gufunc_bind, METH_VARARGS|METH_KEYWORDS, NULL },
+  { NULL, NULL, 1, NULL }
+};
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER) && __GNUC__ >= 8
+  #pragma GCC diagnostic pop
+#endif
+
+static PyGetSetDef gufunc_getsets [] =
+{
+  { "device", (getter)gufunc_getdevice, NULL, NULL, NULL},
+  { "identity", (getter)gufunc_getidentity, (setter)gufunc_setidentity, NULL, NULL},
+  { "kernels", (getter)gufunc_getkernels, NULL, NULL, NULL},
+  { NULL, NULL, NULL, NULL, NULL }
+};
+
+
+static PyTypeObject Gufunc_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_gumath.gufunc",
+    .tp_basicsize = sizeof(GufuncObject),
+    .tp_dealloc = (destructor)gufunc_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_call = (ternaryfunc)gufunc_call,
+    .tp_getattro = PyObject_GenericGetAttr,
+#ifdef GM_HAVE_VECTORCALL
+    .tp_vectorcall_offset = offsetof(GufuncObject, vectorcall),
+    .tp_flags = Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_VECTORCALL,
+#else
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+#endif
+    .tp_methods = gufunc_methods,
+    .tp_getset = gufunc_getsets
+};
+
+
+/****************************************************************************/
+/*                          Fused expression object                         */
+/****************************************************************************/
+
+typedef struct {
+    PyObject_HEAD
+    gm_fuse_t *fuse;
+    int nin;
+    PyObject *funcs;   /* gufuncs of the expression */
+} FusedObject;
+
+static PyTypeObject Fused_Type;
+
+static PyObject *
+fused_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"nin", "ops", NULL};
+    NDT_STATIC_CONTEXT(ctx);
+    int cargs[GM_FUSE_MAX_OP_ARGS];
+    const gm_tbl_t *tbl = NULL;
+    FusedObject *self;
+    PyObject *ops;
+    Py_ssize_t n;
+    int nin;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO!", kwlist, &nin,
+                                     &PyList_Type, &ops)) {
+        return NULL;
+    }
+
+    n = PyList_GET_SIZE(ops);
+    if (n == 0) {
+        PyErr_SetString(PyExc_ValueError, "fused expression is empty");
+        return NULL;
+    }
+
+    for (Py_ssize_t k = 0; k < n; k++) {
+        PyObject *op = PyList_GET_ITEM(ops, k);
+        GufuncObject *f;
+
+        if (!PyTuple_Check(op) || PyTuple_GET_SIZE(op) < 2 ||
+            !Gufunc_Check(PyTuple_GET_ITEM(op, 0))) {
+            PyErr_SetString(PyExc_TypeError,
+                "fused operations must be tuples (gufunc, arg, ...)");
+            return NULL;
+        }
+
+        f = (GufuncObject *)PyTuple_GET_ITEM(op, 0);
+        if (!(f->flags & GM_CPU_FUNC) || (tbl != NULL && f->tbl != tbl)) {
+            PyErr_SetString(PyExc_ValueError,
+                "fused operations must be cpu functions of the same module");
+            return NULL;
+        }
+        tbl = f->tbl;
+    }
+
+    self = (FusedObject *)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->nin = nin;
+    self->funcs = PyList_New(n);
+    if (self->funcs == NULL) {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    self->fuse = gm_fuse_new(tbl, nin, &ctx);
+    if (self->fuse == NULL) {
+        Py_DECREF(self);
+        return seterr(&ctx);
+    }
+
+    for (Py_ssize_t k = 0; k < n; k++) {
+        PyObject *op = PyList_GET_ITEM(ops, k);
+        GufuncObject *f = (GufuncObject *)PyTuple_GET_ITEM(op, 0);
+        const Py_ssize_t nargs = PyTuple_GET_SIZE(op) - 1;
+
+        if (nargs > GM_FUSE_MAX_OP_ARGS) {
+            PyErr_Format(PyExc_ValueError,
+                "fused operations take at most %d arguments",
+                GM_FUSE_MAX_OP_ARGS);
+            Py_DECREF(self);
+            return NULL;
+        }
+
+        for (Py_ssize_t i = 0; i < nargs; i++) {
+            long v = PyLong_AsLong(PyTuple_GET_ITEM(op, i+1));
+            if (v == -1 && PyErr_Occurred()) {
+                Py_DECREF(self);
+                return NULL;
+            }
+            cargs[i] = v < INT_MIN || v > INT_MAX ? -1 : (int)v;
+        }
+
+        if (gm_fuse_add(self->fuse, f->name, cargs, (int)nargs, &ctx) < 0) {
+            Py_DECREF(self);
+            return seterr(&ctx);
+        }
+
+        Py_INCREF(f);
+        PyList_SET_ITEM(self->funcs, k, (PyObject *)f);
+    }
+
+    return (PyObject *)self;
+}
+
+static void
+fused_dealloc(FusedObject *self)
+{
+    gm_fuse_del(self->fuse);
+    Py_XDECREF(self->funcs);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *
+fused_call(FusedObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = {"out", NULL};
+    NDT_STATIC_CONTEXT(ctx);
+    PyObject *pystack[NDT_MAX_ARGS];
+    xnd_t stack[NDT_MAX_ARGS];
+    const ndt_t *types[NDT_MAX_ARGS];
+    PyObject *out = Py_None;
+    int nin, nout, nargs;
+
+    if (!PyArg_ParseTupleAndKeywords(positional_empty, kwargs, "|$O", kwlist,
+                                     &out)) {
+        return NULL;
+    }
+    out = out == Py_None ? NULL : out;
+
+    if (out != NULL && !Xnd_Check(out)) {
+        PyErr_Format(PyExc_TypeError,
+            "'out' argument must be xnd, got '%.200s'", Py_TYPE(out)->tp_name);
+        return NULL;
+    }
+
+    if (parse_args(pystack, &nin, &nout, &nargs, &PyTuple_GET_ITEM(args, 0),
+                   PyTuple_GET_SIZE(args), out) < 0) {
+        return NULL;
+    }
+
+    if (nin != self->nin) {
+        PyErr_Format(PyExc_TypeError,
+            "fused expression takes %d arguments, got %d", self->nin, nin);
+        clear_pystack(pystack, nargs);
+        return NULL;
+    }
+
+    for (int i = 0; i < nargs; i++) {
+        const XndObject *x = (XndObject *)pystack[i];
+        if (x->mblock->xnd->flags&XND_CUDA_MANAGED) {
+            PyErr_SetString(PyExc_ValueError,
+                "fused expressions require xnd objects with cpu memory");
+            clear_pystack(pystack, nargs);
+            return NULL;
+        }
+
+        stack[i] = *CONST_XND(pystack[i]);
+        types[i] = stack[i].type;
+    }
+
+    if (out == NULL) {
+        const ndt_t *t = gm_fuse_typecheck(self->fuse, types, &ctx);
+        if (t == NULL) {
+            clear_pystack(pystack, nargs);
+            return seterr(&ctx);
+        }
+
+        /* The result of the last operation is written to every element. */
+        pystack[nin] = Xnd_EmptyFromType(xnd, t, XND_POOL_DATA|XND_NO_ZERO);
+        ndt_decref(t);
+        if (pystack[nin] == NULL) {
+            clear_pystack(pystack, nargs);
+            return NULL;
+        }
+        stack[nin] = *CONST_XND(pystack[nin]);
+    }
+    else {
+        /* Only the last operation writes to 'out', after reading its inputs. */
+        if (copy_overlapping_inputs(pystack, stack, nin, nargs, true, &ctx) < 0) {
+            clear_pystack(pystack, nargs);
+            if (ndt_err_occurred(&ctx)) {
+                return seterr(&ctx);
+            }
+            return NULL;
+        }
+    }
+
+    const int rounding = set_rounding(true);
+
+    const int ret = gm_fuse_apply(self->fuse, stack, &ctx);
+
+    restore_rounding(rounding);
+
+    clear_pystack(pystack, nin);
+    if (ret < 0) {
+        Py_DECREF(pystack[nin]);
+        return seterr(&ctx);
+    }
+
+    return pystack[nin];
+}
+
+static PyObject *
+fused_getnin(FusedObject *self, PyObject *args GM_UNUSED)
+{
+    return PyLong_FromLong(self->nin);
+}
+
+static PyGetSetDef fused_getsets [] =
+{
+  { "nin", (getter)fused_getnin, NULL, NULL, NULL},
+  { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject Fused_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_gumath.fused",
+    .tp_basicsize = sizeof(FusedObject),
+    .tp_dealloc = (destructor)fused_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_call = (ternaryfunc)fused_call,
+    .tp_getattro = PyObject_GenericGetAttr,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_getset = fused_getsets,
+    .tp_new = fused_new
+};
+
+
+/****************************************************************************/
+/*                                   C-API                                  */
+/****************************************************************************/
+
+struct map_args {
+    PyObject *module;
+    const gm_tbl_t *tbl;
+};
+
+static int
+Gufunc_CheckExact(const PyObject *v)
+{
+    return Py_TYPE(v) == &Gufunc_Type;
+}
+
+static int
+Gufunc_Check(const PyObject *v)
+{
+    return PyObject_TypeCheck(v, &Gufunc_Type);
+}
+
+static int
+add_function(const gm_func_t *f, void *args)
+{
+    struct map_args *a = (struct map_args *)args;
+    PyObject *func;
+
+    func = gufunc_new(a->tbl, f->name, GM_CPU_FUNC);
+    if (func == NULL) {
+        return -1;
+    }
+
+    return PyModule_AddObject(a->module, f->name, func);
+}
+
+static int
+register_table(const char *module, const gm_tbl_t *tbl)
+{
+    for (int i = 0; i < ntables; i++) {
+        if (tables[i].tbl == tbl) {
+            return 0;
+        }
+    }
+
+    if (ntables == MAX_TABLES) {
+        PyErr_SetString(PyExc_RuntimeError, "too many function tables");
+        return -1;
+    }
+
+    tables[ntables].module = PyUnicode_FromString(module);
+    if (tables[ntables].module == NULL) {
+        return -1;
+    }
+    tables[ntables].tbl = tbl;
+    ntables++;
+
+    return 0;
+}
+
+static int
+Gumath_AddFunctions(PyObject *m, const gm_tbl_t *tbl)
+{
+    struct map_args args = {m, tbl};
+    const char *name = PyModule_GetName(m);
+
+    if (name == NULL || register_table(name, tbl) < 0) {
+        return -1;
+    }
+
+    if (gm_tbl_map(tbl, add_function, &args) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+add_cuda_function(const gm_func_t *f, void *args)
+{
+    struct map_args *a = (struct map_args *)args;
+    PyObject *func;
+
+    func = gufunc_new(a->tbl, f->name, GM_CUDA_MANAGED_FUNC);
+    if (func == NULL) {
+        return -1;
+    }
+
+    return PyModule_AddObject(a->module, f->name, func);
+}
+
+static int
+Gumath_AddCudaFunctions(PyObject *m, const gm_tbl_t *tbl)
+{
     struct map_args args = {m, tbl};
+    const char *name = PyModule_GetName(m);
+
+    if (name == NULL || register_table(name, tbl) < 0) {
+        return -1;
+    }
 
     if (gm_tbl_map(tbl, add_cuda_function, &args) < 0) {
         return -1;
@@ -657,9 +1512,7 @@ gufunc_vfold(PyObject *m GM_UNUSED, PyObject *args, PyObject *kwargs)
     static char *kwlist[] = {"f", "acc", NULL};
     PyObject *func = Py_None;
     PyObject *acc = Py_None;
-    PyObject *tuple;
-    PyObject *dict;
-    PyObject *res;
+    PyObject *stack[NDT_MAX_ARGS];
     Py_ssize_t size, i;
     int ret;
 
@@ -682,42 +1535,21 @@ gufunc_vfold(PyObject *m GM_UNUSED, PyObject *args, PyObject *kwargs)
     }
 
     /* Push the accumulator onto the argument stack. */
-    size = PyTuple_Size(args);
-    tuple = PyTuple_New(size+1);
-    if (tuple == NULL) {
+    size = PyTuple_GET_SIZE(args);
+    if (size+1 > NDT_MAX_ARGS) {
+        PyErr_Format(PyExc_TypeError,
+            "maximum number of arguments is %d, got %n", NDT_MAX_ARGS, size+1);
         return NULL;
     }
 
-    Py_INCREF(acc);
-    PyTuple_SET_ITEM(tuple, 0, acc);
+    stack[0] = acc;
     for (i = 0; i < size; i++) {
-        PyObject *v = PyTuple_GET_ITEM(args, i);
-        Py_INCREF(v);
-        PyTuple_SET_ITEM(tuple, i+1, v);
+        stack[i+1] = PyTuple_GET_ITEM(args, i);
     }
 
     /* Simultaneously use the accumulator as the 'out' argument. */
-    dict = PyDict_New();
-    if (dict == NULL) {
-        Py_DECREF(tuple);
-        return NULL;
-    }
-    if (PyDict_SetItemString(dict, "out", acc) < 0) {
-        Py_DECREF(dict);
-        Py_DECREF(tuple);
-        return NULL;
-    }
-    if (PyDict_SetItemString(dict, "cls", (PyObject *)(Py_TYPE(acc))) < 0) {
-        Py_DECREF(dict);
-        Py_DECREF(tuple);
-        return NULL;
-    }
-
-    res = _gufunc_call((GufuncObject *)func, tuple, dict, false, false);
-    Py_DECREF(tuple);
-    Py_DECREF(dict);
-
-    return res;
+    return _gufunc_call((GufuncObject *)func, stack, size+1, acc, Py_None,
+                        (PyObject *)Py_TYPE(acc), false, false);
 }
 
 #if defined(__GNUC__) && !defined(__INTEL_COMPILER)
@@ -728,7 +1560,7 @@ unsafe_add_kernel(PyObject *m GM_UNUSED, PyObject *args, PyObject *kwds)
 {
     NDT_STATIC_CONTEXT(ctx);
     static char *kwlist[] = {"name", "sig", "tag", "ptr", NULL};
-    gm_kernel_init_t k;
+    gm_kernel_init_t k = {0};
     gm_func_t *f;
     char *name;
     char *sig;
@@ -847,6 +1679,278 @@ set_max_threads(PyObject *m UNUSED, PyObject *obj)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+get_block_cache_size(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    return PyLong_FromLongLong(gm_get_block_cache_size());
+}
+
+static PyObject *
+set_block_cache_size(PyObject *m UNUSED, PyObject *obj)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    int64_t n;
+
+    n = PyLong_AsLongLong(obj);
+    if (n == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    if (gm_set_block_cache_size(n, &ctx) < 0) {
+        return seterr(&ctx);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+get_pool_limit(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    return PyLong_FromLongLong(xnd_pool_get_limit());
+}
+
+static PyObject *
+set_pool_limit(PyObject *m UNUSED, PyObject *obj)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    int64_t n;
+
+    n = PyLong_AsLongLong(obj);
+    if (n == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    if (xnd_pool_set_limit(n, &ctx) < 0) {
+        return seterr(&ctx);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+clear_pool(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    xnd_pool_clear();
+    Py_RETURN_NONE;
+}
+
+
+/****************************************************************************/
+/*                                Statistics                                */
+/****************************************************************************/
+
+static PyObject *
+get_stats_enabled(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    return PyBool_FromLong(gm_stats_enabled());
+}
+
+static PyObject *
+set_stats_enabled(PyObject *m UNUSED, PyObject *obj)
+{
+    int enable = PyObject_IsTrue(obj);
+
+    if (enable < 0) {
+        return NULL;
+    }
+
+    gm_stats_enable(enable);
+
+    Py_RETURN_NONE;
+}
+
+static int
+set_int64(PyObject *dict, const char *key, int64_t v)
+{
+    PyObject *value = PyLong_FromLongLong(v);
+    int ret;
+
+    if (value == NULL) {
+        return -1;
+    }
+
+    ret = PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+    return ret;
+}
+
+static PyObject *
+func_stats(const gm_stats_t *s)
+{
+    PyObject *res, *reasons, *kernels;
+
+    res = PyDict_New();
+    if (res == NULL) {
+        return NULL;
+    }
+
+    if (set_int64(res, "selects", s->selects) < 0 ||
+        set_int64(res, "typecheck_ns", s->typecheck_ns) < 0 ||
+        set_int64(res, "select_ns", s->select_ns) < 0) {
+        goto error;
+    }
+
+    reasons = PyDict_New();
+    if (reasons == NULL || PyDict_SetItemString(res, "reasons", reasons) < 0) {
+        Py_XDECREF(reasons);
+        goto error;
+    }
+    Py_DECREF(reasons);
+
+    for (int i = 0; i < GM_NUM_REASONS; i++) {
+        if (s->reasons[i] != 0 &&
+            set_int64(reasons, gm_stats_reason_name(i), s->reasons[i]) < 0) {
+            goto error;
+        }
+    }
+
+    kernels = PyDict_New();
+    if (kernels == NULL || PyDict_SetItemString(res, "kernels", kernels) < 0) {
+        Py_XDECREF(kernels);
+        goto error;
+    }
+    Py_DECREF(kernels);
+
+    for (int i = 0; i < GM_NUM_SLOTS; i++) {
+        const gm_slot_stats_t *slot = &s->slots[i];
+        PyObject *k;
+
+        if (slot->calls == 0) {
+            continue;
+        }
+
+        k = PyDict_New();
+        if (k == NULL ||
+            PyDict_SetItemString(kernels, gm_stats_slot_name(i), k) < 0) {
+            Py_XDECREF(k);
+            goto error;
+        }
+        Py_DECREF(k);
+
+        if (set_int64(k, "calls", slot->calls) < 0 ||
+            set_int64(k, "threaded", slot->threaded) < 0 ||
+            set_int64(k, "bytes", slot->bytes) < 0 ||
+            set_int64(k, "kernel_ns", slot->kernel_ns) < 0) {
+            goto error;
+        }
+    }
+
+    return res;
+
+error:
+    Py_DECREF(res);
+    return NULL;
+}
+
+struct stats_args {
+    PyObject *dict;
+    PyObject *module;
+};
+
+static int
+add_stats(const gm_func_t *f, void *args)
+{
+    struct stats_args *a = (struct stats_args *)args;
+    PyObject *key, *value;
+    gm_stats_t s;
+    bool used;
+    int ret;
+
+    gm_stats_get(&s, f);
+
+    used = s.selects > 0;
+    for (int i = 0; i < GM_NUM_SLOTS; i++) {
+        used |= s.slots[i].calls > 0;
+    }
+    if (!used) {
+        return 0;
+    }
+
+    key = PyUnicode_FromFormat("%U.%s", a->module, f->name);
+    if (key == NULL) {
+        return -1;
+    }
+
+    value = func_stats(&s);
+    if (value == NULL) {
+        Py_DECREF(key);
+        return -1;
+    }
+
+    ret = PyDict_SetItem(a->dict, key, value);
+    Py_DECREF(key);
+    Py_DECREF(value);
+    return ret;
+}
+
+static PyObject *
+stats(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    struct stats_args a;
+
+    a.dict = PyDict_New();
+    if (a.dict == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < ntables; i++) {
+        a.module = tables[i].module;
+        if (gm_tbl_map(tables[i].tbl, add_stats, &a) < 0) {
+            Py_DECREF(a.dict);
+            return NULL;
+        }
+    }
+
+    return a.dict;
+}
+
+static PyObject *
+clear_stats(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    for (int i = 0; i < ntables; i++) {
+        gm_stats_reset(tables[i].tbl);
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+/****************************************************************************/
+/*                                  Tracing                                 */
+/****************************************************************************/
+
+static PyObject *
+start_trace(PyObject *m UNUSED, PyObject *obj)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    PyObject *path;
+    int ret;
+
+    if (!PyUnicode_FSConverter(obj, &path)) {
+        return NULL;
+    }
+
+    ret = gm_trace_chrome_start(PyBytes_AS_STRING(path), &ctx);
+    Py_DECREF(path);
+    if (ret < 0) {
+        return seterr(&ctx);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+stop_trace(PyObject *m UNUSED, PyObject *args UNUSED)
+{
+    NDT_STATIC_CONTEXT(ctx);
+
+    if (gm_trace_chrome_stop(&ctx) < 0) {
+        return seterr(&ctx);
+    }
+
+    Py_RETURN_NONE;
+}
+
 
 #if defined(__GNUC__) && !defined(__INTEL_COMPILER) && __GNUC__ >= 8
   #pragma GCC diagnostic push
@@ -859,6 +1963,17 @@ static PyMethodDef gumath_methods [] =
   { "unsafe_add_kernel", (PyCFunction)unsafe_add_kernel, METH_VARARGS|METH_KEYWORDS, NULL },
   { "get_max_threads", (PyCFunction)get_max_threads, METH_NOARGS, NULL },
   { "set_max_threads", (PyCFunction)set_max_threads, METH_O, NULL },
+  { "get_block_cache_size", (PyCFunction)get_block_cache_size, METH_NOARGS, NULL },
+  { "set_block_cache_size", (PyCFunction)set_block_cache_size, METH_O, NULL },
+  { "get_pool_limit", (PyCFunction)get_pool_limit, METH_NOARGS, NULL },
+  { "set_pool_limit", (PyCFunction)set_pool_limit, METH_O, NULL },
+  { "clear_pool", (PyCFunction)clear_pool, METH_NOARGS, NULL },
+  { "get_stats_enabled", (PyCFunction)get_stats_enabled, METH_NOARGS, NULL },
+  { "set_stats_enabled", (PyCFunction)set_stats_enabled, METH_O, NULL },
+  { "stats", (PyCFunction)stats, METH_NOARGS, NULL },
+  { "clear_stats", (PyCFunction)clear_stats, METH_NOARGS, NULL },
+  { "start_trace", (PyCFunction)start_trace, METH_O, NULL },
+  { "stop_trace", (PyCFunction)stop_trace, METH_NOARGS, NULL },
   { NULL, NULL, 1, NULL }
 };
 #if defined(__GNUC__) && !defined(__INTEL_COMPILER) && __GNUC__ >= 8
@@ -909,6 +2024,10 @@ PyInit__gumath(void)
            return seterr(&ctx);
        }
 
+       if (register_table("gumath", table) < 0) {
+           return NULL;
+       }
+
        init_max_threads();
 
        initialized = 1;
@@ -918,6 +2037,26 @@ PyInit__gumath(void)
         return NULL;
     }
 
+    if (PyType_Ready(&Fused_Type) < 0) {
+        return NULL;
+    }
+
+    if (PyType_Ready(&Bound_Type) < 0) {
+        return NULL;
+    }
+
+#ifdef GM_HAVE_VECTORCALL
+    if (kwnames_call[0] == NULL) {
+        kwnames_call[0] = PyUnicode_InternFromString("out");
+        kwnames_call[1] = PyUnicode_InternFromString("dtype");
+        kwnames_call[2] = PyUnicode_InternFromString("cls");
+        if (kwnames_call[0] == NULL || kwnames_call[1] == NULL ||
+            kwnames_call[2] == NULL) {
+            return NULL;
+        }
+    }
+#endif
+
     xnd = Xnd_GetType();
     if (xnd == NULL) {
         goto error;
@@ -938,6 +2077,16 @@ PyInit__gumath(void)
         goto error;
     }
 
+    Py_INCREF(&Fused_Type);
+    if (PyModule_AddObject(m, "fused", (PyObject *)&Fused_Type) < 0) {
+        goto error;
+    }
+
+    Py_INCREF(&Bound_Type);
+    if (PyModule_AddObject(m, "bound", (PyObject *)&Bound_Type) < 0) {
+        goto error;
+    }
+
     Py_INCREF(capsule);
     if (PyModule_AddObject(m, "_API", capsule) < 0) {
         goto error;
@@ -78,6 +78,10 @@ extern "C" {
 
 #define GM_MAX_KERNELS 8192
 #define GM_THREAD_CUTOFF 1000000
+#define GM_BLOCK_CACHE_SIZE 32768 /* default cache budget for blocked loops */
+#define GM_FUSE_MAX_OPS 64
+#define GM_FUSE_MAX_OP_ARGS 4
+#define GM_FUSE_CACHE_FACTOR 8     /* chunks of fused expressions use 8 * cache budget */
 
 typedef float float32_t;
 typedef double float64_t;
@@ -98,6 +102,8 @@ typedef int (* gm_strided_kernel_t)(char **args, intptr_t *dimensions, intptr_t
 typedef struct {
     const ndt_t *sig;
     const ndt_constraint_t *constraint;
+    ndt_matcher_t *matcher;  /* 'sig' compiled for type checking, NULL if
+                                the function has a custom typecheck */
 
     /* Xnd signatures */
     gm_xnd_kernel_t OptC;    /* C in inner+1 dimensions */
@@ -135,14 +141,59 @@ typedef struct {
     gm_strided_kernel_t Strided;
 } gm_kernel_init_t;
 
+/* Kernel slots in the order of preference used by gm_select() */
+enum gm_stats_slot {
+  GM_SLOT_OPTC,
+  GM_SLOT_OPTZ,
+  GM_SLOT_OPTS,
+  GM_SLOT_C,
+  GM_SLOT_FORTRAN,
+  GM_SLOT_STRIDED,
+  GM_SLOT_XND,
+  GM_NUM_SLOTS
+};
+
+/* Reasons for not taking the fastest path */
+enum gm_stats_reason {
+  GM_REASON_LAYOUT,      /* the argument layout requires a slower kernel */
+  GM_REASON_MISSING,     /* a faster kernel for the layout is not implemented */
+  GM_REASON_NO_MATCH,    /* no kernel matches the input types */
+  GM_REASON_ONE_THREAD,  /* serial: a single thread was requested */
+  GM_REASON_SMALL,       /* serial: fewer than GM_THREAD_CUTOFF elements */
+  GM_REASON_NOT_NDARRAY, /* serial: no ndarray arguments or no outer dimensions */
+  GM_NUM_REASONS
+};
+
+typedef struct {
+    int64_t calls;     /* kernel applications */
+    int64_t threaded;  /* applications split across threads */
+    int64_t bytes;     /* bytes of all arguments */
+    int64_t kernel_ns; /* time spent in the kernel */
+} gm_slot_stats_t;
+
+/* Per-function statistics, collected if enabled by gm_stats_enable() */
+typedef struct {
+    int64_t selects;      /* calls to gm_select() */
+    int64_t typecheck_ns; /* time spent in type checking */
+    int64_t select_ns;    /* time spent in choosing a kernel slot */
+    int64_t reasons[GM_NUM_REASONS];
+    gm_slot_stats_t slots[GM_NUM_SLOTS];
+} gm_stats_t;
+
 /* Actual kernel selected for application */
 typedef struct {
     uint32_t flag;
     const gm_kernel_set_t *set;
+    int nperm;                /* outer loop order, see ndt_apply_spec_t */
+    uint8_t perm[NDT_MAX_DIM]; /* only the first nperm entries are set */
+    int64_t block;            /* tile size for conflicting strides, 0 if unused */
+    gm_stats_t *stats;        /* statistics of the function, may be NULL */
+    const char *name;         /* function name for tracing, may be NULL */
 } gm_kernel_t;
 
 /* Multimethod with associated kernels */
 typedef struct gm_func gm_func_t;
+typedef struct _gm_lookup gm_lookup_t;
 typedef const gm_kernel_set_t *(*gm_typecheck_t)(ndt_apply_spec_t *spec, const gm_func_t *f,
                                                  const ndt_t *in[], const int64_t li[],
                                                  int nin, int nout, bool check_broadcast,
@@ -150,6 +201,8 @@ typedef const gm_kernel_set_t *(*gm_typecheck_t)(ndt_apply_spec_t *spec, const g
 struct gm_func {
     char *name;
     gm_typecheck_t typecheck; /* Experimental optimized type-checking, may be NULL. */
+    gm_stats_t *stats;
+    gm_lookup_t *lookup;      /* kernel index by input dtypes */
     int nkernels;
     gm_kernel_set_t kernels[GM_MAX_KERNELS];
 };
@@ -175,6 +228,71 @@ GM_API gm_kernel_t gm_select(ndt_apply_spec_t *spec, const gm_tbl_t *tbl, const
 GM_API int gm_apply(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims, ndt_context_t *ctx);
 GM_API int gm_apply_thread(const gm_kernel_t *kernel, xnd_t stack[], int outer_dims, const int64_t nthreads, ndt_context_t *ctx);
 
+GM_API int64_t gm_get_block_cache_size(void);
+GM_API int gm_set_block_cache_size(int64_t size, ndt_context_t *ctx);
+
+
+/******************************************************************************/
+/*                                 Statistics                                 */
+/******************************************************************************/
+
+GM_API void gm_stats_enable(bool enable);
+GM_API bool gm_stats_enabled(void);
+GM_API void gm_stats_get(gm_stats_t *stats, const gm_func_t *f);
+GM_API void gm_stats_reset(const gm_tbl_t *tbl);
+GM_API const char *gm_stats_slot_name(int slot);
+GM_API const char *gm_stats_reason_name(int reason);
+
+
+/******************************************************************************/
+/*                                  Tracing                                   */
+/******************************************************************************/
+
+enum gm_trace_kind {
+  GM_TRACE_SELECT, /* gm_select() */
+  GM_TRACE_APPLY,  /* gm_apply() and gm_apply_thread() */
+  GM_TRACE_CHUNK   /* a worker of gm_apply_thread() */
+};
+
+typedef struct {
+    enum gm_trace_kind kind;
+    bool begin;                 /* true at entry, false at exit */
+    int status;                 /* at exit: 0 on success, -1 on error */
+    const char *name;           /* function name */
+    int slot;                   /* kernel slot (enum gm_stats_slot) or -1 */
+    int nargs;
+    const ndt_t * const *types; /* argument types, only inputs for GM_TRACE_SELECT */
+    int worker;                 /* worker index for GM_TRACE_CHUNK, -1 otherwise */
+    uint64_t thread;            /* id of the calling thread */
+} gm_trace_event_t;
+
+/*
+ * The hook is called at entry and exit of gm_select(), gm_apply() and
+ * gm_apply_thread() and in each worker thread of gm_apply_thread().  It must
+ * be thread safe.  Kernels that have not been obtained from gm_select() are
+ * not traced.  gm_set_trace_hook() replaces the hook and its data atomically,
+ * calls in flight may still use the previous ones.
+ */
+typedef void (*gm_trace_hook_t)(const gm_trace_event_t *event, void *data);
+
+GM_API int gm_set_trace_hook(gm_trace_hook_t hook, void *data, ndt_context_t *ctx);
+GM_API gm_trace_hook_t gm_get_trace_hook(void);
+GM_API int gm_trace_chrome_start(const char *path, ndt_context_t *ctx);
+GM_API int gm_trace_chrome_stop(ndt_context_t *ctx);
+
+
+/******************************************************************************/
+/*                       Fused elementwise expressions                        */
+/******************************************************************************/
+
+typedef struct _gm_fuse gm_fuse_t;
+
+GM_API gm_fuse_t *gm_fuse_new(const gm_tbl_t *tbl, int nin, ndt_context_t *ctx);
+GM_API void gm_fuse_del(gm_fuse_t *f);
+GM_API int gm_fuse_add(gm_fuse_t *f, const char *name, const int args[], int nargs, ndt_context_t *ctx);
+GM_API const ndt_t *gm_fuse_typecheck(const gm_fuse_t *f, const ndt_t *types[], ndt_context_t *ctx);
+GM_API int gm_fuse_apply(const gm_fuse_t *f, xnd_t stack[], ndt_context_t *ctx);
+
 
 /******************************************************************************/
 /*                                NumPy loops                                 */
@@ -205,6 +323,8 @@ GM_API int gm_np_map(const gm_strided_kernel_t f,
 GM_API int array_shape_check(xnd_t *x, const int64_t shape, ndt_context_t *ctx);
 GM_API int gm_xnd_map(const gm_xnd_kernel_t f, xnd_t stack[], const int nargs,
                       const int outer_dims, ndt_context_t *ctx);
+GM_API int gm_xnd_map_blocked(const gm_xnd_kernel_t f, xnd_t stack[], const int nargs,
+                              const int outer_dims, const int64_t block, ndt_context_t *ctx);
 
 
 /******************************************************************************/
@@ -52,12 +52,19 @@ extern "C" {
 #define GM_CPU_FUNC  0x0001U
 #define GM_CUDA_MANAGED_FUNC 0x0002U
 
+#if PY_VERSION_HEX >= 0x03090000
+  #define GM_HAVE_VECTORCALL
+#endif
+
 typedef struct {
     PyObject_HEAD
     const gm_tbl_t *tbl; /* kernel table */
     uint32_t flags;      /* memory target */
     char *name;          /* function name */
     PyObject *identity;  /* identity element */
+#ifdef GM_HAVE_VECTORCALL
+    vectorcallfunc vectorcall; /* call entry point */
+#endif
 } GufuncObject;
 
 
@@ -77,6 +77,7 @@ class ApplySpec(_ApplySpec):
 
     def __repr__(self):
         return "\
-ApplySpec(flags=%r,\n  outer_dims=%r\n  nin=%r,\n  nout=%r,\n  nargs=%r,\n  types=%r)\
-" % (self.flags, self.outer_dims, self.nin, self.nout, self.nargs, self.types)
+ApplySpec(flags=%r,\n  outer_dims=%r\n  nin=%r,\n  nout=%r,\n  nargs=%r,\n  types=%r,\n  loop_order=%r)\
+" % (self.flags, self.outer_dims, self.nin, self.nout, self.nargs, self.types,
+     self.loop_order)
 
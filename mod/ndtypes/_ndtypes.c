@@ -122,11 +122,124 @@ seterr(ndt_context_t *ctx)
 /*                         Get offsets from a list                          */
 /****************************************************************************/
 
+static int32_t *
+offsets_from_pylist(PyObject *lst, int64_t *noffsets)
+{
+    const int64_t n = PyList_GET_SIZE(lst);
+
+    if (n < 2 || n > INT32_MAX) {
+        PyErr_SetString(PyExc_ValueError,
+            "length of a single offset list must be in [2, INT32_MAX]");
+        return NULL;
+    }
+
+    int32_t * const offsets = ndt_alloc(n, sizeof(int32_t));
+    if (offsets == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    for (int32_t k = 0; k < n; k++) {
+        long long x = PyLong_AsLongLong(PyList_GET_ITEM(lst, k));
+        if (x == -1 && PyErr_Occurred()) {
+            ndt_free(offsets);
+            return NULL;
+        }
+
+        if (x < 0 || x > INT32_MAX) {
+            ndt_free(offsets);
+            PyErr_SetString(PyExc_ValueError,
+                "offset must be in [0, INT32_MAX]");
+            return NULL;
+        }
+
+        offsets[k] = (int32_t)x;
+    }
+
+    *noffsets = n;
+    return offsets;
+}
+
+/*
+ * Binary offsets: a one-dimensional buffer of native int32 or int64 values,
+ * e.g. an array.array or a NumPy array.  The values are copied directly and
+ * no Python integers are created.
+ */
+static int32_t *
+offsets_from_pybuffer(PyObject *obj, int64_t *noffsets)
+{
+    Py_buffer view;
+    const char *fmt;
+    int32_t *offsets = NULL;
+    int64_t n;
+
+    if (PyObject_GetBuffer(obj, &view, PyBUF_FORMAT|PyBUF_C_CONTIGUOUS) < 0) {
+        return NULL;
+    }
+
+    fmt = view.format;
+    if (*fmt == '@' || *fmt == '=') {
+        fmt++;
+    }
+
+    if (view.ndim != 1 || strlen(fmt) != 1 || strchr("ilqn", *fmt) == NULL ||
+        (view.itemsize != 4 && view.itemsize != 8)) {
+        PyErr_SetString(PyExc_TypeError,
+            "offset buffer must be one-dimensional with int32 or int64 items");
+        goto out;
+    }
+
+    n = view.shape[0];
+    if (n < 2 || n > INT32_MAX) {
+        PyErr_SetString(PyExc_ValueError,
+            "length of a single offset list must be in [2, INT32_MAX]");
+        goto out;
+    }
+
+    offsets = ndt_alloc(n, sizeof(int32_t));
+    if (offsets == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+
+    if (view.itemsize == 4) {
+        memcpy(offsets, view.buf, n * sizeof(int32_t));
+        for (int64_t k = 0; k < n; k++) {
+            if (offsets[k] < 0) {
+                goto value_error;
+            }
+        }
+    }
+    else {
+        const int64_t *v = (const int64_t *)view.buf;
+        for (int64_t k = 0; k < n; k++) {
+            if (v[k] < 0 || v[k] > INT32_MAX) {
+                goto value_error;
+            }
+            offsets[k] = (int32_t)v[k];
+        }
+    }
+
+    *noffsets = n;
+
+out:
+    PyBuffer_Release(&view);
+    return offsets;
+
+value_error:
+    ndt_free(offsets);
+    offsets = NULL;
+    PyErr_SetString(PyExc_ValueError, "offset must be in [0, INT32_MAX]");
+    goto out;
+}
+
 static int
 offsets_from_list(ndt_meta_t *m, PyObject *list)
 {
     NDT_STATIC_CONTEXT(ctx);
     PyObject *lst;
+    int32_t *offsets;
+    int64_t noffsets;
 
     if (!PyList_Check(list)) {
         PyErr_SetString(PyExc_TypeError, "expected a list of offset lists");
@@ -143,42 +256,22 @@ offsets_from_list(ndt_meta_t *m, PyObject *list)
     m->ndims = 0;
     for (int64_t i = n-1; i >= 0; i--) {
         lst = PyList_GET_ITEM(list, i);
-        if (!PyList_Check(lst)) {
+        if (PyList_Check(lst)) {
+            offsets = offsets_from_pylist(lst, &noffsets);
+        }
+        else if (PyObject_CheckBuffer(lst)) {
+            offsets = offsets_from_pybuffer(lst, &noffsets);
+        }
+        else {
             PyErr_SetString(PyExc_TypeError,
                 "expected a list of offset lists");
             return -1;
         }
 
-        const int64_t noffsets = PyList_GET_SIZE(lst);
-        if (noffsets < 2 || noffsets > INT32_MAX) {
-            PyErr_SetString(PyExc_ValueError,
-                "length of a single offset list must be in [2, INT32_MAX]");
-            return -1;
-        }
-
-        int32_t * const offsets = ndt_alloc(noffsets, sizeof(int32_t));
         if (offsets == NULL) {
-            PyErr_NoMemory();
             return -1;
         }
 
-        for (int32_t k = 0; k < noffsets; k++) {
-            long long x = PyLong_AsLongLong(PyList_GET_ITEM(lst, k));
-            if (x == -1 && PyErr_Occurred()) {
-                ndt_free(offsets);
-                return -1;
-            }
-
-            if (x < 0 || x > INT32_MAX) {
-                ndt_free(offsets);
-                PyErr_SetString(PyExc_ValueError,
-                    "offset must be in [0, INT32_MAX]");
-                return -1;
-            }
-
-            offsets[k] = (int32_t)x;
-        }
-
         m->offsets[m->ndims] = ndt_offsets_from_ptr(offsets, (int32_t)noffsets, &ctx);
         if (m->offsets[m->ndims] == NULL) {
             (void)seterr(&ctx);
@@ -208,6 +301,7 @@ ndtype_alloc(PyTypeObject *type)
     }
     self->hash = -1;
     NDT(self) = NULL;
+    self->str = NULL;
 
     return (PyObject *)self;
 }
@@ -216,6 +310,7 @@ static void
 ndtype_dealloc(NdtObject *self)
 {
     ndt_decref(NDT(self));
+    Py_XDECREF(self->str);
     Py_TYPE(self)->tp_free(self);
 }
 
@@ -423,37 +518,43 @@ ndtype_new(PyTypeObject *tp, PyObject *args, PyObject *kwds)
     return ndtype_from_offsets_and_dtype(tp, offsets, type);
 }
 
+/* Types are immutable, so the string representation is computed only once. */
 static PyObject *
 ndtype_str(PyObject *self)
 {
     NDT_STATIC_CONTEXT(ctx);
-    PyObject *res;
+    NdtObject *s = (NdtObject *)self;
     char *cp;
 
-    cp = ndt_as_string(NDT(self), &ctx);
-    if (cp == NULL) {
-        return seterr(&ctx);
+    if (s->str == NULL) {
+        cp = ndt_as_string(NDT(self), &ctx);
+        if (cp == NULL) {
+            return seterr(&ctx);
+        }
+
+        s->str = PyUnicode_FromString(cp);
+        ndt_free(cp);
+        if (s->str == NULL) {
+            return NULL;
+        }
     }
 
-    res = PyUnicode_FromString(cp);
-    ndt_free(cp);
-    return res;
+    Py_INCREF(s->str);
+    return s->str;
 }
 
 static PyObject *
 ndtype_repr(PyObject *self)
 {
-    NDT_STATIC_CONTEXT(ctx);
-    PyObject *res;
-    char *cp;
+    PyObject *str, *res;
 
-    cp = ndt_as_string(NDT(self), &ctx);
-    if (cp == NULL) {
-        return seterr(&ctx);
+    str = ndtype_str(self);
+    if (str == NULL) {
+        return NULL;
     }
 
-    res = PyUnicode_FromFormat("ndt(\"%s\")", cp);
-    ndt_free(cp);
+    res = PyUnicode_FromFormat("ndt(\"%U\")", str);
+    Py_DECREF(str);
     return res;
 }
 
@@ -830,6 +931,7 @@ ndtype_apply(PyObject *self, PyObject *args, PyObject *kwargs)
     PyObject *nout = NULL;
     PyObject *nargs = NULL;
     PyObject *lst = NULL;
+    PyObject *loop_order = NULL;
     int ret;
 
     if (parse_args(types, &py_nin, &py_nout, &py_nargs, args, kwargs) < 0) {
@@ -884,8 +986,27 @@ ndtype_apply(PyObject *self, PyObject *args, PyObject *kwargs)
         goto finish;
     }
 
+    if (spec.nperm == 0) {
+        loop_order = Py_None;
+        Py_INCREF(loop_order);
+    }
+    else {
+        loop_order = PyTuple_New(spec.nperm);
+        if (loop_order == NULL) {
+            goto finish;
+        }
+        for (int i = 0; i < spec.nperm; i++) {
+            PyObject *v = PyLong_FromLong(spec.perm[i]);
+            if (v == NULL) {
+                goto finish;
+            }
+            PyTuple_SET_ITEM(loop_order, i, v);
+        }
+    }
+
     res = PyObject_CallFunctionObjArgs((PyObject *)_ApplySpec, flags,
-                                       outer_dims, nin, nout, nargs, lst, NULL);
+                                       outer_dims, nin, nout, nargs, lst,
+                                       loop_order, NULL);
 
 finish:
     Py_XDECREF(flags);
@@ -894,6 +1015,7 @@ finish:
     Py_XDECREF(nout);
     Py_XDECREF(nargs);
     Py_XDECREF(lst);
+    Py_XDECREF(loop_order);
     return res;
 }
 
@@ -1344,6 +1466,8 @@ PyInit__ndtypes(void)
     NDT_STATIC_CONTEXT(ctx);
     PyObject *m = NULL;
     PyObject *collections = NULL;
+    PyObject *fields = NULL;
+    PyObject *defaults = NULL;
     PyObject *obj = NULL;
     static PyObject *capsule = NULL;
     static int initialized = 0;
@@ -1375,9 +1499,22 @@ PyInit__ndtypes(void)
         goto error;
     }
 
-    _ApplySpec = (PyTypeObject *)PyObject_CallMethod(collections,
-                                    "namedtuple", "(ss)", "ApplySpec",
-                                    "flags outer_dims nin nout nargs types");
+    /* 'loop_order' is None if the outer dimensions are visited in order. */
+    obj = PyObject_GetAttrString(collections, "namedtuple");
+    if (obj == NULL) {
+        goto error;
+    }
+    fields = Py_BuildValue("(ss)", "ApplySpec",
+                           "flags outer_dims nin nout nargs types loop_order");
+    defaults = Py_BuildValue("{s:(O)}", "defaults", Py_None);
+    if (fields == NULL || defaults == NULL) {
+        goto error;
+    }
+
+    _ApplySpec = (PyTypeObject *)PyObject_Call(obj, fields, defaults);
+    Py_CLEAR(obj);
+    Py_CLEAR(fields);
+    Py_CLEAR(defaults);
     if (_ApplySpec == NULL) {
         goto error;
     }
@@ -1427,6 +1564,9 @@ PyInit__ndtypes(void)
 
 
 error:
+    Py_CLEAR(fields);
+    Py_CLEAR(defaults);
+    Py_CLEAR(obj);
     Py_CLEAR(m);
     return NULL;
 }
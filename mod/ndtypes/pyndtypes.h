@@ -53,6 +53,7 @@ typedef struct {
     PyObject_HEAD
     Py_hash_t hash;
     const ndt_t *ndt;
+    PyObject *str; /* cached string representation */
 } NdtObject;
 
 #define NDT(v) (((NdtObject *)v)->ndt)
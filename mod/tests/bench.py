@@ -1,4 +1,5 @@
 from ndtypes import *
+import array
 import time
 
 # =============================================================================
@@ -13,6 +14,16 @@ end = time.time()
 print(end-start)
 
 
+offsets = [array.array('i', [0, 10000000]), array.array('i', range(10000001))]
+print("\nConstruct 10_000_000 var offsets from buffers:")
+start = time.time()
+v = ndt("int64", offsets)
+end = time.time()
+print(end-start)
+
+assert t == v
+
+
 b = t.serialize()
 print("\nDeserialize 10_000_000 var offsets:")
 start = time.time()
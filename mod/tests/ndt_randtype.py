@@ -361,12 +361,13 @@ BROADCAST_TEST_CASES = [
          args=[ndt("!2 * 3 * uint8")],
          out=None,
          spec=ApplySpec(
-                flags = 'OptS|C|Fortran|Strided|Xnd',
+                flags = 'OptZ|OptC|OptS|C|Fortran|Strided|Xnd',
                 outer_dims = 2,
                 nin = 1,
                 nout = 1,
                 nargs = 2,
-                types = [ndt("!2 * 3 * uint8"), ndt("!2 * 3 * float64")])),
+                types = [ndt("!2 * 3 * uint8"), ndt("!2 * 3 * float64")],
+                loop_order = (1, 0))),
 
     dict(sig=ndt("... * uint8 -> ... * float64"),
          args=[ndt("fixed(shape=2, step=10) * uint8")],
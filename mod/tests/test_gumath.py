@@ -30,14 +30,16 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #
 
-import os, sys
+import os, sys, json, tempfile
+import ctypes
 import gumath as gm
 import gumath.functions as fn
 import gumath.examples as ex
-from xnd import xnd
+from xnd import xnd, array
 from ndtypes import ndt
 from extending import Graph
 import time
+import threading
 import platform
 import math
 import cmath
@@ -71,6 +73,70 @@ class TestAPI(unittest.TestCase):
         self.assertRaises(TypeError, gm.gufunc.__new__)
         self.assertRaises(TypeError, gm.gufunc.__new__, 1)
 
+    def test_stats(self):
+        a = xnd([[1.0, 2.0], [3.0, 4.0]])
+        v = xnd([[1.0], [2.0, 3.0]])
+
+        gm.set_stats_enabled(True)
+        try:
+            self.assertTrue(gm.get_stats_enabled())
+            gm.clear_stats()
+
+            fn.add(a, a)
+            fn.add(a, a)
+            fn.add(v, v)
+            self.assertRaises(ValueError, fn.add, xnd("a"), xnd("b"))
+
+            s = gm.stats()["gumath.functions.add"]
+            self.assertEqual(s["selects"], 4)
+            self.assertGreater(s["typecheck_ns"], 0)
+            self.assertEqual(s["kernels"]["OptC"]["calls"], 2)
+            self.assertEqual(s["kernels"]["OptC"]["threaded"], 0)
+            self.assertEqual(s["kernels"]["OptC"]["bytes"], 2 * 3 * 32)
+            self.assertEqual(s["kernels"]["Xnd"]["calls"], 1)
+            self.assertEqual(s["reasons"]["layout"], 1)
+            self.assertEqual(s["reasons"]["no_match"], 1)
+            self.assertNotIn("gumath.functions.sin", gm.stats())
+
+            gm.clear_stats()
+            self.assertEqual(gm.stats(), {})
+        finally:
+            gm.set_stats_enabled(False)
+
+        self.assertFalse(gm.get_stats_enabled())
+        fn.add(a, a)
+        self.assertEqual(gm.stats(), {})
+
+    def test_trace(self):
+        a = xnd([[1.0, 2.0], [3.0, 4.0]])
+
+        self.assertRaises(RuntimeError, gm.stop_trace)
+
+        fd, path = tempfile.mkstemp(suffix=".json")
+        os.close(fd)
+        try:
+            gm.start_trace(path)
+            try:
+                self.assertRaises(RuntimeError, gm.start_trace, path)
+                fn.add(a, a)
+                self.assertRaises(ValueError, fn.add, xnd("a"), xnd("b"))
+            finally:
+                gm.stop_trace()
+
+            with open(path) as f:
+                events = json.load(f)
+        finally:
+            os.remove(path)
+
+        add = [e for e in events if e["name"] == "add"]
+        self.assertEqual([(e["cat"], e["ph"]) for e in add],
+                         [("select", "B"), ("select", "E"),
+                          ("apply", "B"), ("apply", "E"),
+                          ("select", "B"), ("select", "E")])
+        self.assertEqual(add[1]["args"]["kernel"], "OptC")
+        self.assertEqual(add[3]["args"]["status"], 0)
+        self.assertEqual(add[5]["args"]["status"], -1)
+
 
 class TestCall(unittest.TestCase):
 
@@ -90,6 +156,67 @@ class TestCall(unittest.TestCase):
         self.assertEqual(z, [1, 4, 9])
         self.assertEqual(type(z), X)
 
+    def test_keywords(self):
+        x = xnd([1, 2, 3])
+
+        z = fn.multiply(x, x, cls=array)
+        self.assertEqual(z.tolist(), [1, 4, 9])
+        self.assertEqual(type(z), array)
+
+        z = fn.multiply(x, x, dtype=ndt("int64"))
+        self.assertEqual(z, [1, 4, 9])
+
+        out = xnd.empty("3 * int64")
+        z = fn.multiply(x, x, out=out)
+        self.assertIs(z, out)
+        self.assertEqual(out, [1, 4, 9])
+
+        z = fn.multiply(x, x, out=None, dtype=None, cls=None)
+        self.assertEqual(z, [1, 4, 9])
+
+        self.assertRaises(TypeError, fn.multiply, x, x, outx=out)
+        self.assertRaises(TypeError, fn.multiply, x, x, out=out, dtype=ndt("int64"))
+        self.assertRaises(TypeError, fn.multiply, x, x, cls=int)
+
+    def test_bind(self):
+        x = xnd([1.0, 2.0, 3.0])
+        y = xnd(2.0)
+
+        f = fn.multiply.bind("3 * float64", ndt("float64"))
+        self.assertIs(f.func, fn.multiply)
+        self.assertEqual(f.types, (ndt("3 * float64"), ndt("float64")))
+
+        for _ in range(3):
+            z = f(x, y)
+            self.assertEqual(z, [2.0, 4.0, 6.0])
+            self.assertEqual(z.type, ndt("3 * float64"))
+
+        # Views are accepted if their type (including the strides) matches.
+        v = xnd([[0.0, 1.0, 2.0], [3.0, 4.0, 5.0]])
+        self.assertEqual(f(v[1], y), [6.0, 8.0, 10.0])
+        self.assertRaises(TypeError, f, v[:, 0], y)
+
+        f = fn.multiply.bind("3 * float64", "float64", cls=array)
+        z = f(x, y)
+        self.assertEqual(type(z), array)
+
+        f = fn.divmod.bind("2 * int64", "2 * int64")
+        q, r = f(xnd([7, 8]), xnd([2, 3]))
+        self.assertEqual(q, [3, 2])
+        self.assertEqual(r, [1, 2])
+
+        f = fn.sin.bind("2 * float64")
+        self.assertRaises(TypeError, f, xnd([1.0, 2.0, 3.0]))
+        self.assertRaises(TypeError, f, xnd([1, 2]))
+        self.assertRaises(TypeError, f, [1.0, 2.0])
+        self.assertRaises(TypeError, f)
+        self.assertRaises(TypeError, f, xnd([1.0, 2.0]), out=xnd([1.0, 2.0]))
+
+        self.assertRaises(ValueError, fn.sin.bind, "2 * string")
+        self.assertRaises(ValueError, fn.sin.bind, "N * float64")
+        self.assertRaises(ValueError, fn.sin.bind, "var * float64")
+        self.assertRaises(ValueError, ex.euclidian_pdist.bind, "2 * 3 * float64")
+
     def test_sin_scalar(self):
 
         x1 = xnd(1.2, type="float64")
@@ -812,6 +939,100 @@ class TestOut(unittest.TestCase):
         self.assertEqual(q, xnd([3, 6, 10]))
         self.assertEqual(r, xnd([1, 2, 0]))
 
+        # extents of size one in operands that are already full rank
+        x = xnd([[1], [2]])
+        y = xnd([[10, 20, 30]])
+        z = xnd.empty("2 * 3 * int64")
+        ans = fn.add(x, y, out=z)
+
+        self.assertIs(ans, z)
+        self.assertEqual(ans, xnd([[11, 21, 31], [12, 22, 32]]))
+        self.assertEqual(fn.add(x, y), xnd([[11, 21, 31], [12, 22, 32]]))
+
+        x = xnd([[1, 2, 3], [4, 5, 6]])
+        self.assertEqual(fn.add(x, y), xnd([[11, 22, 33], [14, 25, 36]]))
+        self.assertEqual(fn.add(x, x), xnd([[2, 4, 6], [8, 10, 12]]))
+        self.assertEqual(fn.add(x[::-1], x), xnd([[5, 7, 9], [5, 7, 9]]))
+
+    def test_overlap_cpu(self):
+        # exact aliasing of an elementwise kernel: no copy needed
+        x = xnd([1, 2, 3, 4, 5])
+        ans = fn.add(x, x, out=x)
+
+        self.assertIs(ans, x)
+        self.assertEqual(x, xnd([2, 4, 6, 8, 10]))
+
+        # shifted view
+        x = xnd([1, 2, 3, 4, 5])
+        fn.add(x[:4], x[:4], out=x[1:])
+        self.assertEqual(x, xnd([1, 2, 4, 6, 8]))
+
+        # reversed view
+        x = xnd([1.0, 2.0, 3.0, 4.0, 5.0])
+        fn.add(x[::-1], x, out=x)
+        self.assertEqual(x, xnd([6.0, 6.0, 6.0, 6.0, 6.0]))
+
+        # transposed view
+        x = xnd([[1.0, 2.0], [3.0, 4.0]])
+        fn.add(x, x.transpose(), out=x)
+        self.assertEqual(x, xnd([[2.0, 5.0], [5.0, 8.0]]))
+
+        # disjoint views of the same buffer
+        x = xnd([1, 2, 3, 4])
+        fn.add(x[:2], x[:2], out=x[2:])
+        self.assertEqual(x, xnd([1, 2, 2, 4]))
+
+        # the kernel is selected for the layout of the copied input
+        gm.set_stats_enabled(True)
+        try:
+            gm.clear_stats()
+            x = xnd([[1.0, 2.0, 3.0], [4.0, 5.0, 6.0], [7.0, 8.0, 9.0]])
+            y = x.transpose()
+            self.assertEqual(y.type, ndt("!3 * 3 * float64"))
+            fn.add(y, x, out=x)
+            self.assertEqual(x, xnd([[2.0, 6.0, 10.0], [6.0, 10.0, 14.0],
+                                     [10.0, 14.0, 18.0]]))
+            s = gm.stats()["gumath.functions.add"]
+            self.assertEqual(s["kernels"]["OptC"]["calls"], 1)
+            self.assertNotIn("OptS", s["kernels"])
+        finally:
+            gm.set_stats_enabled(False)
+            gm.clear_stats()
+
+    def test_pool(self):
+        limit = gm.get_pool_limit()
+        self.assertRaises(ValueError, gm.set_pool_limit, -1)
+
+        try:
+            for lim in [limit, 0]:
+                gm.set_pool_limit(lim)
+                for n in [0, 1, 100, 10000]:
+                    x = xnd([float(i) for i in range(n)])
+                    for _ in range(3):
+                        y = fn.multiply(x, x)
+                        self.assertEqual(y, xnd([float(i*i) for i in range(n)]))
+                        del y
+
+                # outputs that are not written completely are zeroed
+                x = xnd([[1, None], [None, 4]])
+                for _ in range(3):
+                    self.assertEqual(fn.add(x, x), [[2, None], [None, 8]])
+        finally:
+            gm.set_pool_limit(limit)
+            gm.clear_pool()
+
+    def test_inplace_operators(self):
+        a = array([[1.0, 2.0], [3.0, 4.0]])
+        b = a
+        a += array([10.0, 20.0])
+
+        self.assertIs(a, b)
+        self.assertEqual(a.tolist(), [[11.0, 22.0], [13.0, 24.0]])
+
+        a *= a.T
+        self.assertIs(a, b)
+        self.assertEqual(a.tolist(), [[121.0, 286.0], [286.0, 576.0]])
+
     @unittest.skipIf(cd is None, "test requires cuda")
     def test_broadcast_cuda(self):
         # multiply
@@ -923,6 +1144,239 @@ class TestBinaryCPU(unittest.TestCase):
             z = fn.multiply(x, y)
             self.assertEqual(z, [2, 6, 12, 20, 30, 42, 56, 72])
 
+    def test_add_transposed(self):
+        a = [[1, 2, 3, 4], [5, 6, 7, 8], [9, 10, 11, 12]]
+        b = [[10, 20, 30, 40], [50, 60, 70, 80], [90, 100, 110, 120]]
+
+        x = xnd(a, dtype="float64").transpose()
+        y = xnd(b, dtype="float64").transpose()
+        expected = [[v+w for v, w in zip(r, s)]
+                    for r, s in zip(x.value, y.value)]
+
+        # Fortran and Fortran.
+        z = fn.add(x, y)
+        self.assertEqual(z, expected)
+
+        # Fortran and C.
+        c = xnd(y.value, dtype="float64")
+        self.assertEqual(fn.add(x, c), expected)
+        self.assertEqual(fn.add(c, x), expected)
+
+        # Broadcast row and column.
+        r = xnd([1.0, 2.0, 3.0])
+        self.assertEqual(fn.add(x, r),
+                         [[v+w for v, w in zip(row, r.value)] for row in x.value])
+
+        # Explicit C output.
+        out = xnd.empty("4 * 3 * float64")
+        fn.add(x, y, out=out)
+        self.assertEqual(out, expected)
+
+    def test_add_blocked(self):
+        cache_size = gm.get_block_cache_size()
+        self.assertRaises(ValueError, gm.set_block_cache_size, -1)
+
+        a = [[float(i*29 + j) for j in range(29)] for i in range(37)]
+        b = [[float(i*37 + j) for j in range(37)] for i in range(29)]
+        x = xnd(a)
+        y = xnd(b).transpose()
+        expected = [[v+w for v, w in zip(r, s)]
+                    for r, s in zip(x.value, y.value)]
+
+        try:
+            # Smallest tiles (8x8 float64 for three arguments), partial
+            # tiles in both dimensions.
+            gm.set_block_cache_size(8 * 8 * 8 * 3)
+            self.assertEqual(fn.add(x, y), expected)
+            self.assertEqual(fn.add(y, x), expected)
+
+            u = xnd([a, a]).transpose(permute=(0, 2, 1))
+            v = xnd([b, b])
+            self.assertEqual(fn.add(u, v), [[[r+s for r, s in zip(p, q)]
+                                             for p, q in zip(m, n)]
+                                            for m, n in zip(u.value, v.value)])
+
+            # No tile fits the budget: not blocked.
+            gm.set_block_cache_size(1)
+            self.assertEqual(fn.add(x, y), expected)
+
+            gm.set_block_cache_size(0)
+            self.assertEqual(fn.add(x, y), expected)
+        finally:
+            gm.set_block_cache_size(cache_size)
+
+    def test_threads(self):
+        # kernels run without the GIL: concurrent calls on shared inputs
+        n = 100000
+        x = xnd([float(i % 7) for i in range(n)])
+        expected = [float((i % 7) * (i % 7) + k) for k in range(4) for i in range(n)]
+        results = [None] * 4
+
+        def f(k):
+            y = fn.multiply(x, x)
+            results[k] = fn.add(y, xnd(float(k)))
+
+        threads = [threading.Thread(target=f, args=(k,)) for k in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        for k in range(4):
+            self.assertEqual(results[k], xnd(expected[k*n:(k+1)*n]))
+
+    def test_threads_pointer_dtype(self):
+        # kernels on pointer dtypes keep the GIL: a concurrent __setitem__
+        # would free the strings that the kernel reads
+        n = 100000
+        x = [{'index': 0, 'name': 'brazil', 'value': 10},
+             {'index': 1, 'name': 'france', 'value': None}]
+        z = xnd(x * n, type="%d * {index: int64, name: string, value: ?int64}" % (2*n))
+
+        started = threading.Event()
+        stop = False
+        counter = [0]
+
+        def spin():
+            started.set()
+            while not stop:
+                counter[0] += 1
+
+        interval = sys.getswitchinterval()
+        sys.setswitchinterval(0.5)
+        t = threading.Thread(target=spin)
+        try:
+            t.start()
+            started.wait()
+
+            # The spinning thread waits for the GIL and only runs if the
+            # call releases it.
+            before = counter[0]
+            ans = ex.count_valid_missing(z)
+            self.assertEqual(counter[0], before)
+            self.assertEqual(ans.value, {'valid': n, 'missing': n})
+        finally:
+            stop = True
+            t.join()
+            sys.setswitchinterval(interval)
+
+    def test_threads_pointer_dtype_bound(self):
+        # bound functions on pointer dtypes keep the GIL as well
+        n = 100000
+        x = [{'index': 0, 'name': 'brazil', 'value': 10},
+             {'index': 1, 'name': 'france', 'value': None}]
+        z = xnd(x * n, type="%d * {index: int64, name: string, value: ?int64}" % (2*n))
+        f = ex.count_valid_missing.bind(z.type)
+
+        started = threading.Event()
+        stop = False
+        counter = [0]
+
+        def spin():
+            started.set()
+            while not stop:
+                counter[0] += 1
+
+        interval = sys.getswitchinterval()
+        sys.setswitchinterval(0.5)
+        t = threading.Thread(target=spin)
+        try:
+            t.start()
+            started.wait()
+
+            before = counter[0]
+            ans = f(z)
+            self.assertEqual(counter[0], before)
+            self.assertEqual(ans.value, {'valid': n, 'missing': n})
+        finally:
+            stop = True
+            t.join()
+            sys.setswitchinterval(interval)
+
+    def test_multiply_transposed_3d(self):
+        a = [[[i*12 + j*4 + k for k in range(4)] for j in range(3)]
+             for i in range(2)]
+        x = xnd(a, dtype="int64")
+
+        for p in [(2, 1, 0), (1, 2, 0), (0, 2, 1), (2, 0, 1)]:
+            y = x.transpose(permute=p)
+            c = xnd(y.value, dtype="int64")
+            z = fn.multiply(y, c)
+            self.assertEqual(z, fn.multiply(c, c))
+
+
+class TestFuse(unittest.TestCase):
+
+    def unfused(self, a, b, c, d, e):
+        return fn.subtract(fn.add(fn.multiply(a, b), fn.multiply(c, d)), e)
+
+    def test_fuse(self):
+        f = gm.fuse(lambda a, b, c, d, e: a*b + c*d - e)
+
+        for n in [0, 1, 7, 1000, 10000]:
+            xs = [xnd([float(i*(k+1) % 17) for i in range(n)])
+                  for k in range(5)]
+            self.assertEqual(f(*xs), self.unfused(*xs))
+
+        x = xnd([[float(i*3 + j) for j in range(3)] for i in range(4)])
+        y = x[::-1]
+        z = x.transpose().transpose()
+        self.assertEqual(f(x, y, z, y, x), self.unfused(x, y, z, y, x))
+
+        u = xnd([[float(i*4 + j) for j in range(4)] for i in range(3)])
+        v = u.transpose()
+        self.assertEqual(f(x, v, x, v, v), self.unfused(x, v, x, v, v))
+
+    def test_fuse_constants(self):
+        f = gm.fuse(lambda a: 2.0 * a.apply(fn.sin) + 1.5)
+        x = xnd([[0.0, 1.0], [2.0, 3.0]]).transpose()
+        expected = fn.add(fn.multiply(xnd(2.0), fn.sin(x)), xnd(1.5))
+        self.assertEqual(f(x), expected)
+        self.assertEqual(f(xnd(1.0)), 2.0 * math.sin(1.0) + 1.5)
+
+        g = gm.fuse(lambda a, b: -(a - b) * b)
+        x = xnd([1, 2, 3])
+        self.assertEqual(g(x, xnd(10)), [90, 80, 70])
+
+    def test_fuse_out(self):
+        f = gm.fuse(lambda a, b: a * b + a)
+        x = xnd([[1, 2, 3], [4, 5, 6]])
+
+        out = xnd.empty("2 * 3 * int64")
+        z = f(x, x, out=out)
+        self.assertIs(z, out)
+        self.assertEqual(out, [[2, 6, 12], [20, 30, 42]])
+
+        out = xnd.empty("3 * 2 * int64").transpose()
+        f(x, x, out=out)
+        self.assertEqual(out, [[2, 6, 12], [20, 30, 42]])
+
+        out = xnd.empty("2 * 3 * float64")
+        self.assertRaises(ValueError, f, x, x, out=out)
+
+        # in-place and overlapping output
+        x = xnd([[1, 2, 3], [4, 5, 6]])
+        f(x, x, out=x)
+        self.assertEqual(x, [[2, 6, 12], [20, 30, 42]])
+
+        x = xnd([1, 2, 3, 4, 5])
+        f(x[:4], x[:4], out=x[1:])
+        self.assertEqual(x, [1, 2, 6, 12, 20])
+
+    def test_fuse_errors(self):
+        self.assertRaises(ValueError, gm.fuse, lambda a: a)
+        self.assertRaises(ValueError, gm.fused, 1, [])
+        self.assertRaises(TypeError, gm.fused, 1, [(fn.add,)])
+        self.assertRaises(ValueError, gm.fused, 1, [(fn.add, 0, 1)])
+
+        f = gm.fuse(lambda a, b: a * b)
+        self.assertRaises(TypeError, f, xnd([1]))
+        self.assertRaises(ValueError, f, xnd([1, 2]), xnd([1, 2, 3]))
+        self.assertRaises(NotImplementedError, f, xnd([1, None]), xnd([1, 2]))
+
+        g = gm.fuse(lambda a: a.apply(fn.divmod, a))
+        self.assertRaises(TypeError, g, xnd([1, 2]))
+
 
 @unittest.skipIf(cd is None, "test requires cuda")
 class TestBinaryCUDA(unittest.TestCase):
@@ -1426,6 +1880,119 @@ class TestFunctions(unittest.TestCase):
         self.check_binary_type_error("divmod", a, t, b, u)
 
 
+class TestLookup(unittest.TestCase):
+    """The kernel lookup index must select the same kernel as a linear scan
+       over all kernels in registration order."""
+
+    KERNEL = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p)
+    kernels = []
+    nfuncs = 0
+
+    def add_func(self, sigs):
+        """Register a kernel for each signature.  Calls append the index
+           of the selected kernel to 'self.called'."""
+        TestLookup.nfuncs += 1
+        name = "lookup_test_%d" % TestLookup.nfuncs
+        f = None
+
+        for i, sig in enumerate(sigs):
+            def kernel(stack, ctx, i=i):
+                self.called.append(i)
+                return 0
+            p = self.KERNEL(kernel)
+            TestLookup.kernels.append(p)
+            f = gm.unsafe_add_kernel(name=name, sig=sig, tag="Xnd",
+                                     ptr=ctypes.cast(p, ctypes.c_void_p).value)
+
+        return f
+
+    def linear_scan(self, sigs, args):
+        for i, sig in enumerate(sigs):
+            try:
+                ndt(sig).apply(*[x.type for x in args])
+            except (TypeError, ValueError):
+                continue
+            return i
+        return None
+
+    def assert_lookup(self, sigs, calls):
+        f = self.add_func(sigs)
+
+        for args in calls:
+            expected = self.linear_scan(sigs, args)
+            self.called = []
+            if expected is None:
+                self.assertRaises(TypeError, f, *args)
+                self.assertEqual(self.called, [])
+            else:
+                f(*args)
+                self.assertEqual(set(self.called), {expected})
+
+    def test_registration_order(self):
+        calls = [(xnd(1),), (xnd(1.0),), (xnd([1, 2]),)]
+
+        # generic kernel before a concrete one
+        sigs = ["... * T -> ... * T", "... * int64 -> ... * int64"]
+        self.assert_lookup(sigs, calls)
+
+        # concrete kernel before a generic one
+        sigs = ["... * int64 -> ... * int64", "... * T -> ... * T"]
+        self.assert_lookup(sigs, calls)
+
+        # the generic kernel is between two buckets
+        sigs = ["float64 -> float64", "T -> T", "int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+    def test_option_keys(self):
+        calls = [(xnd(1),), (xnd(None, type="?int64"),), (xnd(1.0),)]
+
+        sigs = ["?int64 -> int64", "int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+        sigs = ["int64 -> int64", "?int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+        sigs = ["T -> T", "?int64 -> int64", "int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+    def test_not_indexed(self):
+        r = xnd({'a': 1, 'b': 2.0}, type="{a: int64, b: float64}")
+        calls = [(r, xnd(1.0)), (xnd(1), xnd(1.0)), (xnd(1.0), xnd(1.0)),
+                 (xnd(1), xnd(1)), (xnd("x"), xnd(1.0))]
+
+        sigs = ["{a: int64, b: float64}, float64 -> int64",
+                "int64, float64 -> int64",
+                "T, float64 -> int64",
+                "Any, int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+        sigs = ["Any, int64 -> int64",
+                "T, float64 -> int64",
+                "string, float64 -> int64",
+                "{a: int64, b: float64}, float64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+    def test_nin_mismatch(self):
+        calls = [(xnd(1),), (xnd(1), xnd(1)), (xnd(1), xnd(1), xnd(1))]
+
+        sigs = ["int64, int64 -> int64", "int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+        sigs = ["T, T -> T", "T -> T", "int64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+    def test_many_inputs(self):
+        i, d = xnd(1), xnd(1.0)
+        calls = [(i, i, i, i, i), (i, i, i, i, d), (i, i, i, d, i),
+                 (i, i, i, d, d), (d, i, i, i, d)]
+
+        sigs = ["int64, int64, int64, int64, int64 -> int64",
+                "int64, int64, int64, int64, float64 -> int64",
+                "int64, int64, int64, float64, int64 -> int64",
+                "T, int64, int64, int64, float64 -> int64"]
+        self.assert_lookup(sigs, calls)
+
+
 @unittest.skipIf(cd is None, "test requires cuda")
 class TestCudaManaged(unittest.TestCase):
 
@@ -1855,9 +2422,11 @@ ALL_TESTS = [
   TestUnaryCUDA,
   TestBinaryCPU,
   TestBinaryCUDA,
+  TestFuse,
   TestBitwiseCPU,
   TestBitwiseCUDA,
   TestFunctions,
+  TestLookup,
   TestCudaManaged,
   LongIndexSliceTest,
 ]
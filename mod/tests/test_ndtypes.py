@@ -33,7 +33,7 @@
 import os, sys
 import argparse
 import unittest, gc
-import weakref, struct
+import weakref, struct, array
 from copy import copy
 from ndtypes import ndt, typedef, instantiate, MAX_DIM, ApplySpec
 from ndt_support import *
@@ -536,6 +536,44 @@ class TestVarDim(unittest.TestCase):
         self.assertRaises(ValueError, ndt, "N * int8", [[0, 2], [0, 10, 20]])
         self.assertRaises(ValueError, ndt, "var * int8", [[0, 2], [0, 10, 20]])
 
+    def test_var_dim_external_offsets_buffer(self):
+        expected = ndt("var(offsets=[0,2]) * var(offsets=[0,3,10]) * int8")
+
+        for fmt in ['i', 'l', 'q']:
+            offsets = [array.array(fmt, [0, 2]), array.array(fmt, [0, 3, 10])]
+            self.assertEqual(ndt("int8", offsets), expected)
+
+        # Mixing lists and buffers.
+        offsets = [[0, 2], array.array('i', [0, 3, 10])]
+        self.assertEqual(ndt("int8", offsets), expected)
+
+        # Invalid item types.
+        self.assertRaises(TypeError, ndt, "int8", [b"\x00\x02"])
+        self.assertRaises(TypeError, ndt, "int8", [array.array('h', [0, 2])])
+        self.assertRaises(TypeError, ndt, "int8", [array.array('I', [0, 2])])
+        self.assertRaises(TypeError, ndt, "int8", [array.array('d', [0, 2])])
+
+        # Invalid offsets.
+        self.assertRaises(ValueError, ndt, "int8", [array.array('i', [])])
+        self.assertRaises(ValueError, ndt, "int8", [array.array('i', [0])])
+        self.assertRaises(ValueError, ndt, "int8", [array.array('i', [-1, 2])])
+        self.assertRaises(ValueError, ndt, "int8", [array.array('q', [0, 2147483648])])
+        self.assertRaises(ValueError, ndt, "int8",
+                          [array.array('i', [0, 2]), array.array('i', [0, 10])])
+
+        if np is not None:
+            offsets = [np.array([0, 2], dtype="int64"),
+                       np.array([0, 3, 10], dtype="int32")]
+            self.assertEqual(ndt("int8", offsets), expected)
+
+            # Non-contiguous.
+            a = np.array([0, 99, 3, 99, 10], dtype="int32")[::2]
+            self.assertRaises((BufferError, ValueError), ndt, "int8", [[0, 2], a])
+
+            # Not one-dimensional.
+            a = np.array([[0, 3], [3, 10]], dtype="int32")
+            self.assertRaises(TypeError, ndt, "int8", [a])
+
 
 class TestSymbolicDim(unittest.TestCase):
 
@@ -1625,6 +1663,26 @@ class TestCopy(unittest.TestCase):
         self.assertTrue(wr() is None, wr())
 
 
+class TestStr(unittest.TestCase):
+
+    def test_str(self):
+        for dtype, _ in DTYPE_TEST_CASES:
+            t = ndt(dtype)
+            s = str(t)
+            self.assertEqual(repr(t), 'ndt("%s")' % s)
+
+            # The representation is cached.
+            self.assertIs(str(t), s)
+            self.assertEqual(repr(t), 'ndt("%s")' % s)
+
+    def test_str_large(self):
+        t = ndt("{%s}" % ", ".join("field%d: 10 * ?float64" % i for i in range(1000)))
+        s = str(t)
+        self.assertEqual(ndt(s), t)
+        self.assertIs(str(t), s)
+        self.assertEqual(t.pformat().count("field"), 1000)
+
+
 class TestBufferProtocol(unittest.TestCase):
 
     def test_array(self):
@@ -1975,6 +2033,7 @@ class TestBroadcast(unittest.TestCase):
             self.assertEqual(spec.nout, expected.nout, msg=msg)
             self.assertEqual(spec.nargs, expected.nargs, msg=msg)
             self.assertEqual(spec.types, expected.types, msg=msg)
+            self.assertEqual(spec.loop_order, expected.loop_order, msg=msg)
 
     def test_against_numpy(self):
 
@@ -2177,6 +2236,7 @@ ALL_TESTS = [
   TestComplex,
   TestTypevar,
   TestCopy,
+  TestStr,
   TestBufferProtocol,
   TestConstruction,
   TestError,
@@ -38,7 +38,11 @@ from xnd import xnd, XndEllipsis, data_shapes
 from xnd._xnd import _test_view_subscript, _test_view_new
 from xnd_support import *
 from xnd_randvalue import *
-from _testbuffer import ndarray, ND_WRITABLE
+from _testbuffer import ndarray, ND_WRITABLE, PyBUF_SIMPLE, PyBUF_WRITABLE, \
+                        PyBUF_FORMAT, PyBUF_ND, PyBUF_STRIDES, PyBUF_CONTIG, \
+                        PyBUF_CONTIG_RO, PyBUF_STRIDED_RO, PyBUF_RECORDS_RO, \
+                        PyBUF_FULL, PyBUF_FULL_RO, PyBUF_C_CONTIGUOUS, \
+                        PyBUF_F_CONTIGUOUS, PyBUF_ANY_CONTIGUOUS
 import random
 
 
@@ -415,6 +419,37 @@ class TestFixedDim(XndTestCase):
         self.assertEqual(x, y)
         self.assertNotStrictEqual(x, y)
 
+    def test_fixed_dim_value_numeric(self):
+        # Native numeric dtypes are unpacked directly from memory.
+        test_cases = [
+          ([True, False, True], "bool"),
+          ([-128, 0, 127], "int8"),
+          ([-2**15, 0, 2**15-1], "int16"),
+          ([-2**31, 0, 2**31-1], "int32"),
+          ([-2**63, 0, 2**63-1], "int64"),
+          ([0, 1, 2**8-1], "uint8"),
+          ([0, 1, 2**16-1], "uint16"),
+          ([0, 1, 2**32-1], "uint32"),
+          ([0, 1, 2**64-1], "uint64"),
+          ([-1.5, 0.0, 1.5], "float32"),
+          ([-1.5, 0.0, 1e300], "float64")
+        ]
+
+        for v, dtype in test_cases:
+            x = xnd([v, v[::-1]], dtype=dtype)
+            self.assertEqual(x.value, [v, v[::-1]])
+            self.assertEqual(x[:, ::-2].value, [v[::-2], v[::2]])
+            self.assertEqual(x[1].value, v[::-1])
+            self.assertEqual(x.short_value(2), [[v[0], XndEllipsis], XndEllipsis])
+
+        x = xnd([1.0, float("inf"), float("nan")], dtype="<float64")
+        v = x.value
+        self.assertEqual(v[:2], [1.0, float("inf")])
+        self.assertTrue(isnan(v[2]))
+
+        x = xnd([1, 2, 3], dtype=">int32")
+        self.assertEqual(x.value, [1, 2, 3])
+
 
 class TestFortran(XndTestCase):
 
@@ -3436,6 +3471,77 @@ class TestTypeInference(XndTestCase):
         for v in not_implemented:
             self.assertRaises(NotImplementedError, xnd, v)
 
+    def test_homogeneous_numeric(self):
+        # Rectangular lists of floats or ints take a single-pass path.
+        test_cases = [
+          ([1.5, 2.5], "2 * float64"),
+          ([[1.0] * 3] * 2, "2 * 3 * float64"),
+          ([[[1, 2]] * 2] * 3, "3 * 2 * 2 * int64"),
+          ([[1, 2], [3, None]], "2 * 2 * ?int64"),
+          ([True, False], "2 * bool")
+        ]
+
+        for v, t in test_cases:
+            x = xnd(v)
+            self.assertEqual(x.type, ndt(t))
+            self.assertEqual(x.value, v)
+
+        self.assertRaises(ValueError, xnd, [1.0, 2])
+        self.assertRaises(OverflowError, xnd, [2**63])
+
+        test_cases = [
+          ([[1, 2], [3, 4]], "int8", "2 * 2 * int8"),
+          ([1, 2.5], "float64", "2 * float64"),
+          ([1.5, 2.5], "float32", "2 * float32"),
+          ([1, 2], "uint64", "2 * uint64"),
+          ([1, None], "?int16", "2 * ?int16")
+        ]
+
+        for v, dtype, t in test_cases:
+            x = xnd(v, dtype=dtype)
+            self.assertEqual(x.type, ndt(t))
+            self.assertEqual(x.value, v)
+
+        self.assertRaises(ValueError, xnd, [1, 300], dtype="int8")
+        self.assertRaises(OverflowError, xnd, [-1], dtype="uint8")
+        self.assertRaises(OverflowError, xnd, [1e300], dtype="float32")
+        self.assertRaises(TypeError, xnd, [1.5], dtype="int64")
+
+    def test_buffer(self):
+        import array
+
+        a = array.array('d', [1.0, 2.0, 3.0])
+        x = xnd(a)
+        self.assertEqual(x.type, ndt("3 * float64"))
+        self.assertEqual(x.value, [1.0, 2.0, 3.0])
+
+        # The data is copied.
+        a[0] = 10.0
+        self.assertEqual(x[0], 1.0)
+
+        x = xnd(bytearray(b"ab"))
+        self.assertEqual(x.type, ndt("2 * uint8"))
+        self.assertEqual(x.value, [97, 98])
+
+        # bytes objects remain scalars unless a type is given.
+        x = xnd(b"ab")
+        self.assertEqual(x.type, ndt("bytes"))
+        x = xnd(b"ab", type="2 * uint8")
+        self.assertEqual(x.value, [97, 98])
+
+        nd = ndarray(list(range(12)), shape=[3, 4], format='i')[::2, ::-1]
+        x = xnd(nd)
+        self.assertEqual(x.type, ndt("2 * 4 * int32"))
+        self.assertEqual(x.value, nd.tolist())
+
+        x = xnd([array.array('q', [1, 2]), array.array('q', [3, 4])])
+        self.assertEqual(x.type, ndt("2 * 2 * int64"))
+        self.assertEqual(x.value, [[1, 2], [3, 4]])
+
+        self.assertRaises(TypeError, xnd, a, type="3 * float32")
+        self.assertRaises(ValueError, xnd, a, type="2 * float64")
+        self.assertRaises(TypeError, xnd, b"ab", type="2 * int8")
+
 
 class TestIndexing(XndTestCase):
 
@@ -3626,6 +3732,91 @@ class TestBuffer(XndTestCase):
         self.assertEqual(x.tolist(), [1000, 2000, 3000])
         check_copy_contiguous(self, y)
 
+    def test_getbuf_flags(self):
+        x = xnd([[1, 2, 3], [4, 5, 6]], dtype="int16")
+        data = x.tobytes()
+
+        for flags in [PyBUF_SIMPLE, PyBUF_WRITABLE, PyBUF_ND, PyBUF_CONTIG,
+                      PyBUF_CONTIG_RO, PyBUF_STRIDES, PyBUF_STRIDED_RO,
+                      PyBUF_C_CONTIGUOUS, PyBUF_ANY_CONTIGUOUS,
+                      PyBUF_RECORDS_RO, PyBUF_FULL, PyBUF_FULL_RO]:
+            y = ndarray(x, getbuf=flags)
+            self.assertEqual(y.tobytes(), data)
+            self.assertEqual(y.readonly, False)
+
+            if flags & PyBUF_ND == PyBUF_ND:
+                self.assertEqual(y.shape, (2, 3))
+            if flags & PyBUF_FORMAT:
+                self.assertEqual(y.format, "=h")
+
+        self.assertRaises(BufferError, ndarray, x, getbuf=PyBUF_F_CONTIGUOUS)
+        self.assertRaises(BufferError, ndarray, x, getbuf=PyBUF_FORMAT)
+
+        # non-contiguous
+        x = xnd([[1, 2, 3], [4, 5, 6]], dtype="int16").transpose()
+        y = ndarray(x, getbuf=PyBUF_F_CONTIGUOUS)
+        self.assertEqual(y.strides, (2, 6))
+
+        for flags in [PyBUF_SIMPLE, PyBUF_ND, PyBUF_C_CONTIGUOUS]:
+            self.assertRaises(BufferError, ndarray, x, getbuf=flags)
+
+        x = xnd([1, 2, 3, 4])[::2]
+        y = ndarray(x, getbuf=PyBUF_FULL_RO)
+        self.assertEqual(y.tolist(), [1, 3])
+        for flags in [PyBUF_SIMPLE, PyBUF_ANY_CONTIGUOUS]:
+            self.assertRaises(BufferError, ndarray, x, getbuf=flags)
+
+        # scalars
+        x = xnd(1.5)
+        y = ndarray(x, getbuf=PyBUF_SIMPLE)
+        self.assertEqual(y.tobytes(), x.tobytes())
+        self.assertEqual(memoryview(x).shape, ())
+
+        # read-only
+        x = xnd.from_buffer(b"abcd")
+        self.assertTrue(memoryview(x).readonly)
+        self.assertRaises(BufferError, ndarray, x, getbuf=PyBUF_WRITABLE)
+
+        # consumers of simple buffers
+        import hashlib, zlib
+        x = xnd([1.0, 2.0, 3.0])
+        self.assertEqual(hashlib.sha256(x).digest(),
+                         hashlib.sha256(x.tobytes()).digest())
+        self.assertEqual(zlib.decompress(zlib.compress(x)), x.tobytes())
+
+    def test_pickle_protocol_5(self):
+        import pickle
+
+        x = xnd([[1, 2, 3], [4, 5, 6]], dtype="float32")
+        for protocol in range(2, pickle.HIGHEST_PROTOCOL+1):
+            y = pickle.loads(pickle.dumps(x, protocol=protocol))
+            self.assertTrue(y.strict_equal(x))
+
+        # out-of-band data is not copied
+        x = xnd([[float(i*100 + j) for j in range(100)] for i in range(10)])
+        buffers = []
+        s = pickle.dumps(x, protocol=5, buffer_callback=buffers.append)
+        self.assertEqual(len(buffers), 1)
+        self.assertLess(len(s), x.type.datasize)
+
+        y = pickle.loads(s, buffers=buffers)
+        self.assertTrue(y.strict_equal(x))
+        y[0, 0] = 100.0
+        self.assertEqual(x[0, 0], 100.0)
+
+        # views, records and scalars
+        for v in [x.transpose(), x[1:], x[::-1], xnd(2.5),
+                  xnd({'a': 1, 'b': 2.0}), xnd([[1], [2, 3]])]:
+            y = pickle.loads(pickle.dumps(v, protocol=5))
+            self.assertEqual(y, v)
+            self.assertEqual(y.type.ndim, v.type.ndim)
+
+        # read-only data stays read-only
+        x = xnd.from_buffer(b"abcd")
+        y = pickle.loads(pickle.dumps(x, protocol=5))
+        self.assertEqual(y, x)
+        self.assertRaises(TypeError, y.__setitem__, 0, 1)
+
     @unittest.skipIf(np is None, "numpy not found")
     def test_complex(self):
         x = xnd([1, 2, 3], dtype="complex64")
@@ -43,7 +43,7 @@ data.
 Importing PEP-3118 buffers is supported.
 """
 
-import sys, os
+import sys, os, pickle
 if sys.platform == "cygwin" or sys.platform == "win32":
     cur = os.path.dirname(__file__)
     install_dlldir = os.path.abspath(os.path.join(cur, "..\\xndlib\\bin"))
@@ -118,11 +118,14 @@ class xnd(Xnd):
             raise TypeError(
                 "the 'type', 'dtype', 'levels' and 'typedef' arguments are "
                 "mutually exclusive")
+        # If no type is given, the C constructor infers it.  Homogeneous
+        # numeric nested lists are then inferred and converted in one pass.
         if type is not None:
             if isinstance(type, str):
                 type = ndt(type)
         elif dtype is not None:
-            type = typeof(value, dtype=dtype)
+            if isinstance(dtype, str):
+                dtype = ndt(dtype)
         elif levels is not None:
             args = ', '.join("'%s'" % l if l is not None else 'NA' for l in levels)
             t = "%d * categorical(%s)" % (len(value), args)
@@ -130,21 +133,18 @@ class xnd(Xnd):
         elif typedef is not None:
             type = ndt(typedef)
             if type.isabstract():
-                dtype = type.hidden_dtype
-                t = typeof(value, dtype=dtype)
+                t = typeof(value, dtype=type.hidden_dtype)
                 type = instantiate(typedef, t)
         elif dtypedef is not None:
             dtype = ndt(dtypedef)
-            type = typeof(value, dtype=dtype)
-        else:
-            type = typeof(value)
 
         if device is not None:
             name, no = device.split(":")
             no = -1 if no == "managed" else int(no)
             device = (name, no)
 
-        return super().__new__(cls, type=type, value=value, device=device)
+        return super().__new__(cls, type=type, value=value, device=device,
+                               dtype=dtype)
 
     def __repr__(self):
         value = self.short_value(maxshape=10)
@@ -158,6 +158,22 @@ class xnd(Xnd):
         b =  self.serialize()
         return (xnd.deserialize, (b,))
 
+    def __reduce_ex__(self, protocol):
+        # Protocol 5: the data of ndarrays with a PEP-3118 format is
+        # passed out-of-band and not copied.
+        buf = None
+        if protocol >= 5:
+            try:
+                buf = pickle.PickleBuffer(self)
+            except ValueError:
+                pass
+        if buf is None:
+            return self.__reduce__()
+        if not self.type.is_c_contiguous():
+            self = self.copy_contiguous()
+            buf = pickle.PickleBuffer(self)
+        return (type(self)._from_pickle_buffer, (buf, self.type))
+
     def copy_contiguous(self, dtype=None):
         if isinstance(dtype, str):
             dtype = ndt(dtype)
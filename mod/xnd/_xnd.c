@@ -148,6 +148,7 @@ static PyTypeObject XndEllipsis_Type = {
 /****************************************************************************/
 
 static int mblock_init(xnd_t * const x, PyObject *v);
+static const ndt_t *typeof_value(PyObject *v, PyObject *dtype, bool shortcut);
 static PyTypeObject MemoryBlock_Type;
 
 
@@ -377,7 +378,7 @@ mblock_from_buffer(PyObject *obj)
 
 static MemoryBlockObject *
 mblock_from_buffer_and_type(PyObject *obj, PyObject *type, int64_t linear_index,
-                            int64_t bufsize)
+                            int64_t bufsize, bool readonly_ok)
 {
     NDT_STATIC_CONTEXT(ctx);
     MemoryBlockObject *self;
@@ -404,7 +405,7 @@ mblock_from_buffer_and_type(PyObject *obj, PyObject *type, int64_t linear_index,
         return NULL;
     }
 
-    if (self->view->readonly) {
+    if (self->view->readonly && !readonly_ok) {
         PyErr_SetString(PyExc_ValueError, "buffer is readonly");
         Py_DECREF(self);
         return NULL;
@@ -596,6 +597,214 @@ union_tag_and_value_from_tuple(uint8_t *tag, PyObject **value, const ndt_t *t, P
     return 0;
 }
 
+/*
+ * Fast paths for homogeneous numeric lists.  Python floats and ints of the
+ * exact builtin types are unpacked in a tight loop; everything else falls
+ * back to the generic per-element conversion in mblock_init().
+ */
+static inline bool
+is_fast_dtype(const ndt_t *t)
+{
+    if (ndt_is_optional(t) || (t->flags & XND_REV_COND)) {
+        return false;
+    }
+
+    switch (t->tag) {
+    case Bool:
+    case Int8: case Int16: case Int32: case Int64:
+    case Uint8: case Uint16: case Uint32: case Uint64:
+    case Float32: case Float64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+#define FAST_PACK_INT(type, min, max) \
+    if (PyLong_CheckExact(v)) {                                        \
+        long long _v = PyLong_AsLongLong(v);                           \
+        type _x;                                                       \
+        if (_v == -1 && PyErr_Occurred()) {                            \
+            return -1;                                                 \
+        }                                                              \
+        if (_v < min || _v > max) {                                    \
+            PyErr_Format(PyExc_ValueError,                             \
+                "out of range: %" PRIi64, (int64_t)_v);                \
+            return -1;                                                 \
+        }                                                              \
+        _x = (type)_v;                                                 \
+        memcpy(ptr, &_x, sizeof _x);                                   \
+        return 0;                                                      \
+    }                                                                  \
+    return 1
+
+#define FAST_PACK_UINT(type, max) \
+    if (PyLong_CheckExact(v)) {                                             \
+        unsigned long long _v = PyLong_AsUnsignedLongLong(v);               \
+        type _x;                                                            \
+        if (_v == (unsigned long long)-1 && PyErr_Occurred()) {             \
+            return -1;                                                      \
+        }                                                                   \
+        if (_v > max) {                                                     \
+            PyErr_Format(PyExc_ValueError,                                  \
+                "out of range: %" PRIu64, (uint64_t)_v);                    \
+            return -1;                                                      \
+        }                                                                   \
+        _x = (type)_v;                                                      \
+        memcpy(ptr, &_x, sizeof _x);                                        \
+        return 0;                                                           \
+    }                                                                       \
+    return 1
+
+/*
+ * Pack 'v' into 'ptr' for a dtype that satisfies is_fast_dtype().  Return 0
+ * on success, -1 on error and 1 if 'v' does not have the exact builtin type
+ * expected by the fast path.  If 'exact' is false, ints are also accepted for
+ * floating point dtypes.
+ */
+static inline int
+fast_pack(char *ptr, const ndt_t *t, PyObject *v, bool exact)
+{
+    switch (t->tag) {
+    case Bool: {
+        if (v == Py_True || v == Py_False) {
+            bool b = v == Py_True;
+            memcpy(ptr, &b, sizeof b);
+            return 0;
+        }
+        return 1;
+    }
+    case Int8: { FAST_PACK_INT(int8_t, INT8_MIN, INT8_MAX); }
+    case Int16: { FAST_PACK_INT(int16_t, INT16_MIN, INT16_MAX); }
+    case Int32: { FAST_PACK_INT(int32_t, INT32_MIN, INT32_MAX); }
+    case Int64: { FAST_PACK_INT(int64_t, INT64_MIN, INT64_MAX); }
+    case Uint8: { FAST_PACK_UINT(uint8_t, UINT8_MAX); }
+    case Uint16: { FAST_PACK_UINT(uint16_t, UINT16_MAX); }
+    case Uint32: { FAST_PACK_UINT(uint32_t, UINT32_MAX); }
+    case Uint64: { FAST_PACK_UINT(uint64_t, UINT64_MAX); }
+    case Float32: case Float64: {
+        double d;
+        if (PyFloat_CheckExact(v)) {
+            d = PyFloat_AS_DOUBLE(v);
+        }
+        else if (!exact && PyLong_CheckExact(v)) {
+            d = PyLong_AsDouble(v);
+            if (d == -1 && PyErr_Occurred()) {
+                return -1;
+            }
+        }
+        else {
+            return 1;
+        }
+        if (t->tag == Float32) {
+            return PyFloat_Pack4(d, UCHAR_CAST(ptr), le(t->flags));
+        }
+        memcpy(ptr, &d, sizeof d);
+        return 0;
+    }
+    default:
+        return 1;
+    }
+}
+
+#undef FAST_PACK_INT
+#undef FAST_PACK_UINT
+
+/* Innermost fixed dimension with a fast dtype: 'v' is a list of size shape. */
+static int
+mblock_init_fast(xnd_t * const x, PyObject *v)
+{
+    const ndt_t * const t = x->type;
+    const ndt_t * const u = t->FixedDim.type;
+    const int64_t shape = t->FixedDim.shape;
+    const int64_t step = t->Concrete.FixedDim.step;
+    int64_t i;
+    int ret;
+
+    assert(t->tag == FixedDim && is_fast_dtype(u));
+
+    for (i = 0; i < shape; i++) {
+        PyObject *item = PyList_GET_ITEM(v, i);
+        char *ptr = x->ptr + (x->index + i * step) * u->datasize;
+
+        ret = fast_pack(ptr, u, item, false);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret > 0) {
+            xnd_t next = xnd_fixed_dim_next(x, i);
+            if (mblock_init(&next, item) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Copy a PEP-3118 buffer (array.array, bytes, ...) into a C-contiguous
+ * ndarray.  Shape and item format of the exporter must match the xnd type.
+ */
+static int
+mblock_init_buffer(xnd_t * const x, PyObject *v)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    const ndt_t * const t = x->type;
+    const ndt_t * const dtype = ndt_dtype(t);
+    const ndt_t *u;
+    Py_buffer view;
+    int ret = -1;
+    int i;
+
+    if (!ndt_is_c_contiguous(t) || !ndt_is_pointer_free(dtype) ||
+        ndt_subtree_is_optional(dtype)) {
+        PyErr_Format(PyExc_TypeError,
+            "xnd: expected list, not '%.200s'", Py_TYPE(v)->tp_name);
+        return -1;
+    }
+
+    if (PyObject_GetBuffer(v, &view, PyBUF_FULL_RO) < 0) {
+        return -1;
+    }
+
+    if (view.ndim != t->ndim) {
+        PyErr_Format(PyExc_ValueError,
+            "xnd: expected buffer with %d dimensions", t->ndim);
+        goto out;
+    }
+
+    for (i = 0, u = t; i < view.ndim; i++, u = u->FixedDim.type) {
+        if (view.shape[i] != u->FixedDim.shape) {
+            PyErr_Format(PyExc_ValueError,
+                "xnd: expected buffer with size %" PRIi64 " in dimension %d",
+                u->FixedDim.shape, i);
+            goto out;
+        }
+    }
+
+    u = ndt_from_bpformat(view.format, &ctx);
+    if (u == NULL) {
+        (void)seterr(&ctx);
+        goto out;
+    }
+
+    if (!ndt_equal(u, dtype) || view.itemsize != dtype->datasize) {
+        PyErr_Format(PyExc_TypeError,
+            "xnd: buffer format '%s' does not match dtype", view.format);
+        ndt_decref(u);
+        goto out;
+    }
+    ndt_decref(u);
+
+    ret = PyBuffer_ToContiguous(x->ptr + x->index * dtype->datasize, &view,
+                                view.len, 'C');
+
+out:
+    PyBuffer_Release(&view);
+    return ret;
+}
+
 static int
 mblock_init(xnd_t * const x, PyObject *v)
 {
@@ -633,6 +842,9 @@ mblock_init(xnd_t * const x, PyObject *v)
         int64_t i;
 
         if (!PyList_Check(v)) {
+            if (PyObject_CheckBuffer(v)) {
+                return mblock_init_buffer(x, v);
+            }
             PyErr_Format(PyExc_TypeError,
                 "xnd: expected list, not '%.200s'", Py_TYPE(v)->tp_name);
             return -1;
@@ -644,6 +856,10 @@ mblock_init(xnd_t * const x, PyObject *v)
             return -1;
         }
 
+        if (is_fast_dtype(t->FixedDim.type)) {
+            return mblock_init_fast(x, v);
+        }
+
         for (i = 0; i < shape; i++) {
             xnd_t next = xnd_fixed_dim_next(x, i);
             if (mblock_init(&next, PyList_GET_ITEM(v, i)) < 0) {
@@ -1446,18 +1662,175 @@ device_flags(PyObject *tuple)
     return XND_CUDA_MANAGED;
 }
 
+/*
+ * Type inference and conversion in a single pass for rectangular nested
+ * lists of floats or ints.  The shape is taken from the first element in
+ * each dimension, the dtype from the first leaf or from 'dtype'.  Return 1
+ * and set 'mblock' on success, 0 if the value does not qualify (the general
+ * typeof() path then produces the result or the error message) and -1 on
+ * error.
+ */
+static int
+list_fast_fill(char **ptr, const ndt_t *dtype, bool exact,
+               const int64_t *shape, int ndim, PyObject *v)
+{
+    Py_ssize_t i;
+    int ret;
+
+    if (!PyList_Check(v) || PyList_GET_SIZE(v) != shape[0]) {
+        return 0;
+    }
+
+    if (ndim == 1) {
+        for (i = 0; i < shape[0]; i++) {
+            ret = fast_pack(*ptr, dtype, PyList_GET_ITEM(v, i), exact);
+            if (ret != 0) {
+                return ret < 0 ? -1 : 0;
+            }
+            *ptr += dtype->datasize;
+        }
+        return 1;
+    }
+
+    for (i = 0; i < shape[0]; i++) {
+        ret = list_fast_fill(ptr, dtype, exact, shape+1, ndim-1,
+                             PyList_GET_ITEM(v, i));
+        if (ret <= 0) {
+            return ret;
+        }
+    }
+
+    return 1;
+}
+
+static int
+mblock_from_list_fast(MemoryBlockObject **mblock, PyObject *v,
+                      const ndt_t *dtype, uint32_t flags)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    int64_t shape[NDT_MAX_DIM];
+    MemoryBlockObject *self;
+    PyObject *type;
+    PyObject *leaf;
+    const ndt_t *t, *u;
+    bool exact = false;
+    char *ptr;
+    int ndim = 0;
+    int i, ret;
+
+    for (leaf = v; PyList_Check(leaf); leaf = PyList_GET_ITEM(leaf, 0)) {
+        if (PyList_GET_SIZE(leaf) == 0 || ndim == NDT_MAX_DIM) {
+            return 0;
+        }
+        shape[ndim++] = PyList_GET_SIZE(leaf);
+    }
+
+    if (dtype != NULL) {
+        if (!is_fast_dtype(dtype)) {
+            return 0;
+        }
+        ndt_incref(dtype);
+    }
+    else {
+        /* Mixed int/float lists do not unify in typeof(). */
+        exact = true;
+        if (PyFloat_CheckExact(leaf)) {
+            dtype = ndt_primitive(Float64, 0, &ctx);
+        }
+        else if (PyLong_CheckExact(leaf)) {
+            dtype = ndt_primitive(Int64, 0, &ctx);
+        }
+        else {
+            return 0;
+        }
+        if (dtype == NULL) {
+            return seterr_int(&ctx);
+        }
+    }
+
+    for (i = ndim-1, t = dtype; i >= 0; i--) {
+        u = ndt_fixed_dim(t, shape[i], INT64_MAX, &ctx);
+        ndt_decref(t);
+        if (u == NULL) {
+            return seterr_int(&ctx);
+        }
+        t = u;
+    }
+
+    type = Ndt_FromType(t);
+    ndt_decref(t);
+    if (type == NULL) {
+        return -1;
+    }
+
+    /* Every element is written below, zeroing is redundant. */
+    self = mblock_empty(type, flags|XND_NO_ZERO);
+    Py_DECREF(type);
+    if (self == NULL) {
+        return -1;
+    }
+
+    ptr = self->xnd->master.ptr;
+    ret = list_fast_fill(&ptr, ndt_dtype(NDT(self->type)), exact, shape, ndim, v);
+    if (ret <= 0) {
+        Py_DECREF(self);
+        return ret;
+    }
+
+    *mblock = self;
+    return 1;
+}
+
+static MemoryBlockObject *
+mblock_from_value(PyObject *value, PyObject *dtype, uint32_t flags)
+{
+    MemoryBlockObject *mblock;
+    PyObject *type;
+    const ndt_t *t;
+
+    if (dtype != Py_None && !Ndt_Check(dtype)) {
+        PyErr_SetString(PyExc_TypeError, "dtype argument must be ndt");
+        return NULL;
+    }
+
+    if (PyList_Check(value)) {
+        switch (mblock_from_list_fast(&mblock, value,
+                    dtype == Py_None ? NULL : NDT(dtype), flags)) {
+        case -1: return NULL;
+        case 1: return mblock;
+        default: break;
+        }
+    }
+
+    t = typeof_value(value, dtype, true);
+    if (t == NULL) {
+        return NULL;
+    }
+
+    type = Ndt_FromType(t);
+    ndt_decref(t);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    mblock = mblock_from_typed_value(type, value, flags);
+    Py_DECREF(type);
+    return mblock;
+}
+
 static PyObject *
 pyxnd_new(PyTypeObject *tp, PyObject *args, PyObject *kwds)
 {
-    static char *kwlist[] = {"type", "value", "device", NULL};
+    static char *kwlist[] = {"type", "value", "device", "dtype", NULL};
     PyObject *type = NULL;
     PyObject *value = NULL;
     PyObject *tuple = Py_None;
+    PyObject *dtype = Py_None;
     MemoryBlockObject *mblock;
     uint32_t flags = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|O", kwlist, &type,
-        &value, &tuple)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OO", kwlist, &type,
+        &value, &tuple, &dtype)) {
         return NULL;
     }
 
@@ -1468,7 +1841,12 @@ pyxnd_new(PyTypeObject *tp, PyObject *args, PyObject *kwds)
         }
     }
 
-    mblock = mblock_from_typed_value(type, value, flags);
+    if (type == Py_None) {
+        mblock = mblock_from_value(value, dtype, flags);
+    }
+    else {
+        mblock = mblock_from_typed_value(type, value, flags);
+    }
     if (mblock == NULL) {
         return NULL;
     }
@@ -1536,7 +1914,31 @@ pyxnd_from_buffer_and_type(PyTypeObject *tp, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    mblock = mblock_from_buffer_and_type(obj, type, 0, -1);
+    mblock = mblock_from_buffer_and_type(obj, type, 0, -1, false);
+    if (mblock == NULL) {
+        return NULL;
+    }
+
+    return pyxnd_from_mblock(tp, mblock);
+}
+
+/*
+ * Reconstruct a pickled xnd object from a PEP-574 buffer without copying.
+ * In contrast to from_buffer_and_type(), read-only buffers are accepted
+ * and result in a read-only xnd object.
+ */
+static PyObject *
+pyxnd_from_pickle_buffer(PyTypeObject *tp, PyObject *args)
+{
+    PyObject *obj;
+    PyObject *type;
+    MemoryBlockObject *mblock;
+
+    if (!PyArg_ParseTuple(args, "OO", &obj, &type)) {
+        return NULL;
+    }
+
+    mblock = mblock_from_buffer_and_type(obj, type, 0, -1, true);
     if (mblock == NULL) {
         return NULL;
     }
@@ -1566,6 +1968,72 @@ dict_set_item(PyObject *dict, const char *k, PyObject *value)
     return ret;
 }
 
+/*
+ * Innermost fixed dimension with a native, non-optional numeric dtype:
+ * read the raw memory directly without the per-element type switch and
+ * bitmap lookup.
+ */
+#define FAST_UNPACK(type, convert) \
+    for (i = 0; i < shape; i++) {                                 \
+        type _x;                                                  \
+        if (i == maxshape-1) {                                    \
+            PyList_SET_ITEM(lst, i, xnd_ellipsis());              \
+            break;                                                \
+        }                                                         \
+        memcpy(&_x, ptr + i * step, sizeof _x);                   \
+        v = convert(_x);                                          \
+        if (v == NULL) {                                          \
+            Py_DECREF(lst);                                       \
+            return NULL;                                          \
+        }                                                         \
+        PyList_SET_ITEM(lst, i, v);                               \
+    }                                                             \
+    return lst
+
+static PyObject *
+_pyxnd_value_fast(const xnd_t * const x, const int64_t maxshape)
+{
+    const ndt_t * const t = x->type;
+    const ndt_t * const u = t->FixedDim.type;
+    const int64_t step = t->Concrete.FixedDim.step * u->datasize;
+    const char * const ptr = x->ptr + x->index * u->datasize;
+    PyObject *lst, *v;
+    int64_t shape, i;
+
+    assert(t->tag == FixedDim && is_fast_dtype(u));
+
+    shape = t->FixedDim.shape;
+    if (shape > maxshape) {
+        shape = maxshape;
+    }
+
+    lst = list_new(shape);
+    if (lst == NULL) {
+        return NULL;
+    }
+
+    switch (u->tag) {
+    case Bool: FAST_UNPACK(bool, PyBool_FromLong);
+    case Int8: FAST_UNPACK(int8_t, PyLong_FromLong);
+    case Int16: FAST_UNPACK(int16_t, PyLong_FromLong);
+    case Int32: FAST_UNPACK(int32_t, PyLong_FromLong);
+    case Int64: FAST_UNPACK(int64_t, PyLong_FromLongLong);
+    case Uint8: FAST_UNPACK(uint8_t, PyLong_FromUnsignedLong);
+    case Uint16: FAST_UNPACK(uint16_t, PyLong_FromUnsignedLong);
+    case Uint32: FAST_UNPACK(uint32_t, PyLong_FromUnsignedLong);
+    case Uint64: FAST_UNPACK(uint64_t, PyLong_FromUnsignedLongLong);
+    case Float32: FAST_UNPACK(float, PyFloat_FromDouble);
+    case Float64: FAST_UNPACK(double, PyFloat_FromDouble);
+    default:
+        Py_DECREF(lst);
+        PyErr_SetString(PyExc_RuntimeError,
+            "internal error: unexpected dtype in _pyxnd_value_fast");
+        return NULL;
+    }
+}
+
+#undef FAST_UNPACK
+
 static PyObject *
 _pyxnd_value(const xnd_t * const x, const int64_t maxshape)
 {
@@ -1584,6 +2052,10 @@ _pyxnd_value(const xnd_t * const x, const int64_t maxshape)
         PyObject *lst, *v;
         int64_t shape, i;
 
+        if (is_fast_dtype(t->FixedDim.type)) {
+            return _pyxnd_value_fast(x, maxshape);
+        }
+
         shape = t->FixedDim.shape;
         if (shape > maxshape) {
             shape = maxshape;
@@ -2658,7 +3130,19 @@ pyxnd_ndim(PyObject *self, PyObject *args UNUSED)
 static PyObject *
 pyxnd_value(PyObject *self, PyObject *args UNUSED)
 {
+#if PY_VERSION_HEX >= 0x030A0000
+    /* The conversion creates no reference cycles.  For large arrays the
+       young generation would otherwise be scanned over and over while the
+       nested lists are being filled. */
+    const int enabled = PyGC_Disable();
+    PyObject *v = _pyxnd_value(XND(self), INT64_MAX);
+    if (enabled) {
+        PyGC_Enable();
+    }
+    return v;
+#else
     return _pyxnd_value(XND(self), INT64_MAX);
+#endif
 }
 
 static PyObject *
@@ -2971,6 +3455,7 @@ static PyMethodDef pyxnd_methods [] =
   { "from_buffer", (PyCFunction)pyxnd_from_buffer, METH_O|METH_CLASS, doc_from_buffer },
   { "from_buffer_and_type", (PyCFunction)pyxnd_from_buffer_and_type, METH_VARARGS|METH_KEYWORDS|METH_CLASS, NULL },
   { "deserialize", (PyCFunction)pyxnd_deserialize, METH_O|METH_CLASS, NULL },
+  { "_from_pickle_buffer", (PyCFunction)pyxnd_from_pickle_buffer, METH_VARARGS|METH_CLASS, NULL },
 
   { NULL, NULL, 1, NULL }
 };
@@ -3032,83 +3517,170 @@ buffer_dealloc(BufferProxyObject *self)
     PyObject_Del(self);
 }
 
+/*
+ * Format strings of primitive dtypes, indexed by tag and byte order.  They
+ * are created on first use and live as long as the module.
+ */
+#define NUM_PRIMITIVE (Complex128-Bool+1)
+static char *bpformat_cache[NUM_PRIMITIVE][3];
+
+static const char *
+cached_bpformat(const ndt_t *dtype, ndt_context_t *ctx)
+{
+    char **cache;
+
+    if (dtype->tag < Bool || dtype->tag > Complex128 || ndt_is_optional(dtype)) {
+        return NULL;
+    }
+
+    cache = &bpformat_cache[dtype->tag-Bool][
+        !ndt_endian_is_set(dtype) ? 0 : ndt_is_little_endian(dtype) ? 1 : 2];
+
+    if (*cache == NULL) {
+        *cache = ndt_to_bpformat(dtype, ctx);
+    }
+
+    return *cache;
+}
+
+#define REQ_WRITABLE(flags) (flags & PyBUF_WRITABLE)
+#define REQ_FORMAT(flags) (flags & PyBUF_FORMAT)
+#define REQ_SHAPE(flags) ((flags & PyBUF_ND) == PyBUF_ND)
+#define REQ_STRIDES(flags) ((flags & PyBUF_STRIDES) == PyBUF_STRIDES)
+#define REQ_C_CONTIGUOUS(flags) ((flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS)
+#define REQ_F_CONTIGUOUS(flags) ((flags & PyBUF_F_CONTIGUOUS) == PyBUF_F_CONTIGUOUS)
+#define REQ_ANY_CONTIGUOUS(flags) ((flags & PyBUF_ANY_CONTIGUOUS) == PyBUF_ANY_CONTIGUOUS)
+
+/*
+ * Export ndarrays for all request types.  Requests without shape and format
+ * do not need a proxy, which is only allocated for the shape and strides
+ * arrays and for format strings that are not cached.
+ */
 static int
-fill_buffer(Py_buffer *view, const xnd_t *x, ndt_context_t *ctx)
+pyxnd_getbuf(XndObject *self, Py_buffer *view, int flags)
 {
+    NDT_STATIC_CONTEXT(ctx);
+    const xnd_t *x = XND(self);
     const ndt_t *t = x->type;
-    char *fmt;
-    Py_ssize_t len;
-    int i;
+    const ndt_t *dtype;
+    BufferProxyObject *proxy;
+    const char *fmt = NULL;
+    char *owned = NULL;
+    Py_ssize_t itemsize, len;
+    int c, f;
 
     assert(t->ndim <= NDT_MAX_DIM);
     assert(ndt_is_concrete(t));
 
-    fmt = ndt_to_bpformat(ndt_dtype(t), ctx);
-    if (fmt == NULL) {
+    if (!ndt_is_ndarray(t)) {
+        PyErr_SetString(PyExc_ValueError,
+            "buffer protocol only supports ndarrays");
         return -1;
     }
 
-    view->ndim = t->ndim;
-    view->format = fmt;
-    view->suboffsets = NULL;
+    dtype = ndt_dtype(t);
+    if (REQ_FORMAT(flags)) {
+        fmt = cached_bpformat(dtype, &ctx);
+        if (fmt == NULL) {
+            if (ndt_err_occurred(&ctx)) {
+                return seterr_int(&ctx);
+            }
+            fmt = owned = ndt_to_bpformat(dtype, &ctx);
+            if (fmt == NULL) {
+                return seterr_int(&ctx);
+            }
+        }
+    }
 
-    if (!ndt_is_ndarray(t)) {
-        ndt_err_format(ctx, NDT_ValueError,
-            "buffer protocol only supports ndarrays");
-        return -1;
+    if (REQ_WRITABLE(flags) && is_readonly(self)) {
+        PyErr_SetString(PyExc_BufferError, "xnd object is read-only");
+        goto error;
+    }
+
+    c = ndt_is_c_contiguous(t);
+    f = ndt_is_f_contiguous(t);
+
+    if (REQ_C_CONTIGUOUS(flags) && !c) {
+        PyErr_SetString(PyExc_BufferError, "xnd object is not C-contiguous");
+        goto error;
+    }
+    if (REQ_F_CONTIGUOUS(flags) && !f) {
+        PyErr_SetString(PyExc_BufferError, "xnd object is not Fortran contiguous");
+        goto error;
+    }
+    if (REQ_ANY_CONTIGUOUS(flags) && !c && !f) {
+        PyErr_SetString(PyExc_BufferError, "xnd object is not contiguous");
+        goto error;
+    }
+    if (!REQ_SHAPE(flags) && REQ_FORMAT(flags)) {
+        PyErr_SetString(PyExc_BufferError,
+            "a request for the format requires a request for the shape");
+        goto error;
+    }
+    if (!REQ_STRIDES(flags) && !c) {
+        PyErr_SetString(PyExc_BufferError,
+            "xnd object is not C-contiguous, a strided request is required");
+        goto error;
     }
 
     if (t->ndim == 0) {
-        view->len = (Py_ssize_t)t->datasize;
-        view->itemsize = (Py_ssize_t)t->datasize;
-        view->shape = NULL;
-        view->strides = NULL;
+        itemsize = (Py_ssize_t)t->datasize;
         view->buf = x->ptr + x->index * t->datasize;
-        return 0;
+    }
+    else {
+        itemsize = (Py_ssize_t)t->Concrete.FixedDim.itemsize;
+        view->buf = x->ptr + x->index * itemsize;
     }
 
-    view->itemsize = (Py_ssize_t)t->Concrete.FixedDim.itemsize;
-    view->buf = x->ptr + x->index * view->itemsize;
-
-    len = 1;
-    for (i=0; t->ndim > 0; i++, t=t->FixedDim.type) {
-        view->shape[i] = (Py_ssize_t)t->FixedDim.shape;
-        view->strides[i] = (Py_ssize_t)(t->Concrete.FixedDim.step * view->itemsize);
-        len *= view->shape[i];
+    len = itemsize;
+    for (const ndt_t *u = t; u->ndim > 0; u = u->FixedDim.type) {
+        len *= (Py_ssize_t)u->FixedDim.shape;
     }
-    len *=  view->itemsize;
 
     view->len = len;
+    view->itemsize = itemsize;
+    view->readonly = is_readonly(self);
+    view->format = (char *)fmt;
+    view->suboffsets = NULL;
+    view->internal = NULL;
 
-    return 0;
-}
-
-static int
-pyxnd_getbuf(XndObject *self, Py_buffer *view, int flags)
-{
-    NDT_STATIC_CONTEXT(ctx);
-    BufferProxyObject *proxy;
+    if (!REQ_SHAPE(flags) || t->ndim == 0) {
+        view->ndim = REQ_SHAPE(flags) ? 0 : 1;
+        view->shape = NULL;
+        view->strides = NULL;
 
-    if (flags != PyBUF_FULL && flags != PyBUF_FULL_RO) {
-        PyErr_SetString(PyExc_ValueError,
-            "only PyBUF_FULL and PyBUF_FULL_RO requests are supported");
-        return -1;
+        if (owned == NULL) {
+            Py_INCREF(self);
+            view->obj = (PyObject *)self;
+            return 0;
+        }
+    }
+    else {
+        view->ndim = t->ndim;
     }
 
     proxy = buffer_alloc(self);
     if (proxy == NULL) {
-        return -1;
+        goto error;
     }
+    proxy->view.format = owned;
 
-    if (fill_buffer(&proxy->view, XND(self), &ctx) < 0) {
-        Py_DECREF(proxy);
-        return seterr_int(&ctx);
+    if (view->ndim > 0 && REQ_SHAPE(flags)) {
+        const ndt_t *u = t;
+        for (int i = 0; u->ndim > 0; i++, u = u->FixedDim.type) {
+            proxy->view.shape[i] = (Py_ssize_t)u->FixedDim.shape;
+            proxy->view.strides[i] = (Py_ssize_t)(u->Concrete.FixedDim.step * itemsize);
+        }
+        view->shape = proxy->view.shape;
+        view->strides = REQ_STRIDES(flags) ? proxy->view.strides : NULL;
     }
 
-    *view = proxy->view;
     view->obj = (PyObject *)proxy;
-
     return 0;
+
+error:
+    ndt_free(owned);
+    return -1;
 }
 
 static void
@@ -3119,6 +3691,18 @@ pyxnd_releasebuf(XndObject *self UNUSED, Py_buffer *view UNUSED)
 }
 
 
+/* Consumers like PickleBuffer re-export 'view->obj'. */
+static int
+buffer_getbuf(BufferProxyObject *self, Py_buffer *view, int flags)
+{
+    return pyxnd_getbuf(self->xnd, view, flags);
+}
+
+static PyBufferProcs buffer_as_buffer = {
+    (getbufferproc)buffer_getbuf,        /* bf_getbuffer */
+    NULL,                                /* bf_releasebuffer */
+};
+
 static PyTypeObject BufferProxy_Type =
 {
     PyVarObject_HEAD_INIT(NULL, 0)
@@ -3126,6 +3710,7 @@ static PyTypeObject BufferProxy_Type =
     .tp_basicsize = offsetof(BufferProxyObject, ob_array),
     .tp_itemsize = sizeof(Py_ssize_t),
     .tp_dealloc = (destructor) buffer_dealloc,
+    .tp_as_buffer = &buffer_as_buffer,
     .tp_hash = PyObject_HashNotImplemented,
     .tp_getattro = (getattrofunc) PyObject_GenericGetAttr,
     .tp_flags = Py_TPFLAGS_DEFAULT,
@@ -3937,6 +4522,30 @@ typeof_dict(PyObject *v, bool replace_any, bool shortcut)
     return t == NULL ? seterr_ndt(&ctx) : t;
 }
 
+/* Contiguous array type for a PEP-3118 exporter other than bytes. */
+static const ndt_t *
+typeof_buffer(PyObject *v)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    Py_buffer view;
+    PyObject *type;
+    const ndt_t *t;
+
+    if (PyObject_GetBuffer(v, &view, PyBUF_FULL_RO) < 0) {
+        return NULL;
+    }
+
+    type = type_from_buffer(&view);
+    PyBuffer_Release(&view);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    t = ndt_copy_contiguous(NDT(type), 0, &ctx);
+    Py_DECREF(type);
+    return t == NULL ? seterr_ndt(&ctx) : t;
+}
+
 static const ndt_t *
 typeof(PyObject *v, bool replace_any, bool shortcut)
 {
@@ -3980,6 +4589,9 @@ typeof(PyObject *v, bool replace_any, bool shortcut)
             t = ndt_any_kind(true, &ctx);
         }
     }
+    else if (PyObject_CheckBuffer(v)) {
+        return typeof_buffer(v);
+    }
     else {
         PyErr_SetString(PyExc_ValueError, "type inference failed");
         return NULL;
@@ -3988,6 +4600,25 @@ typeof(PyObject *v, bool replace_any, bool shortcut)
     return t == NULL ? seterr_ndt(&ctx) : t;
 }
 
+/* Type of 'v', with the dtype taken from 'dtype' if it is not None. */
+static const ndt_t *
+typeof_value(PyObject *v, PyObject *dtype, bool shortcut)
+{
+    const ndt_t *t;
+
+    if (dtype == Py_None) {
+        return typeof(v, true, shortcut);
+    }
+
+    if (PyList_Check(v)) {
+        return typeof_list_top(v, NDT(dtype));
+    }
+
+    t = NDT(dtype);
+    ndt_incref(t);
+    return t;
+}
+
 static PyObject *
 xnd_typeof(PyObject *m UNUSED, PyObject *args, PyObject *kwds)
 {
@@ -4003,24 +4634,12 @@ xnd_typeof(PyObject *m UNUSED, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    if (dtype != Py_None) {
-        if (!Ndt_Check(dtype)) {
-            PyErr_Format(PyExc_ValueError, "dtype argument must be ndt");
-            return NULL;
-        }
-
-        if (PyList_Check(value)) {
-            t = typeof_list_top(value, NDT(dtype));
-        }
-        else {
-            t = NDT(dtype);
-            ndt_incref(t);
-        }
-    }
-    else {
-        t = typeof(value, true, (bool)shortcut);
+    if (dtype != Py_None && !Ndt_Check(dtype)) {
+        PyErr_Format(PyExc_ValueError, "dtype argument must be ndt");
+        return NULL;
     }
 
+    t = typeof_value(value, dtype, (bool)shortcut);
     if (t == NULL) {
         return NULL;
     }
@@ -151,9 +151,8 @@ ndt_free(void *ptr)
     ndt_freefunc(ptr);
 }
 
-/* aligned calloc */
-void *
-ndt_aligned_calloc(uint16_t alignment, int64_t size)
+static void *
+_aligned_alloc(uint16_t alignment, int64_t size, bool zero)
 {
     bool overflow = 0;
     uintptr_t uintptr, aligned;
@@ -187,7 +186,7 @@ ndt_aligned_calloc(uint16_t alignment, int64_t size)
     }
 #endif
 
-    ptr = ndt_callocfunc((size_t)req, 1);
+    ptr = zero ? ndt_callocfunc((size_t)req, 1) : ndt_mallocfunc((size_t)req);
     if (ptr == NULL) {
         return NULL;
     }
@@ -214,6 +213,20 @@ ndt_aligned_calloc(uint16_t alignment, int64_t size)
     return (void *)aligned;
 }
 
+/* aligned calloc */
+void *
+ndt_aligned_calloc(uint16_t alignment, int64_t size)
+{
+    return _aligned_alloc(alignment, size, true);
+}
+
+/* aligned malloc: the memory is not initialized */
+void *
+ndt_aligned_alloc(uint16_t alignment, int64_t size)
+{
+    return _aligned_alloc(alignment, size, false);
+}
+
 void
 ndt_aligned_free(void *aligned)
 {
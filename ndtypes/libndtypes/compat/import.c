@@ -46,8 +46,9 @@ int ndt_bpdebug = 1;
 
 
 /* The yy_fatal_error() function of flex calls exit(). We intercept the function
-   and do a longjmp() for proper error handling. */
-jmp_buf ndt_bp_lexerror;
+   and do a longjmp() for proper error handling. The jump buffer is per thread,
+   so that concurrent parses do not clobber each other's error handler. */
+NDT_THREAD_LOCAL jmp_buf ndt_bp_lexerror;
 
 
 const ndt_t *
@@ -86,6 +86,12 @@ ndt_err_format(ndt_context_t *ctx, enum ndt_error err, const char *fmt, ...)
     ndt_err_clear(ctx);
     ctx->err = err;
 
+    if (ctx->flags & NDT_Probe) {
+        ctx->msg = ConstMsg;
+        ctx->ConstMsg = fmt;
+        return;
+    }
+
     va_start(ap, fmt);
     va_copy(aq, ap);
 
@@ -129,7 +135,7 @@ ndt_err_append(ndt_context_t *ctx, const char *msg)
     enum ndt_error err = ctx->err;
     char *s;
 
-    if (!ndt_err_occurred(ctx)) {
+    if (!ndt_err_occurred(ctx) || (ctx->flags & NDT_Probe)) {
         return;
     }
 
@@ -163,6 +169,26 @@ ndt_err_clear(ndt_context_t *ctx)
     }
 }
 
+/*
+ * Enter probe mode and return the previous flags for ndt_probe_end().  The
+ * calls can be nested.
+ */
+uint32_t
+ndt_probe_begin(ndt_context_t *ctx)
+{
+    const uint32_t saved = ctx->flags & NDT_Probe;
+
+    ctx->flags |= NDT_Probe;
+    return saved;
+}
+
+/* Restore the probe mode that was active before ndt_probe_begin(). */
+void
+ndt_probe_end(ndt_context_t *ctx, uint32_t saved)
+{
+    ctx->flags = (ctx->flags & ~NDT_Probe) | saved;
+}
+
 /* Set a malloc error. */
 void *
 ndt_memory_error(ndt_context_t *ctx)
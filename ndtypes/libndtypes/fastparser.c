@@ -0,0 +1,646 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017-2024, plures
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ndtypes.h>
+
+
+#include "seq.h"
+#include "parsefuncs.h"
+#include "fastparser.h"
+
+
+/*****************************************************************************/
+/*                Recursive descent parser for common types                  */
+/*****************************************************************************/
+
+/*
+ * Hand-written parser for the concrete subset of the datashape grammar that
+ * covers most types seen in practice:
+ *
+ *   datashape := [?] dtype
+ *              | INTEGER * datashape
+ *              | NAME_UPPER * datashape
+ *              | [?] var * datashape
+ *              | [?] var(offsets=[INTEGER {, INTEGER}]) * datashape
+ *
+ *   dtype     := primitive | alias | string | char | NAME_LOWER | NAME_UPPER
+ *              | { [name : datashape {, name : datashape} [,]] }
+ *              | ( [datashape {, datashape} [,]] )
+ *
+ * The types are created with the same constructors that the grammar actions
+ * use, so the results are identical.  Anything else (other attributes,
+ * ellipses, function signatures, comments, ...) and all errors are left to
+ * the bison parser: ndt_fast_from_string() then returns NULL with a clean
+ * context and the caller falls back to the full grammar, which produces the
+ * canonical error message.
+ */
+
+#define FAST_MAX_DEPTH 256
+
+typedef struct {
+    const char *cur;
+    int depth;
+    ndt_context_t *ctx;
+} fast_parser_t;
+
+enum fast_keyword {
+  KwPrimitive,
+  KwAlias,
+  KwString,
+  KwChar,
+  KwVar,
+  KwOther
+};
+
+typedef struct {
+    const char *name;
+    int len;
+    enum fast_keyword kind;
+    int value;
+} fast_keyword_t;
+
+#define KW(name, kind, value) { name, (int)(sizeof name - 1), kind, value }
+
+/* All keywords of the lexer.  Those of kind KwOther are not handled here. */
+static const fast_keyword_t keywords[] = {
+  KW("bool", KwPrimitive, Bool),
+  KW("int8", KwPrimitive, Int8),
+  KW("int16", KwPrimitive, Int16),
+  KW("int32", KwPrimitive, Int32),
+  KW("int64", KwPrimitive, Int64),
+  KW("uint8", KwPrimitive, Uint8),
+  KW("uint16", KwPrimitive, Uint16),
+  KW("uint32", KwPrimitive, Uint32),
+  KW("uint64", KwPrimitive, Uint64),
+  KW("bfloat16", KwPrimitive, BFloat16),
+  KW("float16", KwPrimitive, Float16),
+  KW("float32", KwPrimitive, Float32),
+  KW("float64", KwPrimitive, Float64),
+  KW("bcomplex32", KwPrimitive, BComplex32),
+  KW("complex32", KwPrimitive, Complex32),
+  KW("complex64", KwPrimitive, Complex64),
+  KW("complex128", KwPrimitive, Complex128),
+  KW("intptr", KwAlias, Intptr),
+  KW("uintptr", KwAlias, Uintptr),
+  KW("size_t", KwAlias, Size),
+  KW("string", KwString, 0),
+  KW("char", KwChar, 0),
+  KW("var", KwVar, 0),
+  KW("Any", KwOther, 0),
+  KW("Scalar", KwOther, 0),
+  KW("void", KwOther, 0),
+  KW("signed", KwOther, 0),
+  KW("unsigned", KwOther, 0),
+  KW("float", KwOther, 0),
+  KW("complex", KwOther, 0),
+  KW("bytes", KwOther, 0),
+  KW("FixedString", KwOther, 0),
+  KW("fixed_string", KwOther, 0),
+  KW("FixedBytes", KwOther, 0),
+  KW("fixed_bytes", KwOther, 0),
+  KW("categorical", KwOther, 0),
+  KW("NA", KwOther, 0),
+  KW("ref", KwOther, 0),
+  KW("fixed", KwOther, 0),
+  KW("array", KwOther, 0),
+  KW("of", KwOther, 0),
+  { NULL, 0, KwOther, 0 }
+};
+
+static inline bool
+is_digit(char c)
+{
+    return '0' <= c && c <= '9';
+}
+
+static inline bool
+is_upper(char c)
+{
+    return 'A' <= c && c <= 'Z';
+}
+
+static inline bool
+is_name_start(char c)
+{
+    return ('a' <= c && c <= 'z') || is_upper(c) || c == '_';
+}
+
+static inline bool
+is_name_char(char c)
+{
+    return is_name_start(c) || is_digit(c);
+}
+
+/* Whitespace as defined by the lexer.  Comments are not skipped. */
+static void
+skip_space(fast_parser_t *p)
+{
+    for (;; p->cur++) {
+        switch (*p->cur) {
+        case ' ': case '\t': case '\f': case '\n': case '\r':
+            continue;
+        default:
+            return;
+        }
+    }
+}
+
+static bool
+expect(fast_parser_t *p, char c)
+{
+    skip_space(p);
+    if (*p->cur != c) {
+        return false;
+    }
+    p->cur++;
+    return true;
+}
+
+/* Scan a name token and return its length, 0 if there is no name. */
+static int
+scan_name(fast_parser_t *p, const char **name)
+{
+    const char *s = p->cur;
+
+    if (!is_name_start(*s)) {
+        return 0;
+    }
+
+    for (s++; is_name_char(*s); s++);
+
+    *name = p->cur;
+    p->cur = s;
+
+    return (int)(s - *name);
+}
+
+static const fast_keyword_t *
+lookup_keyword(const char *name, int len)
+{
+    const fast_keyword_t *kw;
+
+    for (kw = keywords; kw->name != NULL; kw++) {
+        if (kw->len == len && memcmp(kw->name, name, len) == 0) {
+            return kw;
+        }
+    }
+
+    return NULL;
+}
+
+static char *
+copy_name(const char *name, int len, ndt_context_t *ctx)
+{
+    char *s;
+
+    s = ndt_alloc_size(len+1);
+    if (s == NULL) {
+        return ndt_memory_error(ctx);
+    }
+
+    memcpy(s, name, len);
+    s[len] = '\0';
+
+    return s;
+}
+
+/*
+ * Decimal integer in [0, max] as matched by the lexer, which must not be
+ * followed by characters that would make it a float or a different token.
+ */
+static bool
+scan_integer(fast_parser_t *p, int64_t max, int64_t *value)
+{
+    const char *start = p->cur;
+    const char *s = start;
+    uint64_t v = 0;
+
+    if (s[0] == '0' && is_digit(s[1])) {
+        return false;
+    }
+
+    for (; is_digit(*s); s++) {
+        v = 10 * v + (uint64_t)(*s - '0');
+    }
+
+    /* Up to 19 digits cannot overflow uint64_t, longer numbers are too large. */
+    if (s == start || s - start > 19 || v > (uint64_t)max ||
+        is_name_char(*s) || *s == '.') {
+        return false;
+    }
+
+    *value = (int64_t)v;
+    p->cur = s;
+
+    return true;
+}
+
+/*
+ * Offset list of a var dimension.  These lists can have millions of entries,
+ * so the entries are counted first and converted directly into a buffer of
+ * the final size instead of going through the string sequences and attribute
+ * conversion of the grammar.
+ */
+static int32_t *
+offset_list(fast_parser_t *p, int32_t *noffsets)
+{
+    const char *s, *end;
+    int32_t *offsets;
+    int64_t n = 1;
+    int64_t v;
+
+    if (!expect(p, '[')) {
+        return NULL;
+    }
+
+    end = strchr(p->cur, ']');
+    if (end == NULL) {
+        return NULL;
+    }
+
+    for (s = p->cur; s < end; s++) {
+        n += *s == ',';
+    }
+
+    if (n > INT32_MAX) {
+        return NULL;
+    }
+
+    offsets = ndt_alloc(n, sizeof *offsets);
+    if (offsets == NULL) {
+        return ndt_memory_error(p->ctx);
+    }
+
+    for (int64_t i = 0; i < n; i++) {
+        skip_space(p);
+        if (!scan_integer(p, INT32_MAX, &v)) {
+            ndt_free(offsets);
+            return NULL;
+        }
+        offsets[i] = (int32_t)v;
+
+        skip_space(p);
+        if (*p->cur != (i == n-1 ? ']' : ',')) {
+            ndt_free(offsets);
+            return NULL;
+        }
+        p->cur++;
+    }
+
+    *noffsets = (int32_t)n;
+    return offsets;
+}
+
+static const ndt_t *datashape(fast_parser_t *p);
+
+static const ndt_t *
+fixed_dim(fast_parser_t *p)
+{
+    const ndt_t *type, *t;
+    int64_t shape;
+
+    if (!scan_integer(p, INT64_MAX, &shape) || !expect(p, '*')) {
+        return NULL;
+    }
+
+    type = datashape(p);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    t = ndt_fixed_dim(type, shape, INT64_MAX, p->ctx);
+    ndt_decref(type);
+    return t;
+}
+
+static const ndt_t *
+upper_name(fast_parser_t *p, const char *name, int len)
+{
+    const ndt_t *type;
+    char *s;
+
+    skip_space(p);
+    if (*p->cur != '*') {
+        s = copy_name(name, len, p->ctx);
+        if (s == NULL) {
+            return NULL;
+        }
+        return ndt_typevar(s, p->ctx);
+    }
+    p->cur++;
+
+    type = datashape(p);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    s = copy_name(name, len, p->ctx);
+    if (s == NULL) {
+        ndt_decref(type);
+        return NULL;
+    }
+
+    return mk_symbolic_dim(s, type, p->ctx);
+}
+
+static const ndt_t *
+var_dim(fast_parser_t *p, bool opt)
+{
+    ndt_offsets_t *offsets;
+    const ndt_t *type, *t;
+    const char *name;
+    int32_t *ptr;
+    int32_t n = 0;
+
+    if (!expect(p, '(')) {
+        if (!expect(p, '*')) {
+            return NULL;
+        }
+
+        type = datashape(p);
+        if (type == NULL) {
+            return NULL;
+        }
+
+        return mk_var_dim(NULL, type, opt, p->ctx);
+    }
+
+    skip_space(p);
+    if (scan_name(p, &name) != 7 || strncmp(name, "offsets", 7) != 0 ||
+        !expect(p, '=')) {
+        return NULL;
+    }
+
+    ptr = offset_list(p, &n);
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    if (!expect(p, ')') || !expect(p, '*')) {
+        ndt_free(ptr);
+        return NULL;
+    }
+
+    offsets = ndt_offsets_from_ptr(ptr, n, p->ctx);
+    if (offsets == NULL) {
+        return NULL;
+    }
+
+    type = datashape(p);
+    if (type == NULL) {
+        ndt_decref_offsets(offsets);
+        return NULL;
+    }
+
+    t = ndt_var_dim(type, offsets, 0, NULL, opt, p->ctx);
+    ndt_decref_offsets(offsets);
+    ndt_decref(type);
+
+    return t;
+}
+
+/* Fields of a record (named) or a tuple, up to and including 'close'. */
+static ndt_field_seq_t *
+field_seq(fast_parser_t *p, bool named, char close, bool *ok)
+{
+    ndt_field_seq_t *seq = NULL;
+    const ndt_t *type;
+    ndt_field_t *f;
+    const char *name = NULL;
+    char *s = NULL;
+    int len = 0;
+
+    *ok = false;
+
+    if (expect(p, close)) {
+        *ok = true;
+        return NULL;
+    }
+
+    while (1) {
+        if (named) {
+            skip_space(p);
+            len = scan_name(p, &name);
+            if (len == 0 || lookup_keyword(name, len) != NULL ||
+                !expect(p, ':')) {
+                goto error;
+            }
+        }
+
+        type = datashape(p);
+        if (type == NULL) {
+            goto error;
+        }
+
+        if (named) {
+            s = copy_name(name, len, p->ctx);
+            if (s == NULL) {
+                ndt_decref(type);
+                goto error;
+            }
+        }
+
+        f = mk_field(s, type, NULL, p->ctx);
+        if (f == NULL) {
+            goto error;
+        }
+
+        seq = seq == NULL ? ndt_field_seq_new(f, p->ctx)
+                          : ndt_field_seq_append(seq, f, p->ctx);
+        if (seq == NULL) {
+            return NULL;
+        }
+
+        if (expect(p, ',')) {
+            if (expect(p, close)) {
+                break;
+            }
+        }
+        else if (expect(p, close)) {
+            break;
+        }
+        else {
+            goto error;
+        }
+    }
+
+    *ok = true;
+    return seq;
+
+error:
+    ndt_field_seq_del(seq);
+    return NULL;
+}
+
+static const ndt_t *
+record(fast_parser_t *p, bool opt)
+{
+    ndt_field_seq_t *fields;
+    bool ok;
+
+    fields = field_seq(p, true, '}', &ok);
+    if (!ok) {
+        return NULL;
+    }
+
+    return mk_record(Nonvariadic, fields, NULL, opt, p->ctx);
+}
+
+static const ndt_t *
+tuple(fast_parser_t *p, bool opt)
+{
+    ndt_field_seq_t *fields;
+    bool ok;
+
+    fields = field_seq(p, false, ')', &ok);
+    if (!ok) {
+        return NULL;
+    }
+
+    return mk_tuple(Nonvariadic, fields, NULL, opt, p->ctx);
+}
+
+static const ndt_t *
+_datashape(fast_parser_t *p)
+{
+    const fast_keyword_t *kw;
+    const char *name;
+    bool opt = false;
+    char *s;
+    int len;
+
+    skip_space(p);
+    if (*p->cur == '?') {
+        p->cur++;
+        skip_space(p);
+        opt = true;
+    }
+
+    switch (*p->cur) {
+    case '{':
+        p->cur++;
+        return record(p, opt);
+    case '(':
+        p->cur++;
+        return tuple(p, opt);
+    default:
+        if (is_digit(*p->cur)) {
+            return opt ? NULL : fixed_dim(p);
+        }
+        break;
+    }
+
+    len = scan_name(p, &name);
+    if (len == 0) {
+        return NULL;
+    }
+
+    kw = lookup_keyword(name, len);
+    if (kw == NULL) {
+        if (is_upper(name[0])) {
+            return opt ? NULL : upper_name(p, name, len);
+        }
+        if (name[0] == '_') {
+            return NULL;
+        }
+        s = copy_name(name, len, p->ctx);
+        if (s == NULL) {
+            return NULL;
+        }
+        return ndt_nominal(s, NULL, opt, p->ctx);
+    }
+
+    switch (kw->kind) {
+    case KwPrimitive:
+        return ndt_primitive((enum ndt)kw->value, opt ? NDT_OPTION : 0, p->ctx);
+    case KwAlias:
+        return ndt_from_alias((enum ndt_alias)kw->value, opt ? NDT_OPTION : 0, p->ctx);
+    case KwString:
+        return ndt_string(opt, p->ctx);
+    case KwChar:
+        skip_space(p);
+        if (*p->cur == '(') {
+            return NULL;
+        }
+        return ndt_char(Utf32, opt, p->ctx);
+    case KwVar:
+        return var_dim(p, opt);
+    default:
+        return NULL;
+    }
+}
+
+static const ndt_t *
+datashape(fast_parser_t *p)
+{
+    const ndt_t *t;
+
+    if (++p->depth > FAST_MAX_DEPTH) {
+        return NULL;
+    }
+
+    t = _datashape(p);
+    p->depth--;
+
+    return t;
+}
+
+/*
+ * Parse 'input' if it is in the supported subset.  Return NULL with a clean
+ * context if the input must be handled by the full parser.
+ */
+const ndt_t *
+ndt_fast_from_string(const char *input, ndt_context_t *ctx)
+{
+    fast_parser_t p = { input, 0, ctx };
+    const ndt_t *t;
+
+    if (ndt_err_occurred(ctx)) {
+        return NULL;
+    }
+
+    t = datashape(&p);
+    if (t != NULL) {
+        skip_space(&p);
+        if (*p.cur == '\0') {
+            return t;
+        }
+        ndt_decref(t);
+    }
+
+    ndt_err_clear(ctx);
+    return NULL;
+}
@@ -200,11 +200,16 @@ fixed_tag_as_string(enum ndt_contig tag)
 /*                                String buffer                               */
 /******************************************************************************/
 
+/*
+ * Output is written in a single pass.  If the buffer is too small, the output
+ * is truncated like with snprintf() and 'count' continues to accumulate the
+ * full length, so callers can retry with a buffer of the required size.
+ */
 #undef buf_t
 typedef struct {
-    size_t count; /* count the required size */
-    size_t size;  /* buffer size (0 for the count phase) */
-    char *cur;    /* buffer data (NULL for the count phase) */
+    size_t count; /* length of the complete output */
+    size_t size;  /* remaining buffer size, including the NUL byte */
+    char *cur;    /* buffer data (NULL if only counting) */
 } buf_t;
 
 static int indent(ndt_context_t *ctx, buf_t *buf, int n);
@@ -216,7 +221,7 @@ _ndt_snprintf(ndt_context_t *ctx, buf_t *buf, const char *fmt, va_list ap)
 
     errno = 0;
     n = vsnprintf(buf->cur, buf->size, fmt, ap);
-    if (buf->cur && n < 0) {
+    if (n < 0) {
         if (errno == ENOMEM) {
             ndt_err_format(ctx, NDT_MemoryError, "out of memory");
         }
@@ -226,17 +231,17 @@ _ndt_snprintf(ndt_context_t *ctx, buf_t *buf, const char *fmt, va_list ap)
         return -1;
     }
 
-    if (buf->cur && (size_t)n >= buf->size) {
-         ndt_err_format(ctx, NDT_ValueError, "insufficient buffer size");
-        return -1;
-    }
-
     buf->count += n;
 
-    if (buf->cur) {
+    if ((size_t)n < buf->size) {
         buf->cur += n;
         buf->size -= n;
     }
+    else if (buf->size > 0) {
+        /* Truncated: all further output just rewrites the final NUL byte. */
+        buf->cur += buf->size-1;
+        buf->size = 1;
+    }
 
     return 0;
 }
@@ -1711,118 +1716,136 @@ ndt_strtod(const char *v, ndt_context_t *ctx)
 /*                       API: type to string conversions                      */
 /******************************************************************************/
 
-char *
-ndt_as_string(const ndt_t *t, ndt_context_t *ctx)
-{
-    buf_t buf = {0, 0, NULL};
-    char *s;
-    size_t count;
+enum format {
+  FormatString,
+  FormatList,
+  FormatIndent,
+  FormatAst
+};
 
-    if (datashape(&buf, t, INT_MIN, ctx) < 0) {
-        return NULL;
-    }
+/* Most types fit into this size, so the common case needs only one pass. */
+#define FORMAT_STACK_SIZE 256
 
-    count = buf.count;
-    buf.count = 0;
-    buf.size = count+1;
-
-    buf.cur = s = ndt_alloc(1, count+1);
-    if (buf.cur == NULL) {
-        return ndt_memory_error(ctx);
-    }
-
-    if (datashape(&buf, t, INT_MIN, ctx) < 0) {
-        ndt_free(s);
-        return NULL;
+static int
+format(buf_t *buf, enum format fmt, const ndt_t *types[], int64_t len,
+       ndt_context_t *ctx)
+{
+    switch (fmt) {
+    case FormatString: return datashape(buf, types[0], INT_MIN, ctx);
+    case FormatList: return datashape_list(buf, types, 0, len, INT_MIN, ctx);
+    case FormatIndent: return datashape(buf, types[0], 0, ctx);
+    case FormatAst: return ast_datashape(buf, types[0], 0, 0, ctx);
     }
-    s[count] = '\0';
 
-    return s;
+    /* NOT REACHED: tags should be exhaustive */
+    ndt_internal_error("invalid format");
 }
 
-char *
-ndt_list_as_string(const ndt_t *types[], int64_t len, ndt_context_t *ctx)
+static int64_t
+format_buf(char *s, size_t size, enum format fmt, const ndt_t *types[],
+           int64_t len, ndt_context_t *ctx)
 {
-    buf_t buf = {0, 0, NULL};
-    char *s;
-    size_t count;
+    buf_t buf = {0, size, size > 0 ? s : NULL};
 
-    if (datashape_list(&buf, types, 0, len, INT_MIN, ctx) < 0) {
-        return NULL;
+    if (size > 0) {
+        s[0] = '\0';
     }
 
-    count = buf.count;
-    buf.count = 0;
-    buf.size = count+1;
-
-    buf.cur = s = ndt_alloc(1, count+1);
-    if (buf.cur == NULL) {
-        return ndt_memory_error(ctx);
+    if (format(&buf, fmt, types, len, ctx) < 0) {
+        return -1;
     }
 
-    if (datashape_list(&buf, types, 0, len, INT_MIN, ctx) < 0) {
-        ndt_free(s);
-        return NULL;
+    if (buf.count > INT64_MAX) {
+        ndt_err_format(ctx, NDT_ValueError, "output too large");
+        return -1;
     }
-    s[count] = '\0';
 
-    return s;
+    return (int64_t)buf.count;
 }
 
-char *
-ndt_indent(const ndt_t *t, ndt_context_t *ctx)
+static char *
+format_alloc(enum format fmt, const ndt_t *types[], int64_t len,
+             ndt_context_t *ctx)
 {
-    buf_t buf = {0, 0, NULL};
+    char tmp[FORMAT_STACK_SIZE];
+    int64_t count;
     char *s;
-    size_t count;
 
-    if (datashape(&buf, t, 0, ctx) < 0) {
+    count = format_buf(tmp, sizeof tmp, fmt, types, len, ctx);
+    if (count < 0) {
         return NULL;
     }
 
-    count = buf.count;
-    buf.count = 0;
-    buf.size = count+1;
-
-    buf.cur = s = ndt_alloc(1, count+1);
-    if (buf.cur == NULL) {
+    s = ndt_alloc(1, count+1);
+    if (s == NULL) {
         return ndt_memory_error(ctx);
     }
 
-    if (datashape(&buf, t, 0, ctx) < 0) {
+    if (count < FORMAT_STACK_SIZE) {
+        memcpy(s, tmp, count+1);
+        return s;
+    }
+
+    if (format_buf(s, count+1, fmt, types, len, ctx) < 0) {
         ndt_free(s);
         return NULL;
     }
-    s[count] = '\0';
 
     return s;
 }
 
 char *
-ndt_ast_repr(const ndt_t *t, ndt_context_t *ctx)
+ndt_as_string(const ndt_t *t, ndt_context_t *ctx)
 {
-    buf_t buf = {0, 0, NULL};
-    char *s;
-    size_t count;
+    return format_alloc(FormatString, &t, 1, ctx);
+}
 
-    if (ast_datashape(&buf, t, 0, 0, ctx) < 0) {
-        return NULL;
-    }
+char *
+ndt_list_as_string(const ndt_t *types[], int64_t len, ndt_context_t *ctx)
+{
+    return format_alloc(FormatList, types, len, ctx);
+}
 
-    count = buf.count;
-    buf.count = 0;
-    buf.size = count+1;
+char *
+ndt_indent(const ndt_t *t, ndt_context_t *ctx)
+{
+    return format_alloc(FormatIndent, &t, 1, ctx);
+}
 
-    buf.cur = s = ndt_alloc(1, count+1);
-    if (buf.cur == NULL) {
-        return ndt_memory_error(ctx);
-    }
+char *
+ndt_ast_repr(const ndt_t *t, ndt_context_t *ctx)
+{
+    return format_alloc(FormatAst, &t, 1, ctx);
+}
 
-    if (ast_datashape(&buf, t, 0, 0, ctx) < 0) {
-        ndt_free(s);
-        return NULL;
-    }
-    s[count] = '\0';
+/*
+ * The following functions write the output into a caller-provided buffer.
+ * Like snprintf(), they write at most 'size' bytes including the terminating
+ * NUL byte and return the length of the complete output.  A return value
+ * that is greater than or equal to 'size' means that the output has been
+ * truncated.  On error, the return value is -1.
+ */
+int64_t
+ndt_as_string_buf(char *s, size_t size, const ndt_t *t, ndt_context_t *ctx)
+{
+    return format_buf(s, size, FormatString, &t, 1, ctx);
+}
 
-    return s;
+int64_t
+ndt_list_as_string_buf(char *s, size_t size, const ndt_t *types[], int64_t len,
+                       ndt_context_t *ctx)
+{
+    return format_buf(s, size, FormatList, types, len, ctx);
+}
+
+int64_t
+ndt_indent_buf(char *s, size_t size, const ndt_t *t, ndt_context_t *ctx)
+{
+    return format_buf(s, size, FormatIndent, &t, 1, ctx);
+}
+
+int64_t
+ndt_ast_repr_buf(char *s, size_t size, const ndt_t *t, ndt_context_t *ctx)
+{
+    return format_buf(s, size, FormatAst, &t, 1, ctx);
 }
@@ -909,7 +909,7 @@ static const flex_int32_t yy_rule_can_match_eol[72] =
 #undef fprintf
 #define fprintf(file, fmt, msg) fprintf_to_longjmp(fmt, msg, yyscanner)
 
-extern jmp_buf ndt_lexerror;
+extern NDT_THREAD_LOCAL jmp_buf ndt_lexerror;
 static void
 fprintf_to_longjmp(const char *fmt, const char *msg, yyscan_t yyscanner)
 {
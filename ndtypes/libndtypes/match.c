@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -44,6 +45,7 @@
 
 #include "symtable.h"
 #include "substitute.h"
+#include "overflow.h"
 
 
 static int match_datashape(const ndt_t *, const ndt_t *, symtable_t *, ndt_context_t *);
@@ -763,21 +765,53 @@ match_datashape_top(const ndt_t *p, const ndt_t *c, int64_t linear_index,
 int
 ndt_match(const ndt_t *p, const ndt_t *c, ndt_context_t *ctx)
 {
-    symtable_t *tbl;
+    symtable_t tbl;
     int ret;
 
     if (ndt_is_abstract(c)) {
         return 0;
     }
 
-    tbl = symtable_new(ctx);
-    if (tbl == NULL) {
-        return -1;
+    symtable_init(&tbl);
+    ret = match_datashape_top(p, c, 0, &tbl, ctx);
+    symtable_del(&tbl);
+    return ret;
+}
+
+/*
+ * Return true if broadcasting the ndarray 't' to 'shape' would rebuild 't'
+ * unchanged.  This is the case if 't' already has the full number of
+ * dimensions, all outer dimensions have the target shape and extents of
+ * size one already have step zero.  The inner dimensions are copied
+ * verbatim, so they only need to be free of contiguity tags.
+ */
+static bool
+broadcast_is_identity(const ndt_t *t, const int64_t *shape,
+                      int outer_dims, int inner_dims)
+{
+    int i;
+
+    if (t->ndim != outer_dims + inner_dims) {
+        return false;
     }
 
-    ret = match_datashape_top(p, c, 0, tbl, ctx);
-    symtable_del(tbl);
-    return ret;
+    for (i = 0; i < outer_dims+inner_dims; i++, t=t->FixedDim.type) {
+        assert(t->tag == FixedDim);
+        if (t->FixedDim.tag != RequireNA) {
+            return false;
+        }
+
+        if (i < outer_dims) {
+            if (t->FixedDim.shape != shape[i]) {
+                return false;
+            }
+            if (t->FixedDim.shape <= 1 && t->Concrete.FixedDim.step != 0) {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 static const ndt_t *
@@ -796,6 +830,11 @@ broadcast(const ndt_t *t, const int64_t *shape,
         return NULL;
     }
 
+    if (broadcast_is_identity(t, shape, outer_dims, inner_dims)) {
+        ndt_incref(t);
+        return t;
+    }
+
     v = ndt_dtype(t);
     ndt_incref(v);
 
@@ -925,30 +964,11 @@ resolve_constraint(const ndt_constraint_t *c, const void *args, symtable_t *tbl,
     return 0;
 }
 
-/*
- * Check the concrete function arguments 'in' against the function
- * signature 'sig'.  On success, infer and return the concrete return
- * types and the (possibly broadcasted) 'in' types.
- */
-int
-ndt_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
-              const ndt_t *types[], const int64_t li[],
-              const int nin, const int nout, bool check_broadcast,
-              const ndt_constraint_t *c, const void *args,
-              ndt_context_t *ctx)
+static int
+typecheck_args(const ndt_t *sig, const ndt_t *types[], const int nin,
+               const int nout, bool check_broadcast, ndt_context_t *ctx)
 {
-    symtable_t *tbl;
-    const ndt_t *t;
-    const char *name;
     const int nargs = nin + nout;
-    int64_t i;
-    int ret;
-
-    assert(spec->flags == 0);
-    assert(spec->outer_dims == 0);
-    assert(spec->nin == 0);
-    assert(spec->nout == 0);
-    assert(spec->nargs == 0);
 
     if (sig->tag != Function) {
         ndt_err_format(ctx, NDT_ValueError,
@@ -984,7 +1004,7 @@ ndt_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
         return -1;
     }
 
-    for (i = 0; i < nargs; i++) {
+    for (int i = 0; i < nargs; i++) {
         if (ndt_is_abstract(types[i])) {
             ndt_err_format(ctx, NDT_ValueError,
                 "type checking requires concrete argument types");
@@ -992,24 +1012,24 @@ ndt_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
         }
     }
 
-    tbl = symtable_new(ctx);
-    if (tbl == NULL) {
-        return -1;
-    }
-
-    for (i = 0; i < nargs; i++) {
-        ret = match_datashape_top(sig->Function.types[i], types[i], li[i], tbl, ctx);
-        if (ret <= 0) {
-            symtable_del(tbl);
-
-            if (ret == 0) {
-                ndt_err_format(ctx, NDT_TypeError,
-                    "argument types do not match");
-            }
+    return 0;
+}
 
-            return -1;
-        }
-    }
+/*
+ * Second half of type checking: all arguments have been matched and 'tbl'
+ * contains the bindings.  Resolve the constraint, infer the return types
+ * and broadcast.  Consumes 'tbl'.
+ */
+static int
+typecheck_resolve(ndt_apply_spec_t *spec, const ndt_t *sig,
+                  const ndt_t *types[], const int nin, const int nout,
+                  bool check_broadcast, const ndt_constraint_t *c,
+                  const void *args, symtable_t *tbl, ndt_context_t *ctx)
+{
+    const ndt_t *t;
+    const char *name;
+    const int nargs = nin + nout;
+    int64_t i;
 
     if (c != NULL && resolve_constraint(c, args, tbl, ctx) < 0) {
         symtable_del(tbl);
@@ -1124,20 +1144,499 @@ ndt_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
     return 0;
 }
 
+/*
+ * Check the concrete function arguments 'in' against the function
+ * signature 'sig'.  On success, infer and return the concrete return
+ * types and the (possibly broadcasted) 'in' types.
+ */
+int
+ndt_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
+              const ndt_t *types[], const int64_t li[],
+              const int nin, const int nout, bool check_broadcast,
+              const ndt_constraint_t *c, const void *args,
+              ndt_context_t *ctx)
+{
+    symtable_t tbl;
+    const int nargs = nin + nout;
+    int ret;
+
+    assert(spec->flags == 0);
+    assert(spec->outer_dims == 0);
+    assert(spec->nin == 0);
+    assert(spec->nout == 0);
+    assert(spec->nargs == 0);
+
+    if (typecheck_args(sig, types, nin, nout, check_broadcast, ctx) < 0) {
+        return -1;
+    }
+
+    symtable_init(&tbl);
+
+    for (int i = 0; i < nargs; i++) {
+        ret = match_datashape_top(sig->Function.types[i], types[i], li[i], &tbl, ctx);
+        if (ret <= 0) {
+            symtable_del(&tbl);
+
+            if (ret == 0) {
+                ndt_err_format(ctx, NDT_TypeError,
+                    "argument types do not match");
+            }
+
+            return -1;
+        }
+    }
+
+    return typecheck_resolve(spec, sig, types, nin, nout, check_broadcast,
+                             c, args, &tbl, ctx);
+}
+
+
+/*****************************************************************************/
+/*                         Compiled signature matchers                        */
+/*****************************************************************************/
+
+/*
+ * A matcher is a signature compiled into a flat list of instructions that
+ * match the argument types from the outermost dimension to the dtype.  All
+ * symbols are resolved to symbol table slots at compile time.
+ *
+ * Arguments of the form [...] * (fixed|symbolic)* * dtype are compiled
+ * completely.  Compound dtypes are matched by a single generic instruction,
+ * all other arguments (named or var ellipses, var dimensions) fall back to
+ * the recursive matcher.  Therefore a matcher accepts exactly the same types
+ * as ndt_typecheck() on the original signature.
+ */
+
+enum match_op {
+  MatchArg,       /* load argument 'n' */
+  MatchEllipsis,  /* split off the outer dimensions, 'n' inner dimensions remain */
+  MatchFixed,     /* fixed dimension of shape 'n' */
+  MatchSymbolic,  /* fixed dimension, shape bound to 'slot' */
+  MatchScalar,    /* primitive dtype with tag 'n' */
+  MatchTypevar,   /* dtype bound to 'slot' */
+  MatchDtype,     /* generic match of the dtype 'p' */
+  MatchGeneric,   /* generic match of the entire argument 'p' */
+  MatchBroadcast  /* broadcast the outer dimensions into 'slot' */
+};
+
+typedef struct {
+    enum match_op op;
+    uint8_t opt;        /* pattern is optional */
+    uint8_t req;        /* contiguity requirement of the pattern */
+    int slot;
+    int64_t n;
+    const ndt_t *p;
+} match_insn_t;
+
+struct _ndt_matcher {
+    const ndt_t *sig;
+    int nsyms;
+    const char *syms[NDT_MAX_ARGS];
+    int end[NDT_MAX_ARGS];  /* end of the instructions for argument i */
+    int ninsns;
+    match_insn_t insns[];
+};
+
+static const char *ellipsis_key = "00_ELLIPSIS";
+
+static int
+symbol_slot(ndt_matcher_t *m, const char *name, ndt_context_t *ctx)
+{
+    for (int i = 0; i < m->nsyms; i++) {
+        if (strcmp(m->syms[i], name) == 0) {
+            return i;
+        }
+    }
+
+    if (m->nsyms == NDT_MAX_ARGS) {
+        ndt_err_format(ctx, NDT_ValueError, "too many symbols in signature");
+        return -1;
+    }
+
+    m->syms[m->nsyms] = name;
+    return m->nsyms++;
+}
+
+static bool
+is_primitive(const ndt_t *t)
+{
+    switch (t->tag) {
+    case Bool:
+    case Int8: case Int16: case Int32: case Int64:
+    case Uint8: case Uint16: case Uint32: case Uint64:
+    case BFloat16: case Float16: case Float32: case Float64:
+    case BComplex32: case Complex32: case Complex64: case Complex128:
+    case String:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Return true if the argument pattern can be compiled to a linear sequence. */
+static bool
+is_linear(const ndt_t *p)
+{
+    if (p->tag == EllipsisDim) {
+        if (p->EllipsisDim.name != NULL) {
+            return false;
+        }
+        p = p->EllipsisDim.type;
+    }
+
+    while (p->tag == FixedDim || p->tag == SymbolicDim) {
+        p = p->tag == FixedDim ? p->FixedDim.type : p->SymbolicDim.type;
+    }
+
+    return p->ndim == 0;
+}
+
+static void
+emit(ndt_matcher_t *m, enum match_op op, const ndt_t *p, int slot, int64_t n)
+{
+    match_insn_t *insn = &m->insns[m->ninsns++];
+
+    insn->op = op;
+    insn->opt = p != NULL && ndt_is_optional(p);
+    insn->req = 0;
+    insn->slot = slot;
+    insn->n = n;
+    insn->p = p;
+}
+
+static int
+compile_arg(ndt_matcher_t *m, const ndt_t *p, int arg, ndt_context_t *ctx)
+{
+    int ellipsis = -1;
+    int slot;
+
+    emit(m, MatchArg, NULL, 0, arg);
+
+    if (!is_linear(p)) {
+        emit(m, MatchGeneric, p, 0, 0);
+        return 0;
+    }
+
+    if (p->tag == EllipsisDim) {
+        ellipsis = symbol_slot(m, ellipsis_key, ctx);
+        if (ellipsis < 0) {
+            return -1;
+        }
+        emit(m, MatchEllipsis, NULL, 0, p->EllipsisDim.type->ndim);
+        m->insns[m->ninsns-1].req = p->EllipsisDim.tag;
+        p = p->EllipsisDim.type;
+    }
+
+    while (p->ndim > 0) {
+        if (p->tag == FixedDim) {
+            emit(m, MatchFixed, p, 0, p->FixedDim.shape);
+            m->insns[m->ninsns-1].req = p->FixedDim.tag;
+            p = p->FixedDim.type;
+        }
+        else {
+            slot = symbol_slot(m, p->SymbolicDim.name, ctx);
+            if (slot < 0) {
+                return -1;
+            }
+            emit(m, MatchSymbolic, p, slot, 0);
+            m->insns[m->ninsns-1].req = p->SymbolicDim.tag;
+            p = p->SymbolicDim.type;
+        }
+    }
+
+    if (is_primitive(p)) {
+        emit(m, MatchScalar, p, 0, p->tag);
+    }
+    else if (p->tag == Typevar) {
+        slot = symbol_slot(m, p->Typevar.name, ctx);
+        if (slot < 0) {
+            return -1;
+        }
+        emit(m, MatchTypevar, p, slot, 0);
+    }
+    else {
+        emit(m, MatchDtype, p, 0, 0);
+    }
+
+    if (ellipsis >= 0) {
+        emit(m, MatchBroadcast, NULL, ellipsis, 0);
+    }
+
+    return 0;
+}
+
+/* Compile the function signature 'sig' into a matcher. */
+ndt_matcher_t *
+ndt_matcher_new(const ndt_t *sig, ndt_context_t *ctx)
+{
+    ndt_matcher_t *m;
+    int64_t n = 0;
+
+    if (sig->tag != Function) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "signature must be a function type");
+        return NULL;
+    }
+
+    /* Upper bound: argument, ellipsis, dimensions, dtype, broadcast. */
+    for (int64_t i = 0; i < sig->Function.nargs; i++) {
+        n += 4 + sig->Function.types[i]->ndim;
+    }
+
+    m = ndt_alloc_size(offsetof(ndt_matcher_t, insns) + n * (sizeof m->insns[0]));
+    if (m == NULL) {
+        return ndt_memory_error(ctx);
+    }
+    m->nsyms = 0;
+    m->ninsns = 0;
+
+    for (int64_t i = 0; i < sig->Function.nargs; i++) {
+        if (compile_arg(m, sig->Function.types[i], (int)i, ctx) < 0) {
+            ndt_free(m);
+            return NULL;
+        }
+        m->end[i] = m->ninsns;
+    }
+
+    ndt_incref(sig);
+    m->sig = sig;
+
+    return m;
+}
+
+void
+ndt_matcher_del(ndt_matcher_t *m)
+{
+    if (m == NULL) {
+        return;
+    }
+
+    ndt_decref(m->sig);
+    ndt_free(m);
+}
+
+static inline bool
+check_req(uint8_t req, const ndt_t *c)
+{
+    switch (req) {
+    case RequireC:
+        return ndt_is_c_contiguous(c);
+    case RequireF:
+        return ndt_is_f_contiguous(c);
+    default:
+        return true;
+    }
+}
+
+static int
+bind_shape(symtable_entry_t *v, int64_t shape)
+{
+    if (v->tag == Unbound) {
+        v->tag = Shape;
+        v->Shape = shape;
+        return 1;
+    }
+
+    return v->tag == Shape && v->Shape == shape;
+}
+
+static int
+bind_typevar(symtable_entry_t *v, const ndt_t *c)
+{
+    if (v->tag == Unbound) {
+        if (c->tag == Typevar) {
+            v->tag = Symbol;
+            v->Symbol = c->Typevar.name;
+        }
+        else {
+            v->tag = Type;
+            v->Type = c;
+        }
+        return 1;
+    }
+
+    if (c->tag == Typevar) {
+        return v->tag == Symbol && strcmp(v->Symbol, c->Typevar.name) == 0;
+    }
+
+    return v->tag == Type && ndt_equal(v->Type, c);
+}
+
+/* Match the first 'nargs' arguments. */
+static int
+run_matcher(const ndt_matcher_t *m, const ndt_t *types[], const int64_t li[],
+            const int nargs, symtable_t *tbl, ndt_context_t *ctx)
+{
+    const int ninsns = nargs > 0 ? m->end[nargs-1] : 0;
+    symtable_entry_t outer;
+    const ndt_t *c = NULL;
+    int64_t linear_index = 0;
+    int n;
+
+    outer.tag = BroadcastSeq;
+    outer.BroadcastSeq.size = 0;
+
+    for (int i = 0; i < ninsns; i++) {
+        const match_insn_t *insn = &m->insns[i];
+
+        switch (insn->op) {
+        case MatchArg:
+            c = types[insn->n];
+            linear_index = li[insn->n];
+            break;
+
+        case MatchEllipsis:
+            if (!check_req(insn->req, c) || c->ndim < insn->n) {
+                return 0;
+            }
+            outer.BroadcastSeq.size = 0;
+            while (c->ndim > insn->n) {
+                if (c->tag != FixedDim) {
+                    return 0;
+                }
+                outer.BroadcastSeq.dims[outer.BroadcastSeq.size++] = c->FixedDim.shape;
+                c = c->FixedDim.type;
+            }
+            break;
+
+        case MatchFixed: case MatchSymbolic:
+            if (c->tag == VarDimElem) {
+                c = c->VarDimElem.type;
+            }
+            if (ndt_is_optional(c) != insn->opt || c->tag != FixedDim ||
+                !check_req(insn->req, c)) {
+                return 0;
+            }
+            if (insn->op == MatchFixed) {
+                if (c->FixedDim.shape != insn->n) {
+                    return 0;
+                }
+            }
+            else if (!bind_shape(&tbl->slots[insn->slot].entry, c->FixedDim.shape)) {
+                return 0;
+            }
+            c = c->FixedDim.type;
+            break;
+
+        case MatchScalar:
+            if (c->tag == VarDimElem) {
+                c = c->VarDimElem.type;
+            }
+            if (ndt_is_optional(c) != insn->opt || c->tag != insn->n) {
+                return 0;
+            }
+            break;
+
+        case MatchTypevar:
+            if (c->tag == VarDimElem) {
+                c = c->VarDimElem.type;
+            }
+            if (ndt_is_optional(c) != insn->opt ||
+                !bind_typevar(&tbl->slots[insn->slot].entry, c)) {
+                return 0;
+            }
+            break;
+
+        case MatchDtype:
+            n = match_datashape(insn->p, c, tbl, ctx);
+            if (n <= 0) {
+                return n;
+            }
+            break;
+
+        case MatchGeneric:
+            n = match_datashape_top(insn->p, c, linear_index, tbl, ctx);
+            if (n <= 0) {
+                return n;
+            }
+            break;
+
+        case MatchBroadcast: {
+            symtable_entry_t *v = &tbl->slots[insn->slot].entry;
+            if (v->tag == Unbound) {
+                *v = outer;
+                break;
+            }
+
+            n = _resolve_broadcast(v->BroadcastSeq.dims, v->BroadcastSeq.size,
+                                   outer.BroadcastSeq.dims, outer.BroadcastSeq.size);
+            if (n < 0) {
+                ndt_err_format(ctx, NDT_TypeError, "broadcast error");
+                return -1;
+            }
+            v->BroadcastSeq.size = n;
+            break;
+        }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Same as ndt_typecheck(), using the signature compiled into 'm'.
+ */
+int
+ndt_matcher_typecheck(ndt_apply_spec_t *spec, const ndt_matcher_t *m,
+                      const ndt_t *types[], const int64_t li[],
+                      const int nin, const int nout, bool check_broadcast,
+                      const ndt_constraint_t *c, const void *args,
+                      ndt_context_t *ctx)
+{
+    const ndt_t *sig = m->sig;
+    symtable_t tbl;
+    int ret;
+
+    assert(spec->flags == 0);
+    assert(spec->outer_dims == 0);
+    assert(spec->nin == 0);
+    assert(spec->nout == 0);
+    assert(spec->nargs == 0);
+
+    if (typecheck_args(sig, types, nin, nout, check_broadcast, ctx) < 0) {
+        return -1;
+    }
+
+    symtable_init(&tbl);
+    if (symtable_reserve(&tbl, m->syms, m->nsyms, ctx) < 0) {
+        return -1;
+    }
+
+    ret = run_matcher(m, types, li, nin+nout, &tbl, ctx);
+    if (ret <= 0) {
+        symtable_del(&tbl);
+
+        if (ret == 0) {
+            ndt_err_format(ctx, NDT_TypeError,
+                "argument types do not match");
+        }
+
+        return -1;
+    }
+
+    return typecheck_resolve(spec, sig, types, nin, nout, check_broadcast,
+                             c, args, &tbl, ctx);
+}
+
 
 /*****************************************************************************/
 /*                  Optimized binary typecheck for fixed input               */
 /*****************************************************************************/
 
 static const ndt_t *
-fast_broadcast(const ndt_ndarray_t *t, const ndt_t *dtype,
+fast_broadcast(const ndt_t *type, const ndt_ndarray_t *t,
                const int64_t *shape, int size, ndt_context_t *ctx)
 {
     const ndt_t *v;
     int64_t step;
     int i, k;
 
-    v = ndt_copy(dtype, ctx);
+    if (broadcast_is_identity(type, shape, size, 0)) {
+        ndt_incref(type);
+        return type;
+    }
+
+    v = ndt_copy(ndt_dtype(type), ctx);
     if (v == NULL) {
         return NULL;
     }
@@ -1185,6 +1684,63 @@ fixed_dim_from_shape(const int64_t shape[], int len, const ndt_t *dtype,
     return t;
 }
 
+/*
+ * Non-allocating equivalent of ndt_equal(fixed_dim_from_shape(...), t).
+ * Each dimension constructed by ndt_fixed_dim() is fully determined by its
+ * element type, shape and step, so it suffices to compare these from the
+ * dtype outwards.
+ */
+static bool
+equal_fixed_from_shape(const ndt_t *t, const int64_t shape[], int len,
+                       const ndt_t *dtype)
+{
+    const ndt_t *dims[NDT_MAX_DIM];
+    const ndt_t *u;
+    bool overflow = false;
+    int64_t step;
+    int i;
+
+    if (t->ndim != len || ndt_is_abstract(t)) {
+        return false;
+    }
+
+    for (i = 0, u = t; i < len; i++, u = u->FixedDim.type) {
+        if (u->tag != FixedDim) {
+            return false;
+        }
+        dims[i] = u;
+    }
+
+    if (u != dtype && !ndt_equal(u, dtype)) {
+        return false;
+    }
+
+    for (i = len-1; i >= 0; i--) {
+        if (u->tag != FixedDim) {
+            step = 1;
+        }
+        else if (u->Concrete.FixedDim.itemsize == 0) {
+            step = MULi64(u->FixedDim.shape, u->Concrete.FixedDim.step,
+                          &overflow);
+        }
+        else {
+            step = DIVi64(u->datasize, u->Concrete.FixedDim.itemsize,
+                          &overflow);
+        }
+
+        if (overflow ||
+            dims[i]->FixedDim.tag != RequireNA ||
+            dims[i]->FixedDim.shape != shape[i] ||
+            dims[i]->Concrete.FixedDim.step != step) {
+            return false;
+        }
+
+        u = dims[i];
+    }
+
+    return true;
+}
+
 static int
 broadcast_error(const char *msg, ndt_context_t *ctx)
 {
@@ -1194,7 +1750,7 @@ broadcast_error(const char *msg, ndt_context_t *ctx)
 
 static int
 _ndt_unary_broadcast(ndt_apply_spec_t *spec,
-                     const ndt_ndarray_t *x, const ndt_t *dtype_x,
+                     const ndt_t *tx, const ndt_ndarray_t *x,
                      const ndt_t *out, const ndt_t *dtype_out,
                      const bool check_broadcast, const int inner,
                      ndt_context_t *ctx)
@@ -1219,29 +1775,24 @@ _ndt_unary_broadcast(ndt_apply_spec_t *spec,
         }
     }
 
-    spec->types[0] = fast_broadcast(x, dtype_x, shape, size, ctx);
+    spec->types[0] = fast_broadcast(tx, x, shape, size, ctx);
     if (spec->types[0] == NULL) {
         return -1;
     }
 
     if (out != NULL) {
         if (check_broadcast) {
-            t = fixed_dim_from_shape(shape, size, dtype_out, ctx);
-            if (t == NULL) {
-                ndt_decref(spec->types[0]);
-                return -1;
-            }
-
-            if (!ndt_equal(t, out)) {
+            if (!equal_fixed_from_shape(out, shape, size, dtype_out)) {
                 ndt_err_format(ctx, NDT_ValueError,
                     "explicit 'out' type not compatible with input types");
                 ndt_decref(spec->types[0]);
-                ndt_decref(t);
                 return -1;
             }
+            ndt_incref(out);
+            t = out;
         }
         else {
-            t = fast_broadcast(&y, dtype_out, shape, size, ctx);
+            t = fast_broadcast(out, &y, shape, size, ctx);
             if (t == NULL) {
                 ndt_decref(spec->types[0]);
                 return -1;
@@ -1378,13 +1929,13 @@ ndt_fast_unary_fixed_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
 
     if (unary_all_same_symbol(p0, p1)) {
         return _ndt_unary_broadcast(spec,
-                                    &x, ndt_dtype(types[0]),
+                                    types[0], &x,
                                     out, dtype, check_broadcast,
                                     1, ctx);
     }
     else if (unary_all_ndim0(p0, p1)) {
         return _ndt_unary_broadcast(spec,
-                                    &x, ndt_dtype(types[0]),
+                                    types[0], &x,
                                     out, dtype, check_broadcast,
                                     0, ctx);
     }
@@ -1397,8 +1948,8 @@ ndt_fast_unary_fixed_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
 
 static int
 _ndt_binary_broadcast(ndt_apply_spec_t *spec,
-                      const ndt_ndarray_t *x, const ndt_t *dtype_x,
-                      const ndt_ndarray_t *y, const ndt_t *dtype_y,
+                      const ndt_t *tx, const ndt_ndarray_t *x,
+                      const ndt_t *ty, const ndt_ndarray_t *y,
                       const ndt_t *out, const ndt_t *dtype_out,
                       const bool check_broadcast, const int inner,
                       ndt_context_t *ctx)
@@ -1428,12 +1979,12 @@ _ndt_binary_broadcast(ndt_apply_spec_t *spec,
         }
     }
 
-    spec->types[0] = fast_broadcast(x, dtype_x, shape, size, ctx);
+    spec->types[0] = fast_broadcast(tx, x, shape, size, ctx);
     if (spec->types[0] == NULL) {
         return -1;
     }
 
-    spec->types[1] = fast_broadcast(y, dtype_y, shape, size, ctx);
+    spec->types[1] = fast_broadcast(ty, y, shape, size, ctx);
     if (spec->types[1] == NULL) {
         ndt_decref(spec->types[0]);
         return -1;
@@ -1441,24 +1992,18 @@ _ndt_binary_broadcast(ndt_apply_spec_t *spec,
 
     if (out != NULL) {
         if (check_broadcast) {
-            t = fixed_dim_from_shape(shape, size, dtype_out, ctx);
-            if (t == NULL) {
-                ndt_decref(spec->types[0]);
-                ndt_decref(spec->types[1]);
-                return -1;
-            }
-
-            if (!ndt_equal(t, out)) {
+            if (!equal_fixed_from_shape(out, shape, size, dtype_out)) {
                 ndt_err_format(ctx, NDT_ValueError,
                     "explicit 'out' type not compatible with input types");
                 ndt_decref(spec->types[0]);
                 ndt_decref(spec->types[1]);
-                ndt_decref(t);
                 return -1;
             }
+            ndt_incref(out);
+            t = out;
         }
         else {
-            t = fast_broadcast(&z, dtype_out, shape, size, ctx);
+            t = fast_broadcast(out, &z, shape, size, ctx);
             if (t == NULL) {
                 ndt_decref(spec->types[0]);
                 ndt_decref(spec->types[1]);
@@ -1615,15 +2160,15 @@ ndt_fast_binary_fixed_typecheck(ndt_apply_spec_t *spec, const ndt_t *sig,
             }
         }
         return _ndt_binary_broadcast(spec,
-                                     &x, ndt_dtype(types[0]),
-                                     &y, ndt_dtype(types[1]),
+                                     types[0], &x,
+                                     types[1], &y,
                                      out, dtype, check_broadcast,
                                      1, ctx);
     }
     else if (binary_all_ndim0(p0, p1, p2)) {
         return _ndt_binary_broadcast(spec,
-                                     &x, ndt_dtype(types[0]),
-                                     &y, ndt_dtype(types[1]),
+                                     types[0], &x,
+                                     types[1], &y,
                                      out, dtype, check_broadcast,
                                      0, ctx);
     }
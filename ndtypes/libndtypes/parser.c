@@ -37,6 +37,7 @@
 #include <ndtypes.h>
 
 #include "seq.h"
+#include "fastparser.h"
 #include "grammar.h"
 #include "lexer.h"
 
@@ -60,8 +61,9 @@ ndt_fopen(const char *name, const char *mode)
 }
 
 /* The yy_fatal_error() function of flex calls exit(). We intercept the function
-   and do a longjmp() for proper error handling. */
-jmp_buf ndt_lexerror;
+   and do a longjmp() for proper error handling. The jump buffer is per thread,
+   so that concurrent parses do not clobber each other's error handler. */
+NDT_THREAD_LOCAL jmp_buf ndt_lexerror;
 
 
 static const ndt_t *
@@ -146,6 +148,11 @@ _ndt_from_string(const char *input, ndt_context_t *ctx)
         return NULL;
     }
 
+    ast = ndt_fast_from_string(input, ctx);
+    if (ast != NULL) {
+        return ast;
+    }
+
     buffer = ndt_alloc_size(size+2);
     if (buffer == NULL) {
         return ndt_memory_error(ctx);
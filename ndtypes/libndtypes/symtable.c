@@ -31,11 +31,26 @@
  */
 
 
+#ifdef _MSC_VER
+  #include <windows.h>
+#endif
+
 #include <stdio.h>
+#include <stdint.h>
 #include <limits.h>
+#include <assert.h>
 #include <stddef.h>
+#include <string.h>
 #include <ndtypes.h>
 
+#ifndef _MSC_VER
+  #include <stdatomic.h>
+  #include "config.h"
+  #ifdef HAVE_PTHREAD_H
+    #include <pthread.h>
+  #endif
+#endif
+
 
 #include "symtable.h"
 
@@ -69,93 +84,217 @@ init_charmap(void)
 /*                            Global typedef map                             */
 /*****************************************************************************/
 
-typedef struct typedef_trie {
+/*
+ * Open addressing hash table with linear probing.  Lookups do not take a
+ * lock: entries are immutable once published, slots only ever change from
+ * NULL to an entry, and a table that needs to grow is replaced by a copy.
+ * Replaced tables are kept on a list until ndt_finalize(), since readers
+ * may still be probing them.  Writers are serialized by a mutex.
+ */
+
+#if defined(_MSC_VER)
+  #define TYPEDEF_ATOMIC(T) T volatile
+  #define typedef_load(p) InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+  #define typedef_store(p, v) (void)InterlockedExchangePointer((PVOID volatile *)(p), (v))
+  static SRWLOCK typedef_lock = SRWLOCK_INIT;
+  #define TYPEDEF_LOCK() AcquireSRWLockExclusive(&typedef_lock)
+  #define TYPEDEF_UNLOCK() ReleaseSRWLockExclusive(&typedef_lock)
+#else
+  #define TYPEDEF_ATOMIC(T) _Atomic(T)
+  #define typedef_load(p) atomic_load_explicit(p, memory_order_acquire)
+  #define typedef_store(p, v) atomic_store_explicit(p, v, memory_order_release)
+  #ifdef HAVE_PTHREAD_H
+    static pthread_mutex_t typedef_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define TYPEDEF_LOCK() pthread_mutex_lock(&typedef_lock)
+    #define TYPEDEF_UNLOCK() pthread_mutex_unlock(&typedef_lock)
+  #else
+    #define TYPEDEF_LOCK()
+    #define TYPEDEF_UNLOCK()
+  #endif
+#endif
+
+#define TYPEDEF_MIN_SIZE 64
+
+typedef struct {
+    uint64_t hash;
     ndt_typedef_t def;
-    struct typedef_trie *next[];
-} typedef_trie_t;
+    char name[];
+} typedef_entry_t;
 
-static typedef_trie_t *typedef_map = NULL;
+typedef struct typedef_table {
+    struct typedef_table *retired;
+    size_t mask;
+    size_t used;
+    TYPEDEF_ATOMIC(typedef_entry_t *) slots[];
+} typedef_table_t;
 
-static typedef_trie_t *
-typedef_trie_new(ndt_context_t *ctx)
+static TYPEDEF_ATOMIC(typedef_table_t *) typedef_map = NULL;
+
+/* FNV-1a hash of a typedef name, -1 for invalid characters. */
+static int
+typedef_hash(uint64_t *hash, const char *key, ndt_context_t *ctx)
 {
-    typedef_trie_t *t;
-    int i;
+    const unsigned char *cp;
+    uint64_t h = 14695981039346656037ULL;
+
+    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
+        if (code[*cp] == UCHAR_MAX) {
+            ndt_err_format(ctx, NDT_ValueError,
+                           "invalid character in typedef: '%c'", *cp);
+            return -1;
+        }
+        h = (h ^ *cp) * 1099511628211ULL;
+    }
+
+    *hash = h;
+    return 0;
+}
 
-    t = ndt_alloc_size(offsetof(typedef_trie_t, next) + ALPHABET_LEN * (sizeof t));
+static typedef_table_t *
+typedef_table_new(size_t size, ndt_context_t *ctx)
+{
+    typedef_table_t *t;
+    size_t i;
+
+    t = ndt_alloc_size(offsetof(typedef_table_t, slots) + size * (sizeof *t->slots));
     if (t == NULL) {
         return ndt_memory_error(ctx);
     }
 
-    t->def.type = NULL;
-    t->def.meth.init = NULL;
-    t->def.meth.constraint = NULL;
-    t->def.meth.repr = NULL;
+    t->retired = NULL;
+    t->mask = size-1;
+    t->used = 0;
 
-    for (i = 0; i < ALPHABET_LEN; i++) {
-        t->next[i] = NULL;
+    for (i = 0; i < size; i++) {
+        t->slots[i] = NULL;
     }
 
     return t;
 }
 
 static void
-typedef_trie_del(typedef_trie_t *t)
+typedef_table_del(typedef_table_t *t)
 {
-    int i;
+    typedef_table_t *next;
+    typedef_entry_t *e;
+    size_t i;
 
     if (t == NULL) {
         return;
     }
 
-    ndt_decref(t->def.type);
+    /* The current table owns all entries. */
+    for (i = 0; i <= t->mask; i++) {
+        e = t->slots[i];
+        if (e != NULL) {
+            ndt_decref(e->def.type);
+            ndt_free(e);
+        }
+    }
 
-    for (i = 0; i < ALPHABET_LEN; i++) {
-        typedef_trie_del(t->next[i]);
+    for (; t != NULL; t = next) {
+        next = t->retired;
+        ndt_free(t);
     }
+}
 
-    ndt_free(t);
+/* Return the slot for 'key', which is either empty or holds the key. */
+static size_t
+typedef_probe(const typedef_table_t *t, const char *key, uint64_t hash)
+{
+    const typedef_entry_t *e;
+    size_t i;
+
+    for (i = (size_t)hash & t->mask; ; i = (i+1) & t->mask) {
+        e = typedef_load(&t->slots[i]);
+        if (e == NULL ||
+            (e->hash == hash && strcmp(e->name, key) == 0)) {
+            return i;
+        }
+    }
 }
 
-int
-ndt_typedef_add(const char *key, const ndt_t *type, const ndt_methods_t *m, ndt_context_t *ctx)
+/* Copy all entries into a table of twice the size. Caller holds the lock. */
+static typedef_table_t *
+typedef_table_grow(typedef_table_t *t, ndt_context_t *ctx)
 {
-    typedef_trie_t *t = typedef_map;
-    const unsigned char *cp;
-    int i;
+    typedef_table_t *u;
+    typedef_entry_t *e;
+    size_t i;
 
-    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
-        i = code[*cp];
-        if (i == UCHAR_MAX) {
-            ndt_err_format(ctx, NDT_ValueError,
-                           "invalid character in typedef: '%c'", *cp);
-            return -1;
-        }
+    u = typedef_table_new(2 * (t->mask+1), ctx);
+    if (u == NULL) {
+        return NULL;
+    }
 
-        if (t->next[i] == NULL) {
-            typedef_trie_t *u = typedef_trie_new(ctx);
-            if (u == NULL) {
-                return -1;
-            }
-            t->next[i] = u;
-            t = u;
-        }
-        else {
-            t = t->next[i];
+    for (i = 0; i <= t->mask; i++) {
+        e = t->slots[i];
+        if (e != NULL) {
+            u->slots[typedef_probe(u, e->name, e->hash)] = e;
         }
     }
 
-    if (t->def.type) {
-        ndt_err_format(ctx, NDT_ValueError, "duplicate typedef '%s'", key);
+    u->used = t->used;
+    u->retired = t;
+
+    return u;
+}
+
+int
+ndt_typedef_add(const char *key, const ndt_t *type, const ndt_methods_t *m, ndt_context_t *ctx)
+{
+    typedef_table_t *t;
+    typedef_entry_t *e;
+    uint64_t hash;
+    size_t len, i;
+
+    if (typedef_hash(&hash, key, ctx) < 0) {
         return -1;
     }
 
-    ndt_incref(type);
-    t->def.type = type;
+    len = strlen(key);
+    e = ndt_alloc_size(offsetof(typedef_entry_t, name) + len + 1);
+    if (e == NULL) {
+        (void)ndt_memory_error(ctx);
+        return -1;
+    }
 
+    e->hash = hash;
+    e->def.type = type;
+    e->def.meth.init = NULL;
+    e->def.meth.constraint = NULL;
+    e->def.meth.repr = NULL;
     if (m != NULL) {
-        t->def.meth = *m;
+        e->def.meth = *m;
     }
+    memcpy(e->name, key, len+1);
+
+    TYPEDEF_LOCK();
+    t = typedef_load(&typedef_map);
+
+    i = typedef_probe(t, key, hash);
+    if (t->slots[i] != NULL) {
+        TYPEDEF_UNLOCK();
+        ndt_free(e);
+        ndt_err_format(ctx, NDT_ValueError, "duplicate typedef '%s'", key);
+        return -1;
+    }
+
+    if (2 * (t->used+1) > t->mask+1) {
+        t = typedef_table_grow(t, ctx);
+        if (t == NULL) {
+            TYPEDEF_UNLOCK();
+            ndt_free(e);
+            return -1;
+        }
+        i = typedef_probe(t, key, hash);
+        typedef_store(&typedef_map, t);
+    }
+
+    ndt_incref(type);
+    typedef_store(&t->slots[i], e);
+    t->used++;
+    TYPEDEF_UNLOCK();
 
     return 0;
 }
@@ -163,33 +302,23 @@ ndt_typedef_add(const char *key, const ndt_t *type, const ndt_methods_t *m, ndt_
 const ndt_typedef_t *
 ndt_typedef_find(const char *key, ndt_context_t *ctx)
 {
-    typedef_trie_t *t = typedef_map;
-    const unsigned char *cp;
-    int i;
-
-    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
-        i = code[*cp];
-        if (i == UCHAR_MAX) {
-            ndt_err_format(ctx, NDT_ValueError,
-                           "invalid character in typedef: '%c'", *cp);
-            return NULL;
-        }
+    const typedef_table_t *t;
+    const typedef_entry_t *e;
+    uint64_t hash;
 
-        if (t->next[i] == NULL) {
-            ndt_err_format(ctx, NDT_ValueError,
-                           "missing typedef for key '%s'", key);
-            return NULL;
-        }
-        t = t->next[i];
+    if (typedef_hash(&hash, key, ctx) < 0) {
+        return NULL;
     }
 
-    if (t->def.type == NULL) {
-        ndt_err_format(ctx, NDT_RuntimeError,
+    t = typedef_load(&typedef_map);
+    e = typedef_load(&t->slots[typedef_probe(t, key, hash)]);
+    if (e == NULL) {
+        ndt_err_format(ctx, NDT_ValueError,
                        "missing typedef for key '%s'", key);
         return NULL;
     }
 
-    return &t->def;
+    return &e->def;
 }
 
 
@@ -200,21 +329,24 @@ ndt_typedef_find(const char *key, ndt_context_t *ctx)
 int
 ndt_init(ndt_context_t *ctx)
 {
+    typedef_table_t *t;
+
     init_charmap();
 
-    typedef_map = typedef_trie_new(ctx);
-    if (typedef_map == NULL) {
+    t = typedef_table_new(TYPEDEF_MIN_SIZE, ctx);
+    if (t == NULL) {
         return -1;
     }
 
+    typedef_store(&typedef_map, t);
     return 0;
 }
 
 void
 ndt_finalize(void)
 {
-    typedef_trie_del(typedef_map);
-    typedef_map = NULL;
+    typedef_table_del(typedef_load(&typedef_map));
+    typedef_store(&typedef_map, NULL);
 }
 
 
@@ -222,76 +354,118 @@ ndt_finalize(void)
 /*                        Symbol tables for matching                         */
 /*****************************************************************************/
 
-symtable_t *
-symtable_new(ndt_context_t *ctx)
+void
+symtable_init(symtable_t *t)
 {
-    symtable_t *t;
-    int i;
+    t->size = 0;
+    t->alloc = NDT_MAX_SYMBOLS;
+    t->slots = t->inline_slots;
+}
 
-    t = ndt_alloc_size(offsetof(symtable_t, next) + ALPHABET_LEN * (sizeof t));
-    if (t == NULL) {
-        return ndt_memory_error(ctx);
+void
+symtable_del(symtable_t *t)
+{
+    if (t->slots != t->inline_slots) {
+        ndt_free(t->slots);
     }
 
-    t->entry.tag = Unbound;
+    symtable_init(t);
+}
 
-    for (i = 0; i < ALPHABET_LEN; i++) {
-        t->next[i] = NULL;
+static symtable_slot_t *
+symtable_lookup(const symtable_t *t, const char *key)
+{
+    for (int i = 0; i < t->size; i++) {
+        const char *k = t->slots[i].key;
+        if (k == key || strcmp(k, key) == 0) {
+            return &t->slots[i];
+        }
     }
 
-    return t;
+    return NULL;
 }
 
-void
-symtable_del(symtable_t *t)
+static int
+symtable_grow(symtable_t *t, ndt_context_t *ctx)
 {
-    int i;
+    symtable_slot_t *slots;
+    int alloc;
 
-    if (t == NULL) {
-        return;
+    if (t->alloc > INT_MAX / 2) {
+        ndt_err_format(ctx, NDT_ValueError, "too many symbols in signature");
+        return -1;
     }
+    alloc = 2 * t->alloc;
 
-    for (i = 0; i < ALPHABET_LEN; i++) {
-        symtable_del(t->next[i]);
+    if (t->slots == t->inline_slots) {
+        slots = ndt_alloc(alloc, sizeof *slots);
+        if (slots == NULL) {
+            (void)ndt_memory_error(ctx);
+            return -1;
+        }
+        memcpy(slots, t->inline_slots, t->size * (sizeof *slots));
     }
+    else {
+        slots = ndt_realloc(t->slots, alloc, sizeof *slots);
+        if (slots == NULL) {
+            (void)ndt_memory_error(ctx);
+            return -1;
+        }
+    }
+
+    t->slots = slots;
+    t->alloc = alloc;
 
-    ndt_free(t);
+    return 0;
 }
 
+/*
+ * Add unbound slots for 'keys' in order, so that the i-th key is always in
+ * t->slots[i].  The table must be empty.
+ */
 int
-symtable_add(symtable_t *t, const char *key, const symtable_entry_t entry,
-             ndt_context_t *ctx)
+symtable_reserve(symtable_t *t, const char *const keys[], int n, ndt_context_t *ctx)
 {
-    const unsigned char *cp;
-    int i;
+    assert(t->size == 0);
 
-    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
-        i = code[*cp];
-        if (i == UCHAR_MAX) {
-            ndt_err_format(ctx, NDT_ValueError,
-                           "invalid character in symbol: '%c'", *cp);
+    while (t->alloc < n) {
+        if (symtable_grow(t, ctx) < 0) {
             return -1;
         }
+    }
 
-        if (t->next[i] == NULL) {
-            symtable_t *u = symtable_new(ctx);
-            if (u == NULL) {
-                return -1;
-            }
-            t->next[i] = u;
-            t = u;
-        }
-        else {
-            t = t->next[i];
+    for (int i = 0; i < n; i++) {
+        t->slots[i].key = keys[i];
+        t->slots[i].entry.tag = Unbound;
+    }
+    t->size = n;
+
+    return 0;
+}
+
+int
+symtable_add(symtable_t *t, const char *key, const symtable_entry_t entry,
+             ndt_context_t *ctx)
+{
+    symtable_slot_t *slot = symtable_lookup(t, key);
+
+    if (slot != NULL) {
+        if (slot->entry.tag != Unbound) {
+            ndt_err_format(ctx, NDT_ValueError, "duplicate binding for '%s'", key);
+            return -1;
         }
+        slot->entry = entry;
+        return 0;
     }
 
-    if (t->entry.tag != Unbound) {
-        ndt_err_format(ctx, NDT_ValueError, "duplicate binding for '%s'", key);
+    if (t->size == t->alloc && symtable_grow(t, ctx) < 0) {
         return -1;
     }
 
-    t->entry = entry;
+    t->slots[t->size].key = key;
+    t->slots[t->size].entry = entry;
+    t->size++;
+
     return 0;
 }
 
@@ -299,43 +473,17 @@ symtable_entry_t
 symtable_find(const symtable_t *t, const char *key)
 {
     symtable_entry_t unbound = { .tag=Unbound };
-    const unsigned char *cp;
-    int i;
-
-    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
-        i = code[*cp];
-        if (i == UCHAR_MAX) {
-            return unbound; /* NOT REACHED */
-        }
-
-        if (t->next[i] == NULL) {
-            return unbound;
-        }
-        t = t->next[i];
-    }
+    const symtable_slot_t *slot = symtable_lookup(t, key);
 
-    return t->entry;
+    return slot == NULL ? unbound : slot->entry;
 }
 
 symtable_entry_t *
 symtable_find_ptr(symtable_t *t, const char *key)
 {
-    const unsigned char *cp;
-    int i;
-
-    for (cp = (const unsigned char *)key; *cp != '\0'; cp++) {
-        i = code[*cp];
-        if (i == UCHAR_MAX) {
-            return NULL; /* NOT REACHED */
-        }
-
-        if (t->next[i] == NULL) {
-            return NULL;
-        }
-        t = t->next[i];
-    }
+    symtable_slot_t *slot = symtable_lookup(t, key);
 
-    return &t->entry;
+    return slot == NULL || slot->entry.tag == Unbound ? NULL : &slot->entry;
 }
 
 int64_t
@@ -79,9 +79,23 @@ typedef struct {
   };
 } symtable_entry_t;
 
-typedef struct symtable {
+typedef struct {
+    const char *key;
     symtable_entry_t entry;
-    struct symtable *next[];
+} symtable_slot_t;
+
+/*
+ * Flat symbol table.  Signatures rarely bind more than a handful of symbols,
+ * so the slots live inside the table, which is usually on the stack of the
+ * caller.  The table spills to the heap only if a signature has more than
+ * NDT_MAX_SYMBOLS distinct symbols.  Keys are not copied, they must outlive
+ * the table.
+ */
+typedef struct {
+    int size;
+    int alloc;
+    symtable_slot_t *slots;
+    symtable_slot_t inline_slots[NDT_MAX_SYMBOLS];
 } symtable_t;
 
 
@@ -89,16 +103,15 @@ typedef struct symtable {
 NDT_PRAGMA(NDT_HIDE_SYMBOLS_START)
 
 
-symtable_t *symtable_new(ndt_context_t *ctx);
-void symtable_free_entry(symtable_entry_t entry);
+void symtable_init(symtable_t *t);
 void symtable_del(symtable_t *t);
+int symtable_reserve(symtable_t *t, const char *const keys[], int n, ndt_context_t *ctx);
 int symtable_add(symtable_t *t, const char *key, const symtable_entry_t entry,
                  ndt_context_t *ctx);
 symtable_entry_t symtable_find(const symtable_t *t, const char *key);
 symtable_entry_t *symtable_find_ptr(symtable_t *t, const char *key);
 int64_t symtable_find_shape(const symtable_t *tbl, const char *key, ndt_context_t *ctx);
 const ndt_t *symtable_find_typevar(const symtable_t *tbl, const char *key, ndt_context_t *ctx);
-const ndt_t *symtable_find_var_dim(const symtable_t *tbl, int ndim, ndt_context_t *ctx);
 
 
 /* END LOCAL SCOPE */
@@ -103,6 +103,7 @@ ndt_nelem(const ndt_t *t)
     ndt_ndarray_t x;
     int64_t n;
 
+    (void)ndt_probe_begin(&ctx);
     if (ndt_as_ndarray(&x, t, &ctx) < 0) {
         ndt_err_clear(&ctx);
         return -1;
@@ -386,16 +387,26 @@ ndt_transpose(const ndt_t *t, const int *p, int ndim, ndt_context_t *ctx)
 ndt_ssize_t
 ndt_hash(const ndt_t *t, ndt_context_t *ctx)
 {
+    char buf[256];
     unsigned char *s, *cp;
-    size_t len;
+    int64_t len;
     ndt_ssize_t x;
 
-    cp = s = (unsigned char *)ndt_as_string(t, ctx);
-    if (s == NULL) {
+    len = ndt_as_string_buf(buf, sizeof buf, t, ctx);
+    if (len < 0) {
         return -1;
     }
 
-    len = strlen((char *)s);
+    if (len < (int64_t)sizeof buf) {
+        s = (unsigned char *)buf;
+    }
+    else {
+        s = (unsigned char *)ndt_as_string(t, ctx);
+        if (s == NULL) {
+            return -1;
+        }
+    }
+    cp = s;
 
     x = *cp << 7;
     while (*cp != '\0') {
@@ -407,7 +418,9 @@ ndt_hash(const ndt_t *t, ndt_context_t *ctx)
         x = -2;
     }
 
-    ndt_free(s);
+    if (s != (unsigned char *)buf) {
+        ndt_free(s);
+    }
 
     return x;
 }
@@ -423,7 +436,9 @@ const ndt_apply_spec_t ndt_apply_spec_empty = {
   .nin = 0,
   .nout = 0,
   .nargs = 0,
-  .types = {NULL}
+  .types = {NULL},
+  .nperm = 0,
+  .perm = {0}
 };
 
 ndt_apply_spec_t *
@@ -440,6 +455,7 @@ ndt_apply_spec_new(ndt_context_t *ctx)
     spec->nin = 0;
     spec->nout = 0;
     spec->nargs = 0;
+    spec->nperm = 0;
 
     return spec;
 }
@@ -461,6 +477,7 @@ ndt_apply_spec_clear(ndt_apply_spec_t *spec)
     spec->nin = 0;
     spec->nout = 0;
     spec->nargs = 0;
+    spec->nperm = 0;
 }
 
 void
@@ -642,8 +659,114 @@ check_var(uint32_t flags, const ndt_t *t, int outer)
     return flags & NDT_INNER_XND;
 }
 
+/*
+ * Choose the iteration order of the outer dimensions such that the innermost
+ * loop runs over the dimension with the smallest combined byte stride of all
+ * arguments (inputs and outputs).  Strides are in bytes, so the order follows
+ * the operands that dominate the memory traffic.
+ *
+ * Return the number of entries in 'perm' or 0 if the logical order should
+ * be used.  The logical order is kept if not all arguments are ndarrays or
+ * if an output is written repeatedly along an outer dimension (zero step),
+ * which would make the result depend on the iteration order.
+ */
+static int
+select_loop_order(uint8_t perm[], const ndt_t *types[], int nin, int nargs,
+                  int outer, ndt_context_t *ctx)
+{
+    int64_t cost[NDT_MAX_DIM];
+    int64_t shape[NDT_MAX_DIM];
+    ndt_ndarray_t x;
+    uint32_t probe;
+    int i, k, m, prev, ret;
+
+    if (outer < 2 || nargs == 0) {
+        return 0;
+    }
+
+    for (k = 0; k < outer; k++) {
+        cost[k] = 0;
+    }
+
+    for (i = 0; i < nargs; i++) {
+        probe = ndt_probe_begin(ctx);
+        ret = ndt_as_ndarray(&x, types[i], ctx);
+        ndt_probe_end(ctx, probe);
+        if (ret < 0) {
+            ndt_err_clear(ctx);
+            return 0;
+        }
+        if (x.ndim < outer) {
+            return 0;
+        }
+
+        for (k = 0; k < outer; k++) {
+            int64_t s = x.strides[k];
+
+            if (i == 0) {
+                shape[k] = x.shape[k];
+            }
+            else if (x.shape[k] != shape[k]) {
+                return 0;
+            }
+
+            if (i >= nin && s == 0 && shape[k] > 1) {
+                return 0;
+            }
+
+            s = s < 0 ? -s : s;
+            cost[k] = s > INT64_MAX-cost[k] ? INT64_MAX : cost[k]+s;
+        }
+    }
+
+    /* Stable insertion sort by descending cost. */
+    for (k = 0; k < outer; k++) {
+        const int64_t c = shape[k] <= 1 ? INT64_MAX : cost[k];
+        cost[k] = c;
+        for (m = k; m > 0 && cost[perm[m-1]] < c; m--) {
+            perm[m] = perm[m-1];
+        }
+        perm[m] = (uint8_t)k;
+    }
+
+    /* Dimensions with shape <= 1 do not affect the order. */
+    prev = -1;
+    for (k = 0; k < outer; k++) {
+        if (shape[perm[k]] <= 1) {
+            continue;
+        }
+        if (perm[k] < prev) {
+            return outer;
+        }
+        prev = perm[k];
+    }
+
+    return 0;
+}
+
+static void
+permute_outer(ndt_ndarray_t *x, const uint8_t perm[], int nperm)
+{
+    int64_t shape[NDT_MAX_DIM];
+    int64_t strides[NDT_MAX_DIM];
+    int64_t steps[NDT_MAX_DIM];
+
+    for (int k = 0; k < nperm; k++) {
+        shape[k] = x->shape[perm[k]];
+        strides[k] = x->strides[perm[k]];
+        steps[k] = x->steps[perm[k]];
+    }
+
+    for (int k = 0; k < nperm; k++) {
+        x->shape[k] = shape[k];
+        x->strides[k] = strides[k];
+        x->steps[k] = steps[k];
+    }
+}
+
 static uint32_t
-select_flags(const ndt_t *types[], int n, int outer, ndt_context_t *ctx)
+select_flags(const ndt_t *types[], int n, int outer, const uint8_t perm[],
+             int nperm, ndt_context_t *ctx)
 {
     uint32_t flags = NDT_SPEC_FLAGS_ALL;
     ndt_ndarray_t x;
@@ -651,7 +774,11 @@ select_flags(const ndt_t *types[], int n, int outer, ndt_context_t *ctx)
     for (int i = 0; i < n; i++) {
         const ndt_t *t = types[i];
 
-        if (ndt_as_ndarray(&x, t, ctx) < 0) { /* var dimension */
+        const uint32_t probe = ndt_probe_begin(ctx);
+        const int ret = ndt_as_ndarray(&x, t, ctx);
+        ndt_probe_end(ctx, probe);
+
+        if (ret < 0) { /* var dimension */
             ndt_err_clear(ctx);
             if (t->tag == VarDim || t->tag == VarDimElem) {
                 flags = check_var(flags, t, outer);
@@ -664,6 +791,7 @@ select_flags(const ndt_t *types[], int n, int outer, ndt_context_t *ctx)
                 return UINT32_MAX;
             }
 
+            permute_outer(&x, perm, nperm);
             flags = check_strided(flags, outer);
             flags = check_c(flags, &x, outer);
             flags = check_f(flags, &x, outer);
@@ -676,7 +804,10 @@ select_flags(const ndt_t *types[], int n, int outer, ndt_context_t *ctx)
 int
 ndt_select_kernel_strategy(ndt_apply_spec_t *spec, ndt_context_t *ctx)
 {
-    spec->flags = select_flags(spec->types, spec->nargs, spec->outer_dims, ctx);
+    spec->nperm = select_loop_order(spec->perm, spec->types, spec->nin,
+                                    spec->nargs, spec->outer_dims, ctx);
+    spec->flags = select_flags(spec->types, spec->nargs, spec->outer_dims,
+                               spec->perm, spec->nperm, ctx);
 
     return spec->flags == UINT32_MAX ? -1 : 0;
 }
@@ -42,6 +42,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #endif
 
 #include <ndtypes.h>
@@ -243,6 +245,126 @@ test_parse_roundtrip(void)
     return 0;
 }
 
+/*
+ * The caller buffer variants must agree with the allocating functions and
+ * truncate like snprintf() for every buffer size.
+ */
+static int
+check_as_string_buf(const char *input, const ndt_t *t, const char *expected,
+                    ndt_context_t *ctx)
+{
+    const size_t len = strlen(expected);
+    char *buf;
+    int64_t n;
+
+    buf = ndt_alloc(1, len+2);
+    if (buf == NULL) {
+        fprintf(stderr, "error: out of memory");
+        return -1;
+    }
+
+    for (size_t size = 0; size <= len+1; size++) {
+        memset(buf, 'x', len+2);
+
+        n = ndt_as_string_buf(buf, size, t, ctx);
+        if (n != (int64_t)len) {
+            fprintf(stderr, "test_as_string_buf: FAIL: \"%s\": size %zu: "
+                            "got length %" PRIi64 "\n", input, size, n);
+            goto error;
+        }
+
+        if (size > 0) {
+            const size_t k = size-1 < len ? size-1 : len;
+            if (memcmp(buf, expected, k) != 0 || buf[k] != '\0') {
+                fprintf(stderr, "test_as_string_buf: FAIL: \"%s\": size %zu: "
+                                "wrong output\n", input, size);
+                goto error;
+            }
+        }
+
+        if (buf[size] != 'x' || buf[len+1] != 'x') {
+            fprintf(stderr, "test_as_string_buf: FAIL: \"%s\": size %zu: "
+                            "buffer overrun\n", input, size);
+            goto error;
+        }
+    }
+
+    ndt_free(buf);
+    return 0;
+
+error:
+    ndt_free(buf);
+    return -1;
+}
+
+static int
+check_alloc_variant(const char *input, const ndt_t *t,
+                    char *(*alloc_func)(const ndt_t *, ndt_context_t *),
+                    int64_t (*buf_func)(char *, size_t, const ndt_t *, ndt_context_t *),
+                    ndt_context_t *ctx)
+{
+    char buf[4096];
+    char *s;
+    int64_t n;
+
+    s = alloc_func(t, ctx);
+    if (s == NULL) {
+        fprintf(stderr, "test_as_string_buf: FAIL: \"%s\": %s\n",
+                input, ndt_context_msg(ctx));
+        return -1;
+    }
+
+    n = buf_func(buf, sizeof buf, t, ctx);
+    if (n != (int64_t)strlen(s) || n >= (int64_t)sizeof buf || strcmp(buf, s) != 0) {
+        fprintf(stderr, "test_as_string_buf: FAIL: \"%s\": output differs\n",
+                input);
+        ndt_free(s);
+        return -1;
+    }
+
+    ndt_free(s);
+    return 0;
+}
+
+static int
+test_as_string_buf(void)
+{
+    const char **c;
+    ndt_context_t *ctx;
+    const ndt_t *t;
+    int count = 0;
+
+    ctx = ndt_context_new();
+    if (ctx == NULL) {
+        fprintf(stderr, "error: out of memory");
+        return -1;
+    }
+
+    for (c = parse_roundtrip_tests; *c != NULL; c++) {
+        t = ndt_from_string(*c, ctx);
+        if (t == NULL) {
+            fprintf(stderr, "test_as_string_buf: parse: FAIL: expected success: \"%s\"\n", *c);
+            ndt_context_del(ctx);
+            return -1;
+        }
+
+        if (check_as_string_buf(*c, t, *c, ctx) < 0 ||
+            check_alloc_variant(*c, t, ndt_indent, ndt_indent_buf, ctx) < 0 ||
+            check_alloc_variant(*c, t, ndt_ast_repr, ndt_ast_repr_buf, ctx) < 0) {
+            ndt_decref(t);
+            ndt_context_del(ctx);
+            return -1;
+        }
+
+        ndt_decref(t);
+        count++;
+    }
+    fprintf(stderr, "test_as_string_buf (%d test cases)\n", count);
+
+    ndt_context_del(ctx);
+    return 0;
+}
+
 static int
 test_parse_error(void)
 {
@@ -294,6 +416,140 @@ test_parse_error(void)
     return 0;
 }
 
+/*
+ * Types in the subset handled by the fast parser and inputs that are close
+ * to it, but must be rejected or handled by the full grammar.
+ */
+static const char *parse_fast_tests[] = {
+  "float64", "?int32", "?  uint8", "bfloat16", "bcomplex32", "complex128",
+  "intptr", "?uintptr", "size_t", "char", "?char", "char('ascii')", "string",
+  "?string", "defined_t", "?defined_t", "undefined_t", "T", "?T", "_t",
+  "10 * float64", "0 * int8", "00 * int8", "012 * int8", "10e3 * int8",
+  "10.0 * int8", "0x10 * int8", "-1 * int8", "9223372036854775807 * uint8",
+  "9223372036854775808 * uint8", "N * M * float64", "N * 10 * ?int32",
+  "var * float32", "?var * float32", "var * var * int64", "var(offsets=[0,2]) * int64",
+  "{a: int64, b: string}", "?{a: int64}", "{a: int64,}", "{}", "{,}", "{a: int64,,}",
+  "{A: int64, _b: 2 * T}", "{string: int64}", "{a: int64, a: int64}", "{a: int64, ...}",
+  "{a: int64 |align=16|}", "()", "(int64)", "(int64,)", "?(int64, string)",
+  "(10 * int64, {a: var * float32})", "(int64, ...)", "{a: (int64, {b: ?string})}",
+  "  10\n *\tint64 ", "10 * int64 # comment", "int64, int64 -> int64",
+  "(int64) -> int64", "... * float64", "10 * 20 * ...", "int64x", "int64_t",
+  "var", "var *", "10 *", "{a: }", "{a int64}", "(", "", " ", "Any", "10 * Scalar",
+  "<int32", "?10 * int32", "?N * int32", "Foo(int64)", "N * Foo(int64)",
+  "ref(int64)", "&int64", "fixed(shape=10) * int64", "!10 * 2 * float64",
+  "?var(offsets=[0,2]) * int64", "var(offsets = [ 0 ,\n 2 ] ) * int8",
+  "var(offsets=[0,2]) * var(offsets=[0,1,3]) * int8", "var(offsets=[0,2]) * var * int8",
+  "var(offsets=[0,2]) * var(offsets=[0,1]) * int8", "var(offsets=[0,2]) * 10 * int8",
+  "var(offsets=[0,2147483647]) * int8", "var(offsets=[0,2147483648]) * int8",
+  "var(offsets=[]) * int8", "var(offsets=[1]) * int8", "var(offsets=[0,2,]) * int8",
+  "var(offsets=[0,,2]) * int8", "var(offsets=[00,2]) * int8", "var(offsets=[-0,2]) * int8",
+  "var(offsets=[0,0x2]) * int8", "var(offsets=[0,2.0]) * int8", "var(offsets=[0,2] * int8",
+  "var(offsets=[0,2]) int8", "var(offset=[0,2]) * int8", "var(offsets=[0,2], _noffsets=2) * int8",
+  "var(offsets=[0,2]) * {a: var(offsets=[0,1]) * int8}",
+  NULL
+};
+
+/*
+ * The fast parser does not handle comments, so appending one forces the
+ * full grammar.  Both paths must agree on every input.
+ */
+static int
+compare_fast_parse(const char *input, ndt_context_t *ctx)
+{
+    ndt_context_t *ctx2;
+    const ndt_t *t, *u;
+    char *buf, *s1 = NULL, *s2 = NULL;
+    size_t len = strlen(input);
+    int ret = -1;
+
+    ctx2 = ndt_context_new();
+    buf = malloc(len + 3);
+    if (ctx2 == NULL || buf == NULL) {
+        fprintf(stderr, "error: out of memory");
+        exit(1);
+    }
+    memcpy(buf, input, len);
+    memcpy(buf+len, "\n#", 3);
+
+    ndt_err_clear(ctx);
+    t = ndt_from_string(input, ctx);
+    u = ndt_from_string(buf, ctx2);
+
+    if ((t == NULL) != (u == NULL)) {
+        fprintf(stderr, "test_parse_fast: FAIL: input: \"%s\"\n", input);
+        fprintf(stderr, "test_parse_fast: FAIL: fast: %s, grammar: %s\n",
+                t ? "success" : ndt_context_msg(ctx),
+                u ? "success" : ndt_context_msg(ctx2));
+        goto out;
+    }
+
+    if (t == NULL) {
+        if (ctx->err != ctx2->err) {
+            fprintf(stderr, "test_parse_fast: FAIL: input: \"%s\"\n", input);
+            fprintf(stderr, "test_parse_fast: FAIL: different errors: %s, %s\n",
+                    ndt_err_as_string(ctx->err), ndt_err_as_string(ctx2->err));
+            goto out;
+        }
+        ret = 0;
+        goto out;
+    }
+
+    s1 = ndt_as_string(t, ctx);
+    s2 = ndt_as_string(u, ctx2);
+    if (s1 == NULL || s2 == NULL || !ndt_equal(t, u) || strcmp(s1, s2) != 0 ||
+        t->flags != u->flags || t->access != u->access ||
+        t->datasize != u->datasize || t->align != u->align) {
+        fprintf(stderr, "test_parse_fast: FAIL: input: \"%s\"\n", input);
+        fprintf(stderr, "test_parse_fast: FAIL: types differ: %s, %s\n",
+                s1 ? s1 : "?", s2 ? s2 : "?");
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    ndt_free(s1);
+    ndt_free(s2);
+    ndt_decref(t);
+    ndt_decref(u);
+    ndt_context_del(ctx2);
+    free(buf);
+    return ret;
+}
+
+static int
+test_parse_fast(void)
+{
+    const char **lists[] = {
+      parse_fast_tests, parse_tests, parse_roundtrip_tests, parse_error_tests, NULL
+    };
+    const char ***l;
+    const char **c;
+    ndt_context_t *ctx;
+    int count = 0;
+
+    ctx = ndt_context_new();
+    if (ctx == NULL) {
+        fprintf(stderr, "error: out of memory");
+        return -1;
+    }
+
+    for (l = lists; *l != NULL; l++) {
+        for (c = *l; *c != NULL; c++) {
+            if (compare_fast_parse(*c, ctx) < 0) {
+                ndt_context_del(ctx);
+                return -1;
+            }
+            count++;
+        }
+    }
+
+    fprintf(stderr, "test_parse_fast (%d test cases)\n", count);
+
+    ndt_context_del(ctx);
+    return 0;
+}
+
 static int
 test_indent(void)
 {
@@ -584,6 +840,128 @@ test_typedef_error(void)
     return 0;
 }
 
+#ifdef __linux__
+#define TYPEDEF_CONCURRENT_KEYS 2000
+#define TYPEDEF_CONCURRENT_READERS 4
+
+static const ndt_t *typedef_concurrent_type;
+static atomic_int typedef_concurrent_published;
+static atomic_int typedef_concurrent_failed;
+
+static void *
+typedef_concurrent_writer(void *arg)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    char name[64];
+    int i;
+
+    (void)arg;
+
+    for (i = 0; i < TYPEDEF_CONCURRENT_KEYS; i++) {
+        snprintf(name, sizeof name, "concurrent_t%d", i);
+        if (ndt_typedef(name, typedef_concurrent_type, NULL, &ctx) < 0) {
+            ndt_err_clear(&ctx);
+            atomic_store(&typedef_concurrent_failed, 1);
+            break;
+        }
+        atomic_store(&typedef_concurrent_published, i+1);
+    }
+
+    atomic_store(&typedef_concurrent_published, -1);
+    return NULL;
+}
+
+static void *
+typedef_concurrent_reader(void *arg)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    const ndt_typedef_t *d;
+    char name[64];
+    int n, i;
+
+    (void)arg;
+
+    while ((n = atomic_load(&typedef_concurrent_published)) >= 0) {
+        for (i = 0; i < n; i++) {
+            snprintf(name, sizeof name, "concurrent_t%d", i);
+            d = ndt_typedef_find(name, &ctx);
+            if (d == NULL || d->type != typedef_concurrent_type) {
+                ndt_err_clear(&ctx);
+                atomic_store(&typedef_concurrent_failed, 1);
+                return NULL;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int
+test_typedef_concurrent(void)
+{
+    pthread_t writer;
+    pthread_t readers[TYPEDEF_CONCURRENT_READERS];
+    ndt_context_t *ctx;
+    int i;
+
+    ctx = ndt_context_new();
+    if (ctx == NULL) {
+        fprintf(stderr, "error: out of memory");
+        return -1;
+    }
+
+    typedef_concurrent_type = ndt_from_string("10 * {a : int64, b : float64}", ctx);
+    if (typedef_concurrent_type == NULL) {
+        ndt_err_fprint(stderr, ctx);
+        ndt_context_del(ctx);
+        return -1;
+    }
+
+    atomic_store(&typedef_concurrent_published, 0);
+    atomic_store(&typedef_concurrent_failed, 0);
+
+    for (i = 0; i < TYPEDEF_CONCURRENT_READERS; i++) {
+        if (pthread_create(&readers[i], NULL, typedef_concurrent_reader, NULL) != 0) {
+            fprintf(stderr, "test_typedef_concurrent: FAIL: pthread_create\n");
+            exit(1);
+        }
+    }
+
+    if (pthread_create(&writer, NULL, typedef_concurrent_writer, NULL) != 0) {
+        fprintf(stderr, "test_typedef_concurrent: FAIL: pthread_create\n");
+        exit(1);
+    }
+
+    pthread_join(writer, NULL);
+    for (i = 0; i < TYPEDEF_CONCURRENT_READERS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    ndt_decref(typedef_concurrent_type);
+
+    if (atomic_load(&typedef_concurrent_failed)) {
+        fprintf(stderr, "test_typedef_concurrent: FAIL: lookup failed during insertion\n");
+        ndt_context_del(ctx);
+        return -1;
+    }
+
+    for (i = 0; i < TYPEDEF_CONCURRENT_KEYS; i++) {
+        char name[64];
+        snprintf(name, sizeof name, "concurrent_t%d", i);
+        if (ndt_typedef_find(name, ctx) == NULL) {
+            fprintf(stderr, "test_typedef_concurrent: FAIL: key not found: \"%s\"\n", name);
+            ndt_context_del(ctx);
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "test_typedef_concurrent (%d test cases)\n", TYPEDEF_CONCURRENT_KEYS);
+
+    ndt_context_del(ctx);
+    return 0;
+}
+#endif
+
 static int
 test_equal(void)
 {
@@ -920,6 +1298,7 @@ test_typecheck(void)
     type_array_t args;
     type_array_t kwargs;
     const ndt_t *sig = NULL;
+    ndt_matcher_t *matcher = NULL;
     int count = 0;
     int ret = -1;
 
@@ -977,6 +1356,42 @@ test_typecheck(void)
             }
         }
 
+        ndt_err_clear(&ctx);
+
+        ret = validate_typecheck_test(&spec, sig, test, ret, &ctx);
+        ndt_apply_spec_clear(&spec);
+        if (ret < 0) {
+            goto error;
+        }
+
+        /* The compiled matcher must give the same results. */
+        matcher = ndt_matcher_new(sig, &ctx);
+        if (matcher == NULL) {
+            goto error;
+        }
+
+        for (alloc_fail = 1; alloc_fail < INT_MAX; alloc_fail++) {
+            ndt_err_clear(&ctx);
+
+            ndt_set_alloc_fail();
+            ret = ndt_matcher_typecheck(&spec, matcher, types, li, nin, nout,
+                                        false, NULL, NULL, &ctx);
+            ndt_set_alloc();
+
+            if (ctx.err != NDT_MemoryError) {
+                break;
+            }
+
+            if (ret != -1) {
+                ndt_err_format(&ctx, NDT_RuntimeError,
+                    "test_typecheck: %s: matcher: ret != -1 after MemoryError\n",
+                    test->loc);
+                goto error;
+            }
+        }
+
+        ndt_matcher_del(matcher);
+        matcher = NULL;
         ndt_type_array_clear(args.types, args.size);
         ndt_type_array_clear(kwargs.types, kwargs.size);
         ndt_err_clear(&ctx);
@@ -1007,6 +1422,97 @@ error:
    goto out;
 }
 
+/* Typechecking with explicit 'out' types must not touch the heap. */
+static int64_t alloc_count;
+
+static void *
+count_malloc(size_t size)
+{
+    alloc_count++;
+    return malloc(size);
+}
+
+static void *
+count_calloc(size_t nmemb, size_t size)
+{
+    alloc_count++;
+    return calloc(nmemb, size);
+}
+
+static void *
+count_realloc(void *ptr, size_t size)
+{
+    alloc_count++;
+    return realloc(ptr, size);
+}
+
+static int
+test_typecheck_alloc(void)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    ndt_apply_spec_t spec = ndt_apply_spec_empty;
+    const char *s[3] = {"10 * 20 * float64", "20 * 30 * float64", "10 * 30 * float64"};
+    const ndt_t *types[3] = {NULL, NULL, NULL};
+    const int64_t li[3] = {0, 0, 0};
+    const ndt_t *sig;
+    int ret = -1;
+
+    sig = ndt_from_string("N * M * float64, M * P * float64 -> N * P * float64", &ctx);
+    if (sig == NULL) {
+        goto error;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        types[i] = ndt_from_string(s[i], &ctx);
+        if (types[i] == NULL) {
+            goto error;
+        }
+    }
+
+    alloc_count = 0;
+    ndt_mallocfunc = count_malloc;
+    ndt_callocfunc = count_calloc;
+    ndt_reallocfunc = count_realloc;
+
+    ret = ndt_typecheck(&spec, sig, types, li, 2, 1, true, NULL, NULL, &ctx);
+    if (ret == 0) {
+        ret = ndt_match(sig->Function.types[0], types[0], &ctx) == 1 ? 0 : -1;
+    }
+
+    ndt_mallocfunc = malloc;
+    ndt_callocfunc = calloc;
+    ndt_reallocfunc = realloc;
+
+    ndt_apply_spec_clear(&spec);
+
+    if (ret < 0) {
+        goto error;
+    }
+
+    if (alloc_count != 0) {
+        ndt_err_format(&ctx, NDT_RuntimeError,
+            "test_typecheck_alloc: expected 0 allocations, got %" PRIi64,
+            alloc_count);
+        goto error;
+    }
+
+    fprintf(stderr, "test_typecheck_alloc (1 test case)\n");
+    ret = 0;
+
+out:
+    for (int i = 0; i < 3; i++) {
+        ndt_decref(types[i]);
+    }
+    ndt_decref(sig);
+    ndt_context_del(&ctx);
+    return ret;
+
+error:
+    ret = -1;
+    ndt_err_fprint(stderr, &ctx);
+    goto out;
+}
+
 static int
 test_numba(void)
 {
@@ -1191,6 +1697,73 @@ cmp_hash_testcase(const void *x, const void *y)
     return 1;
 }
 
+static int
+test_probe(void)
+{
+    NDT_STATIC_CONTEXT(ctx);
+    ndt_context_t *dctx;
+    uint32_t outer, inner;
+    const ndt_t *t;
+
+    outer = ndt_probe_begin(&ctx);
+    inner = ndt_probe_begin(&ctx);
+
+    /* Errors in probe mode must neither format nor allocate. */
+    alloc_fail = 1;
+    ndt_set_alloc_fail();
+    ndt_err_format(&ctx, NDT_ValueError, "invalid value: %d", 10);
+    ndt_err_append(&ctx, "appended");
+    ndt_set_alloc();
+
+    if (ctx.err != NDT_ValueError ||
+        strcmp(ndt_context_msg(&ctx), "invalid value: %d") != 0) {
+        fprintf(stderr, "test_probe: FAIL: unexpected error: %s: %s\n",
+                ndt_err_as_string(ctx.err), ndt_context_msg(&ctx));
+        return -1;
+    }
+
+    t = ndt_from_string("10 * ", &ctx);
+    if (t != NULL || ctx.err != NDT_ParseError) {
+        fprintf(stderr, "test_probe: FAIL: expected ParseError\n");
+        ndt_decref(t);
+        return -1;
+    }
+
+    ndt_probe_end(&ctx, inner);
+    if (!(ctx.flags & NDT_Probe)) {
+        fprintf(stderr, "test_probe: FAIL: nested probe_end left probe mode\n");
+        return -1;
+    }
+
+    ndt_probe_end(&ctx, outer);
+    ndt_err_format(&ctx, NDT_ValueError, "invalid value: %d", 10);
+    if (ctx.flags != 0 || strcmp(ndt_context_msg(&ctx), "invalid value: 10") != 0) {
+        fprintf(stderr, "test_probe: FAIL: message not formatted after probe_end\n");
+        ndt_context_del(&ctx);
+        return -1;
+    }
+    ndt_context_del(&ctx);
+
+    /* The other flags are preserved. */
+    dctx = ndt_context_new();
+    if (dctx == NULL) {
+        fprintf(stderr, "error: out of memory");
+        return -1;
+    }
+
+    ndt_probe_end(dctx, ndt_probe_begin(dctx));
+    if (dctx->flags != NDT_Dynamic) {
+        fprintf(stderr, "test_probe: FAIL: flags not restored\n");
+        ndt_context_del(dctx);
+        return -1;
+    }
+    ndt_context_del(dctx);
+
+    fprintf(stderr, "test_probe (1 test case)\n");
+
+    return 0;
+}
+
 static int
 test_hash(void)
 {
@@ -1705,17 +2278,24 @@ test_serialize_fuzz(void)
 static int (*tests[])(void) = {
   test_parse,
   test_parse_roundtrip,
+  test_as_string_buf,
   test_parse_error,
+  test_parse_fast,
   test_indent,
   test_typedef,
   test_typedef_duplicates,
   test_typedef_error,
+#ifdef __linux__
+  test_typedef_concurrent,
+#endif
   test_equal,
   test_match,
   test_unify,
   test_typecheck,
+  test_typecheck_alloc,
   test_numba,
   test_static_context,
+  test_probe,
   test_hash,
   test_copy,
   test_buffer,
@@ -825,5 +825,19 @@ const typecheck_testcase_t typecheck_tests[] = {
     .nargs=3,
     .types={ "array * array * float64", "array * uint8", "array * array * int64" } },
 
+  /* More symbols than NDT_MAX_SYMBOLS */
+  { .loc = loc(),
+    .success=true,
+
+    .signature="A * B * C * D * E * F * G * H * I * J * K * L * M * N * O * P * Q * R * float64 -> R * A * float64",
+    .args={"2 * 3 * 4 * 5 * 6 * 7 * 8 * 9 * 10 * 11 * 12 * 13 * 14 * 15 * 16 * 17 * 18 * 19 * float64"},
+    .kwargs={NULL},
+
+    .outer_dims=0,
+    .nin=1,
+    .nout=1,
+    .nargs=2,
+    .types={ "2 * 3 * 4 * 5 * 6 * 7 * 8 * 9 * 10 * 11 * 12 * 13 * 14 * 15 * 16 * 17 * 18 * 19 * float64", "19 * 2 * float64" } },
+
   { .loc=NULL, .success=false, .signature= NULL, .args={NULL}, .kwargs={NULL} }
 };
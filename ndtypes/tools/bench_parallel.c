@@ -0,0 +1,219 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017-2024, plures
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Multithreaded parse stress benchmark.  Every thread parses the same set of
+ * schemas with its own context and checks the result against a reference
+ * type parsed up front.  The schemas include nominal types, so the typedef
+ * registry is read concurrently.  A single-threaded run is timed first for
+ * comparison.
+ *
+ *   usage: ./bench_parallel [nthreads [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <ndtypes.h>
+
+
+static const char *schemas[] = {
+  "{parent : { id: int64, count: uint16, prefix: char, length: int32 }, time : int64, ratio : float32, size : uint16 }",
+  "var * {yearID: ?int32, round: ?string, playerID: ?string, teamID: ?string, lgID: (?string, int64, 5 * 10 * {a: complex128, b: ?int32}), G: ?int32, AB: ?int32}",
+  "... * int32, ... * int32 -> ... * int32",
+  "10 * 20 * {a: point_t, b: 3 * point_t, c: ?string}",
+  "2 * 3 * ref(point_t)",
+  "fixed_string(100, 'utf32')",
+  "{a: 10 * float64, b: var * int32, ...}",
+  "N * M * complex128",
+  NULL
+};
+
+#define NSCHEMAS ((int)(sizeof schemas / sizeof schemas[0]) - 1)
+
+static const ndt_t *reference[NSCHEMAS];
+
+typedef struct {
+    int iterations;
+    int errors;
+} thread_info_t;
+
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void *
+parse_thread(void *arg)
+{
+    thread_info_t *info = arg;
+    ndt_context_t *ctx;
+    const ndt_t *t;
+    int i, k;
+
+    ctx = ndt_context_new();
+    if (ctx == NULL) {
+        info->errors++;
+        return NULL;
+    }
+
+    for (i = 0; i < info->iterations; i++) {
+        for (k = 0; k < NSCHEMAS; k++) {
+            t = ndt_from_string(schemas[k], ctx);
+            if (t == NULL) {
+                ndt_err_clear(ctx);
+                info->errors++;
+                continue;
+            }
+            if (!ndt_equal(t, reference[k])) {
+                info->errors++;
+            }
+            ndt_decref(t);
+        }
+    }
+
+    ndt_context_del(ctx);
+    return NULL;
+}
+
+static int
+run(int nthreads, int iterations)
+{
+    pthread_t *tid;
+    thread_info_t *info;
+    double start, elapsed;
+    long nparses;
+    int errors = 0;
+    int i;
+
+    tid = calloc(nthreads, sizeof *tid);
+    info = calloc(nthreads, sizeof *info);
+    if (tid == NULL || info == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+
+    start = now();
+    for (i = 0; i < nthreads; i++) {
+        info[i].iterations = iterations;
+        if (pthread_create(&tid[i], NULL, parse_thread, &info[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return -1;
+        }
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tid[i], NULL);
+        errors += info[i].errors;
+    }
+    elapsed = now() - start;
+
+    nparses = (long)nthreads * iterations * NSCHEMAS;
+    printf("threads: %3d  parses: %9ld  time: %8.3fs  parses/s: %12.0f  errors: %d\n",
+           nthreads, nparses, elapsed, (double)nparses / elapsed, errors);
+
+    free(tid);
+    free(info);
+
+    return errors ? -1 : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    ndt_context_t *ctx;
+    const ndt_t *t;
+    int nthreads = 4;
+    int iterations = 20000;
+    int ret = 0;
+    int k;
+
+    if (argc > 1) {
+        nthreads = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+    if (argc > 3 || nthreads < 1 || iterations < 1) {
+        fprintf(stderr, "usage: ./bench_parallel [nthreads [iterations]]\n");
+        return 1;
+    }
+
+    ctx = ndt_context_new();
+    if (ctx == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (ndt_init(ctx) < 0) {
+        ndt_err_fprint(stderr, ctx);
+        ndt_context_del(ctx);
+        return 1;
+    }
+
+    t = ndt_from_string("{x: float64, y: float64}", ctx);
+    if (t == NULL || ndt_typedef("point_t", t, NULL, ctx) < 0) {
+        ndt_err_fprint(stderr, ctx);
+        ndt_context_del(ctx);
+        return 1;
+    }
+    ndt_decref(t);
+
+    for (k = 0; k < NSCHEMAS; k++) {
+        reference[k] = ndt_from_string(schemas[k], ctx);
+        if (reference[k] == NULL) {
+            ndt_err_fprint(stderr, ctx);
+            ndt_context_del(ctx);
+            return 1;
+        }
+    }
+
+    if (run(1, iterations) < 0 || run(nthreads, iterations) < 0) {
+        ret = 1;
+    }
+
+    for (k = 0; k < NSCHEMAS; k++) {
+        ndt_decref(reference[k]);
+    }
+
+    ndt_context_del(ctx);
+    ndt_finalize();
+
+    return ret;
+}
@@ -0,0 +1,1113 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017-2024, plures
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Benchmark for core xnd operations.  Sweeps operations x types x dtypes x
+ * shapes and writes one record per measurement to stdout, either as CSV
+ * (default) or as JSON lines (-j).  Unsupported combinations are reported
+ * on stderr and skipped.
+ *
+ * Types ('R x C' is the shape, 'D' the dtype):
+ *
+ *   fixed:    R * C * D
+ *   optional: R * C * ?D
+ *   record:   R * C * {id: int64, name: string, value: D, valid: ?D,
+ *                      coords: 3 * float64, tag: ?string}
+ *   var:      var * var * D with row lengths between 1 and 2C-1
+ *
+ * Fields:
+ *
+ *   operation, type, dtype, shape: the configuration
+ *   items:           number of leaf values
+ *   datasize:        size of the data in bytes, excluding strings
+ *   seconds:         best time of a single operation
+ *   ops_per_sec:     operations per second
+ *   allocs:          calls to malloc, calloc and realloc per operation
+ *   alloc_bytes:     bytes requested per operation
+ *   peak_heap_bytes: high-water mark of live heap memory during an operation
+ *   peak_rss_bytes:  peak resident set size of the process so far
+ */
+
+
+#ifndef _MSC_VER
+  #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ndtypes.h"
+#include "xnd.h"
+
+#ifndef _WIN32
+  #include <sys/resource.h>
+#endif
+
+
+#define MAX_ITEMS 64
+#define NSAMPLES 5
+#define BATCH 16
+#define NPARTS 8
+
+static const char *default_operations =
+  "empty,del,copy,equal,subscript,split,reshape,bitmap";
+static const char *default_types = "fixed,optional,record,var";
+static const char *default_dtypes = "int64,float64";
+static const char *default_shapes = "100x10,1000x1000";
+
+enum operation { OpEmpty, OpDel, OpCopy, OpEqual, OpSubscript, OpSplit, OpReshape, OpBitmap,
+                 NumOps };
+
+static const char *operation_names[NumOps] = {
+  "empty", "del", "copy", "equal", "subscript", "split", "reshape", "bitmap"
+};
+
+enum preset { TypeFixed, TypeOptional, TypeRecord, TypeVar, NumPresets };
+
+static const char *preset_names[NumPresets] = {
+  "fixed", "optional", "record", "var"
+};
+
+
+/****************************************************************************/
+/*                           Counting allocator                             */
+/****************************************************************************/
+
+/*
+ * All ndtypes and xnd allocations go through these functions.  A header in
+ * front of each block records the requested size, so that the number of live
+ * bytes can be tracked.
+ */
+
+#define HEADER 16
+
+static bool counting = false;
+static int64_t nallocs = 0;
+static int64_t alloc_bytes = 0;
+static int64_t live_bytes = 0;
+static int64_t live_start = 0;
+static int64_t peak_bytes = 0;
+
+static inline void
+count_alloc(size_t size)
+{
+    live_bytes += (int64_t)size;
+
+    if (counting) {
+        nallocs++;
+        alloc_bytes += (int64_t)size;
+        if (live_bytes - live_start > peak_bytes) {
+            peak_bytes = live_bytes - live_start;
+        }
+    }
+}
+
+static void *
+counting_malloc(size_t size)
+{
+    char *p;
+
+    if (size > SIZE_MAX - HEADER) {
+        return NULL;
+    }
+
+    p = malloc(size + HEADER);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    *(size_t *)p = size;
+    count_alloc(size);
+
+    return p + HEADER;
+}
+
+static void *
+counting_calloc(size_t nmemb, size_t size)
+{
+    char *p;
+
+    if (size != 0 && nmemb > (SIZE_MAX - HEADER) / size) {
+        return NULL;
+    }
+    size = nmemb * size;
+
+    p = calloc(1, size + HEADER);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    *(size_t *)p = size;
+    count_alloc(size);
+
+    return p + HEADER;
+}
+
+static void *
+counting_realloc(void *ptr, size_t size)
+{
+    size_t old;
+    char *p;
+
+    if (ptr == NULL) {
+        return counting_malloc(size);
+    }
+    if (size > SIZE_MAX - HEADER) {
+        return NULL;
+    }
+
+    p = (char *)ptr - HEADER;
+    old = *(size_t *)p;
+
+    p = realloc(p, size + HEADER);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    *(size_t *)p = size;
+    live_bytes -= (int64_t)old;
+    count_alloc(size);
+
+    return p + HEADER;
+}
+
+static void
+counting_free(void *ptr)
+{
+    char *p;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    p = (char *)ptr - HEADER;
+    live_bytes -= (int64_t)*(size_t *)p;
+    free(p);
+}
+
+static void
+stats_reset(void)
+{
+    nallocs = 0;
+    alloc_bytes = 0;
+    peak_bytes = 0;
+}
+
+static int64_t
+peak_rss(void)
+{
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage r;
+    if (getrusage(RUSAGE_SELF, &r) < 0) {
+        return -1;
+    }
+  #ifdef __APPLE__
+    return (int64_t)r.ru_maxrss;
+  #else
+    return (int64_t)r.ru_maxrss * 1024;
+  #endif
+#endif
+}
+
+
+/****************************************************************************/
+/*                                 Timing                                   */
+/****************************************************************************/
+
+static double
+now(void)
+{
+#ifdef _MSC_VER
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Timed and counted region. */
+static double region_time;
+static double region_start;
+
+static inline void
+start(void)
+{
+    live_start = live_bytes;
+    counting = true;
+    region_start = now();
+}
+
+static inline void
+stop(void)
+{
+    region_time += now() - region_start;
+    counting = false;
+}
+
+
+/****************************************************************************/
+/*                              Command line                                */
+/****************************************************************************/
+
+typedef struct {
+    int n;
+    char *items[MAX_ITEMS];
+} list_t;
+
+static void
+usage(void)
+{
+    fprintf(stderr,
+        "usage: xnd_bench [-o operations] [-t types] [-d dtypes] [-s shapes]\n"
+        "                 [-p pool_limit] [-m seconds] [-j]\n\n"
+        "  -o  comma separated operations (default: %s)\n"
+        "  -t  comma separated types (default: %s)\n"
+        "  -d  comma separated dtypes (default: %s)\n"
+        "  -s  comma separated shapes RxC (default: %s)\n"
+        "  -p  buffer pool limit in bytes, 0 disables the pool\n"
+        "  -m  minimum duration of a single sample (default: 0.01)\n"
+        "  -j  write JSON lines instead of CSV\n",
+        default_operations, default_types, default_dtypes, default_shapes);
+}
+
+/* Split a comma separated list in place. */
+static int
+split(list_t *lst, char *s)
+{
+    lst->n = 0;
+
+    while (*s != '\0') {
+        char *end = strchr(s, ',');
+        if (lst->n == MAX_ITEMS) {
+            fprintf(stderr, "xnd_bench: too many list items\n");
+            return -1;
+        }
+        lst->items[lst->n++] = s;
+        if (end == NULL) {
+            break;
+        }
+        *end = '\0';
+        s = end+1;
+    }
+
+    return 0;
+}
+
+static int
+lookup(const char *names[], int n, const char *s, const char *what)
+{
+    for (int i = 0; i < n; i++) {
+        if (strcmp(s, names[i]) == 0) {
+            return i;
+        }
+    }
+
+    fprintf(stderr, "xnd_bench: invalid %s: '%s'\n", what, s);
+    return -1;
+}
+
+static int
+parse_shape(int64_t *rows, int64_t *cols, const char *s)
+{
+    char *end;
+
+    *rows = strtoll(s, &end, 10);
+    if (*end != 'x' || *rows <= 0) {
+        goto error;
+    }
+
+    *cols = strtoll(end+1, &end, 10);
+    if (*end != '\0' || *cols <= 0) {
+        goto error;
+    }
+
+    return 0;
+
+error:
+    fprintf(stderr, "xnd_bench: invalid shape: '%s'\n", s);
+    return -1;
+}
+
+
+/****************************************************************************/
+/*                                  Types                                   */
+/****************************************************************************/
+
+static const ndt_t *
+var_type(const ndt_t *dtype, int64_t rows, int64_t cols, ndt_context_t *ctx)
+{
+    ndt_offsets_t *inner, *outer;
+    const ndt_t *t, *u;
+    int64_t sum = 0;
+    int32_t *v;
+
+    if (rows+1 > INT32_MAX || rows * 2 * cols > INT32_MAX) {
+        ndt_err_format(ctx, NDT_ValueError, "var dimension is too large");
+        return NULL;
+    }
+
+    inner = ndt_offsets_new((int32_t)(rows+1), ctx);
+    if (inner == NULL) {
+        return NULL;
+    }
+    v = (int32_t *)inner->v;
+    v[0] = 0;
+    for (int64_t i = 0; i < rows; i++) {
+        sum += 1 + (i * 31) % (2 * cols - 1);
+        v[i+1] = (int32_t)sum;
+    }
+
+    outer = ndt_offsets_new(2, ctx);
+    if (outer == NULL) {
+        ndt_decref_offsets(inner);
+        return NULL;
+    }
+    v = (int32_t *)outer->v;
+    v[0] = 0;
+    v[1] = (int32_t)rows;
+
+    t = ndt_var_dim(dtype, inner, 0, NULL, false, ctx);
+    ndt_decref_offsets(inner);
+    if (t == NULL) {
+        ndt_decref_offsets(outer);
+        return NULL;
+    }
+
+    u = ndt_var_dim(t, outer, 0, NULL, false, ctx);
+    ndt_decref_offsets(outer);
+    ndt_decref(t);
+
+    return u;
+}
+
+static const ndt_t *
+preset_type(enum preset preset, const char *dtype, int64_t rows, int64_t cols,
+            ndt_context_t *ctx)
+{
+    const ndt_t *t, *u;
+    char buf[512];
+
+    switch (preset) {
+    case TypeFixed:
+        snprintf(buf, sizeof buf, "%" PRIi64 " * %" PRIi64 " * %s",
+                 rows, cols, dtype);
+        return ndt_from_string(buf, ctx);
+    case TypeOptional:
+        snprintf(buf, sizeof buf, "%" PRIi64 " * %" PRIi64 " * ?%s",
+                 rows, cols, dtype);
+        return ndt_from_string(buf, ctx);
+    case TypeRecord:
+        snprintf(buf, sizeof buf,
+                 "%" PRIi64 " * %" PRIi64 " * {id: int64, name: string, "
+                 "value: %s, valid: ?%s, coords: 3 * float64, tag: ?string}",
+                 rows, cols, dtype, dtype);
+        return ndt_from_string(buf, ctx);
+    case TypeVar:
+        t = ndt_from_string(dtype, ctx);
+        if (t == NULL) {
+            return NULL;
+        }
+        u = var_type(t, rows, cols, ctx);
+        ndt_decref(t);
+        return u;
+    default:
+        ndt_err_format(ctx, NDT_RuntimeError, "invalid type preset");
+        return NULL;
+    }
+}
+
+/* Number of leaf values. */
+static int64_t
+count_items(const xnd_t *x, ndt_context_t *ctx)
+{
+    const ndt_t *t = x->type;
+    int64_t n = 0;
+
+    switch (t->tag) {
+    case FixedDim: {
+        if (t->FixedDim.shape == 0) {
+            return 0;
+        }
+        const xnd_t next = xnd_fixed_dim_next(x, 0);
+        return t->FixedDim.shape * count_items(&next, ctx);
+    }
+
+    case VarDim: {
+        int64_t start, step, shape;
+
+        shape = ndt_var_indices(&start, &step, t, x->index, ctx);
+        for (int64_t i = 0; i < shape; i++) {
+            const xnd_t next = xnd_var_dim_next(x, start, step, i);
+            n += count_items(&next, ctx);
+        }
+
+        return n;
+    }
+
+    case Tuple: case Record: {
+        const int64_t shape = t->tag == Tuple ? t->Tuple.shape : t->Record.shape;
+        for (int64_t i = 0; i < shape; i++) {
+            const xnd_t next = t->tag == Tuple ? xnd_tuple_next(x, i, ctx)
+                                               : xnd_record_next(x, i, ctx);
+            n += count_items(&next, ctx);
+        }
+
+        return n;
+    }
+
+    default:
+        return 1;
+    }
+}
+
+/*
+ * Initialize all values.  Optional values are valid, since xnd_equal() stops
+ * at the first NA.  Strings are short and distinct.
+ */
+static int
+fill(xnd_t *x, int64_t *k, ndt_context_t *ctx)
+{
+    const ndt_t *t = x->type;
+
+    if (ndt_is_optional(t)) {
+        xnd_set_valid(x);
+    }
+
+#define PACK(type, expr) \
+    do {                                        \
+        type _v = (type)(expr);                 \
+        memcpy(x->ptr, &_v, sizeof _v);         \
+    } while (0)
+
+    switch (t->tag) {
+    case FixedDim: {
+        for (int64_t i = 0; i < t->FixedDim.shape; i++) {
+            xnd_t next = xnd_fixed_dim_next(x, i);
+            if (fill(&next, k, ctx) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    case VarDim: {
+        int64_t start, step, shape;
+
+        shape = ndt_var_indices(&start, &step, t, x->index, ctx);
+        if (shape < 0) {
+            return -1;
+        }
+
+        for (int64_t i = 0; i < shape; i++) {
+            xnd_t next = xnd_var_dim_next(x, start, step, i);
+            if (fill(&next, k, ctx) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    case Tuple: case Record: {
+        const int64_t shape = t->tag == Tuple ? t->Tuple.shape : t->Record.shape;
+        for (int64_t i = 0; i < shape; i++) {
+            xnd_t next = t->tag == Tuple ? xnd_tuple_next(x, i, ctx)
+                                         : xnd_record_next(x, i, ctx);
+            if (next.ptr == NULL || fill(&next, k, ctx) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    case String: {
+        char buf[32];
+        char *s;
+
+        snprintf(buf, sizeof buf, "item-%" PRIi64, *k);
+        s = ndt_strdup(buf, ctx);
+        if (s == NULL) {
+            return -1;
+        }
+        ndt_free(XND_POINTER_DATA(x->ptr));
+        XND_POINTER_DATA(x->ptr) = s;
+        break;
+    }
+
+    case Bool: PACK(bool, *k % 2); break;
+    case Int8: PACK(int8_t, *k % 100); break;
+    case Int16: PACK(int16_t, *k % 10000); break;
+    case Int32: PACK(int32_t, *k); break;
+    case Int64: PACK(int64_t, *k); break;
+    case Uint8: PACK(uint8_t, *k % 100); break;
+    case Uint16: PACK(uint16_t, *k % 10000); break;
+    case Uint32: PACK(uint32_t, *k); break;
+    case Uint64: PACK(uint64_t, *k); break;
+    case Float32: PACK(float, 0.5 + (double)*k); break;
+    case Float64: PACK(double, 0.5 + (double)*k); break;
+
+    default:
+        break;
+    }
+
+#undef PACK
+
+    (*k)++;
+    return 0;
+}
+
+
+/****************************************************************************/
+/*                               Operations                                 */
+/****************************************************************************/
+
+typedef struct {
+    const ndt_t *type;
+    xnd_master_t *src;
+    xnd_master_t *dest;
+    xnd_index_t indices[2];
+    int nindices;
+    int64_t shape[NDT_MAX_DIM];
+    int ndim;
+} case_t;
+
+static int
+op_empty(case_t *c, enum operation op, int64_t iters, ndt_context_t *ctx)
+{
+    xnd_master_t *batch[BATCH];
+
+    for (int64_t k = 0; k < iters; k += BATCH) {
+        const int n = iters-k < BATCH ? (int)(iters-k) : BATCH;
+        int i;
+
+        if (op == OpEmpty) start();
+        for (i = 0; i < n; i++) {
+            batch[i] = xnd_empty_from_type(c->type, XND_OWN_EMBEDDED, ctx);
+            if (batch[i] == NULL) {
+                break;
+            }
+        }
+        if (op == OpEmpty) stop();
+
+        if (op == OpDel) start();
+        for (int j = 0; j < i; j++) {
+            xnd_del(batch[j]);
+        }
+        if (op == OpDel) stop();
+
+        if (i < n) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+op_copy(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    const uint32_t flags = c->dest->flags;
+
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        if (xnd_copy(&c->dest->master, &c->src->master, flags, ctx) < 0) {
+            stop();
+            return -1;
+        }
+    }
+    stop();
+
+    return 0;
+}
+
+static int
+op_equal(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        int ret = xnd_equal(&c->src->master, &c->dest->master, ctx);
+        if (ret <= 0) {
+            stop();
+            if (ret == 0) {
+                ndt_err_format(ctx, NDT_RuntimeError, "copy is not equal");
+            }
+            return -1;
+        }
+    }
+    stop();
+
+    return 0;
+}
+
+static int
+op_subscript(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        xnd_t x = xnd_subscript(&c->src->master, c->indices, c->nindices, ctx);
+        if (x.ptr == NULL) {
+            stop();
+            return -1;
+        }
+        ndt_decref(x.type);
+    }
+    stop();
+
+    return 0;
+}
+
+static int
+op_split(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        int64_t n = NPARTS;
+        xnd_t *parts = xnd_split(&c->src->master, &n, NDT_MAX_DIM, ctx);
+        if (parts == NULL) {
+            stop();
+            return -1;
+        }
+        for (int64_t i = 0; i < n; i++) {
+            ndt_decref(parts[i].type);
+        }
+        ndt_free(parts);
+    }
+    stop();
+
+    return 0;
+}
+
+static int
+op_reshape(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        xnd_t x = xnd_reshape(&c->src->master, c->shape, c->ndim, 'C', ctx);
+        if (x.ptr == NULL) {
+            stop();
+            return -1;
+        }
+        ndt_decref(x.type);
+    }
+    stop();
+
+    return 0;
+}
+
+static int
+op_bitmap(case_t *c, int64_t iters, ndt_context_t *ctx)
+{
+    start();
+    for (int64_t k = 0; k < iters; k++) {
+        xnd_bitmap_t b = xnd_bitmap_empty;
+        if (xnd_bitmap_init(&b, c->type, ctx) < 0) {
+            stop();
+            return -1;
+        }
+        xnd_bitmap_clear(&b);
+    }
+    stop();
+
+    return 0;
+}
+
+/* Run 'iters' operations and return the time spent in the timed region. */
+static double
+run(case_t *c, enum operation op, int64_t iters, ndt_context_t *ctx)
+{
+    int ret;
+
+    region_time = 0;
+
+    switch (op) {
+    case OpEmpty: case OpDel: ret = op_empty(c, op, iters, ctx); break;
+    case OpCopy: ret = op_copy(c, iters, ctx); break;
+    case OpEqual: ret = op_equal(c, iters, ctx); break;
+    case OpSubscript: ret = op_subscript(c, iters, ctx); break;
+    case OpSplit: ret = op_split(c, iters, ctx); break;
+    case OpReshape: ret = op_reshape(c, iters, ctx); break;
+    case OpBitmap: ret = op_bitmap(c, iters, ctx); break;
+    default:
+        ndt_err_format(ctx, NDT_RuntimeError, "invalid operation");
+        ret = -1;
+    }
+
+    return ret < 0 ? -1 : region_time;
+}
+
+/* Best time of a single operation. */
+static double
+measure(case_t *c, enum operation op, double min_time, ndt_context_t *ctx)
+{
+    int64_t iters = 1;
+    double t, best;
+
+    for (;;) {
+        t = run(c, op, iters, ctx);
+        if (t < 0) {
+            return -1;
+        }
+        if (t >= min_time || iters >= (INT64_C(1) << 40)) {
+            break;
+        }
+        iters = t <= 0 ? iters * 16 : (int64_t)(iters * (min_time / t) * 1.2) + 1;
+    }
+
+    best = t / (double)iters;
+    for (int i = 1; i < NSAMPLES; i++) {
+        t = run(c, op, iters, ctx);
+        if (t < 0) {
+            return -1;
+        }
+        t /= (double)iters;
+        if (t < best) {
+            best = t;
+        }
+    }
+
+    return best;
+}
+
+
+/****************************************************************************/
+/*                                Benchmark                                 */
+/****************************************************************************/
+
+typedef struct {
+    bool json;
+    double min_time;
+} options_t;
+
+static void
+print_record(const options_t *opts, enum operation op, enum preset preset,
+             const char *dtype, int64_t rows, int64_t cols, int64_t items,
+             int64_t datasize, double seconds, int64_t allocs, int64_t bytes,
+             int64_t peak)
+{
+    const int64_t rss = peak_rss();
+
+    if (opts->json) {
+        printf("{\"operation\": \"%s\", \"type\": \"%s\", \"dtype\": \"%s\", "
+               "\"shape\": \"%" PRIi64 "x%" PRIi64 "\", \"items\": %" PRIi64 ", "
+               "\"datasize\": %" PRIi64 ", \"seconds\": %.6e, "
+               "\"ops_per_sec\": %.6e, \"allocs\": %" PRIi64 ", "
+               "\"alloc_bytes\": %" PRIi64 ", \"peak_heap_bytes\": %" PRIi64 ", "
+               "\"peak_rss_bytes\": ",
+               operation_names[op], preset_names[preset], dtype, rows, cols,
+               items, datasize, seconds, 1.0 / seconds, allocs, bytes, peak);
+        if (rss < 0) {
+            printf("null}\n");
+        }
+        else {
+            printf("%" PRIi64 "}\n", rss);
+        }
+    }
+    else {
+        printf("%s,%s,%s,%" PRIi64 "x%" PRIi64 ",%" PRIi64 ",%" PRIi64 ","
+               "%.6e,%.6e,%" PRIi64 ",%" PRIi64 ",%" PRIi64 ",",
+               operation_names[op], preset_names[preset], dtype, rows, cols,
+               items, datasize, seconds, 1.0 / seconds, allocs, bytes, peak);
+        if (rss >= 0) {
+            printf("%" PRIi64, rss);
+        }
+        printf("\n");
+    }
+
+    fflush(stdout);
+}
+
+static void
+skip(enum operation op, enum preset preset, const char *dtype, int64_t rows,
+     int64_t cols, ndt_context_t *ctx)
+{
+    fprintf(stderr, "skip: %s,%s,%s,%" PRIi64 "x%" PRIi64 ": %s\n",
+            operation_names[op], preset_names[preset], dtype, rows, cols,
+            ndt_context_msg(ctx));
+    ndt_err_clear(ctx);
+}
+
+static void
+case_clear(case_t *c)
+{
+    if (c->dest != NULL) {
+        xnd_del(c->dest);
+    }
+    if (c->src != NULL) {
+        xnd_del(c->src);
+    }
+    ndt_decref(c->type);
+    memset(c, 0, sizeof *c);
+}
+
+static int
+case_init(case_t *c, enum preset preset, const char *dtype, int64_t rows,
+          int64_t cols, ndt_context_t *ctx)
+{
+    int64_t k = 0;
+
+    memset(c, 0, sizeof *c);
+
+    c->type = preset_type(preset, dtype, rows, cols, ctx);
+    if (c->type == NULL) {
+        return -1;
+    }
+    if (ndt_is_abstract(c->type)) {
+        ndt_err_format(ctx, NDT_ValueError, "type is not concrete");
+        goto error;
+    }
+
+    c->src = xnd_empty_from_type(c->type, XND_OWN_EMBEDDED, ctx);
+    if (c->src == NULL) {
+        goto error;
+    }
+    if (fill(&c->src->master, &k, ctx) < 0) {
+        goto error;
+    }
+
+    c->dest = xnd_empty_from_type(c->type, XND_OWN_EMBEDDED, ctx);
+    if (c->dest == NULL) {
+        goto error;
+    }
+    if (xnd_copy(&c->dest->master, &c->src->master, c->dest->flags, ctx) < 0) {
+        goto error;
+    }
+
+    /* x[1::2, 0] */
+    c->indices[0].tag = Slice;
+    c->indices[0].Slice.start = rows > 1 ? 1 : 0;
+    c->indices[0].Slice.stop = rows;
+    c->indices[0].Slice.step = 2;
+    c->indices[1].tag = Index;
+    c->indices[1].Index = 0;
+    c->nindices = 2;
+
+    /* Flatten the outer dimensions. */
+    c->shape[0] = rows * cols;
+    c->ndim = 1;
+
+    return 0;
+
+error:
+    case_clear(c);
+    return -1;
+}
+
+static int
+bench(const options_t *opts, const enum operation *ops, int nops,
+      enum preset preset, const char *dtype, int64_t rows, int64_t cols,
+      ndt_context_t *ctx)
+{
+    int64_t items;
+    case_t c;
+
+    if (case_init(&c, preset, dtype, rows, cols, ctx) < 0) {
+        skip(ops[0], preset, dtype, rows, cols, ctx);
+        return 0;
+    }
+
+    items = count_items(&c.src->master, ctx);
+
+    for (int i = 0; i < nops; i++) {
+        int64_t allocs, bytes, peak;
+        double t;
+
+        /* Allocation statistics of a single operation. */
+        stats_reset();
+        if (run(&c, ops[i], 1, ctx) < 0) {
+            skip(ops[i], preset, dtype, rows, cols, ctx);
+            continue;
+        }
+        allocs = nallocs;
+        bytes = alloc_bytes;
+        peak = peak_bytes;
+
+        t = measure(&c, ops[i], opts->min_time, ctx);
+        if (t < 0) {
+            skip(ops[i], preset, dtype, rows, cols, ctx);
+            continue;
+        }
+
+        print_record(opts, ops[i], preset, dtype, rows, cols, items,
+                     c.type->datasize, t, allocs, bytes, peak);
+    }
+
+    case_clear(&c);
+    return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    NDT_STATIC_CONTEXT(ctx);
+    const char *ops_arg = default_operations;
+    const char *types_arg = default_types;
+    const char *dtypes_arg = default_dtypes;
+    const char *shapes_arg = default_shapes;
+    char *ops_s = NULL, *types_s = NULL, *dtypes_s = NULL, *shapes_s = NULL;
+    list_t ops_l, types_l, dtypes, shapes_l;
+    enum operation ops[MAX_ITEMS];
+    enum preset presets[MAX_ITEMS];
+    int64_t rows[MAX_ITEMS], cols[MAX_ITEMS];
+    int64_t pool_limit = -1;
+    options_t opts = { false, 0.01 };
+    int ret = 1;
+
+    /* Must be set before the first allocation. */
+    ndt_mallocfunc = counting_malloc;
+    ndt_callocfunc = counting_calloc;
+    ndt_reallocfunc = counting_realloc;
+    ndt_freefunc = counting_free;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (strcmp(opt, "-j") == 0) {
+            opts.json = true;
+            continue;
+        }
+        if (strcmp(opt, "-h") == 0) {
+            usage();
+            return 0;
+        }
+        if (i+1 == argc) {
+            usage();
+            return 1;
+        }
+
+        if (strcmp(opt, "-o") == 0) ops_arg = argv[++i];
+        else if (strcmp(opt, "-t") == 0) types_arg = argv[++i];
+        else if (strcmp(opt, "-d") == 0) dtypes_arg = argv[++i];
+        else if (strcmp(opt, "-s") == 0) shapes_arg = argv[++i];
+        else if (strcmp(opt, "-p") == 0) {
+            char *end;
+            pool_limit = strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || pool_limit < 0) {
+                usage();
+                return 1;
+            }
+        }
+        else if (strcmp(opt, "-m") == 0) {
+            opts.min_time = strtod(argv[++i], NULL);
+            if (opts.min_time <= 0) {
+                usage();
+                return 1;
+            }
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ops_s = strdup(ops_arg);
+    types_s = strdup(types_arg);
+    dtypes_s = strdup(dtypes_arg);
+    shapes_s = strdup(shapes_arg);
+    if (!ops_s || !types_s || !dtypes_s || !shapes_s) {
+        fprintf(stderr, "xnd_bench: out of memory\n");
+        goto finish;
+    }
+
+    if (split(&ops_l, ops_s) < 0 || split(&types_l, types_s) < 0 ||
+        split(&dtypes, dtypes_s) < 0 || split(&shapes_l, shapes_s) < 0) {
+        goto finish;
+    }
+
+    for (int i = 0; i < ops_l.n; i++) {
+        int k = lookup(operation_names, NumOps, ops_l.items[i], "operation");
+        if (k < 0) {
+            goto finish;
+        }
+        ops[i] = (enum operation)k;
+    }
+
+    for (int i = 0; i < types_l.n; i++) {
+        int k = lookup(preset_names, NumPresets, types_l.items[i], "type");
+        if (k < 0) {
+            goto finish;
+        }
+        presets[i] = (enum preset)k;
+    }
+
+    for (int i = 0; i < shapes_l.n; i++) {
+        if (parse_shape(&rows[i], &cols[i], shapes_l.items[i]) < 0) {
+            goto finish;
+        }
+    }
+
+    if (ndt_init(&ctx) < 0 || xnd_init_float(&ctx) < 0) {
+        ndt_err_fprint(stderr, &ctx);
+        goto finish;
+    }
+
+    if (pool_limit >= 0 && xnd_pool_set_limit(pool_limit, &ctx) < 0) {
+        ndt_err_fprint(stderr, &ctx);
+        goto finish;
+    }
+
+    if (!opts.json) {
+        printf("operation,type,dtype,shape,items,datasize,seconds,ops_per_sec,"
+               "allocs,alloc_bytes,peak_heap_bytes,peak_rss_bytes\n");
+    }
+
+    for (int i = 0; i < types_l.n; i++)
+    for (int j = 0; j < dtypes.n; j++)
+    for (int k = 0; k < shapes_l.n; k++) {
+        if (ops_l.n > 0 &&
+            bench(&opts, ops, ops_l.n, presets[i], dtypes.items[j], rows[k],
+                  cols[k], &ctx) < 0) {
+            ndt_err_fprint(stderr, &ctx);
+            goto finish;
+        }
+    }
+
+    ret = 0;
+
+finish:
+    xnd_pool_clear();
+    ndt_finalize();
+    free(ops_s);
+    free(types_s);
+    free(dtypes_s);
+    free(shapes_s);
+    return ret;
+}
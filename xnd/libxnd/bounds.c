@@ -361,3 +361,110 @@ xnd_bounds_check(const ndt_t *t, const int64_t linear_index, const int64_t bufsi
 
     return _xnd_bounds_check(&x, bufsize, ctx);
 }
+
+
+/*****************************************************************************/
+/*                               Memory overlap                              */
+/*****************************************************************************/
+
+/* Byte range [*lo, *hi) spanned by an ndarray, 0 if the array is empty. */
+static int
+_ndarray_extent(char **lo, char **hi, const xnd_t *x)
+{
+    const ndt_t *t = x->type;
+    int64_t min = x->index;
+    int64_t max = x->index;
+    int64_t itemsize;
+
+    if (t->ndim == 0) {
+        *lo = x->ptr;
+        *hi = x->ptr + t->datasize;
+        return t->datasize > 0;
+    }
+
+    itemsize = t->Concrete.FixedDim.itemsize;
+
+    for (; t->ndim > 0; t = t->FixedDim.type) {
+        const int64_t shape = t->FixedDim.shape;
+        const int64_t span = (shape-1) * t->Concrete.FixedDim.step;
+
+        if (shape == 0) {
+            return 0;
+        }
+
+        if (span < 0) {
+            min += span;
+        }
+        else {
+            max += span;
+        }
+    }
+
+    *lo = x->ptr + min * itemsize;
+    *hi = x->ptr + (max+1) * itemsize;
+
+    return itemsize > 0;
+}
+
+/* Same start address, element size and strides in all non-trivial dimensions. */
+static bool
+_same_layout(const xnd_t *x, const xnd_t *y)
+{
+    const ndt_t *t = x->type;
+    const ndt_t *u = y->type;
+
+    if (t->ndim != u->ndim) {
+        return false;
+    }
+
+    if (t->ndim == 0) {
+        return x->ptr == y->ptr && t->datasize == u->datasize;
+    }
+
+    if (t->Concrete.FixedDim.itemsize != u->Concrete.FixedDim.itemsize ||
+        x->ptr + x->index * t->Concrete.FixedDim.itemsize !=
+        y->ptr + y->index * u->Concrete.FixedDim.itemsize) {
+        return false;
+    }
+
+    for (; t->ndim > 0; t = t->FixedDim.type, u = u->FixedDim.type) {
+        if (t->FixedDim.shape != u->FixedDim.shape) {
+            return false;
+        }
+        if (t->FixedDim.shape > 1 &&
+            t->Concrete.FixedDim.step != u->Concrete.FixedDim.step) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Determine whether the memory of 'x' and 'y' may overlap.  The test is
+ * conservative: XND_OVERLAP_NONE is exact, XND_OVERLAP_SAME means that both
+ * arguments address exactly the same elements in the same order, so that
+ * an elementwise kernel may safely write 'y' while reading 'x'.  For all
+ * other arguments, including non-ndarrays, XND_OVERLAP_MAYBE is returned.
+ */
+int
+xnd_overlap(const xnd_t *x, const xnd_t *y)
+{
+    char *xlo, *xhi, *ylo, *yhi;
+
+    if (ndt_is_abstract(x->type) || ndt_is_abstract(y->type) ||
+        !ndt_is_ndarray(x->type) || !ndt_is_ndarray(y->type) ||
+        !ndt_is_pointer_free(x->type) || !ndt_is_pointer_free(y->type)) {
+        return XND_OVERLAP_MAYBE;
+    }
+
+    if (!_ndarray_extent(&xlo, &xhi, x) || !_ndarray_extent(&ylo, &yhi, y)) {
+        return XND_OVERLAP_NONE;
+    }
+
+    if (xhi <= ylo || yhi <= xlo) {
+        return XND_OVERLAP_NONE;
+    }
+
+    return _same_layout(x, y) ? XND_OVERLAP_SAME : XND_OVERLAP_MAYBE;
+}
@@ -0,0 +1,240 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2024, plures
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from
+*    this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <ndtypes.h>
+#include <xnd.h>
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+/*****************************************************************************/
+/*                                Buffer pool                                */
+/*****************************************************************************/
+
+/*
+ * Size-class pool for master buffer data.  Block sizes are powers of two
+ * between 2**XND_POOL_MIN_SHIFT and 2**XND_POOL_MAX_SHIFT bytes.  Freed blocks
+ * are kept on a per-class stack as long as the total amount of cached memory
+ * stays below the pool limit.  Without pthreads the pool is disabled.
+ */
+
+#define XND_POOL_MIN_SHIFT 6
+#define XND_POOL_MAX_SHIFT 26
+#define XND_POOL_NCLASSES (XND_POOL_MAX_SHIFT-XND_POOL_MIN_SHIFT+1)
+#define XND_POOL_CLASS_DEPTH 16
+
+typedef struct {
+    int n;
+    char *blocks[XND_POOL_CLASS_DEPTH];
+} pool_class_t;
+
+static pool_class_t pool_classes[XND_POOL_NCLASSES];
+static int64_t pool_cached = 0;
+
+#ifdef HAVE_PTHREAD_H
+static int64_t pool_limit = XND_POOL_DEFAULT_LIMIT;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define POOL_LOCK() pthread_mutex_lock(&pool_mutex)
+#define POOL_UNLOCK() pthread_mutex_unlock(&pool_mutex)
+#else
+static int64_t pool_limit = 0;
+#define POOL_LOCK()
+#define POOL_UNLOCK()
+#endif
+
+
+/* Return the size class for 'size' or -1 if the size is not pooled. */
+static int
+pool_class(int64_t size)
+{
+    int shift = XND_POOL_MIN_SHIFT;
+
+    while (((int64_t)1 << shift) < size) {
+        if (++shift > XND_POOL_MAX_SHIFT) {
+            return -1;
+        }
+    }
+
+    return shift - XND_POOL_MIN_SHIFT;
+}
+
+static inline int64_t
+class_size(int c)
+{
+    return (int64_t)1 << (c + XND_POOL_MIN_SHIFT);
+}
+
+/*
+ * Return a block of at least 'size' bytes that can later be released with
+ * xnd_pool_free().  If 'zero' is false, the memory is not initialized.
+ * Return NULL if the request cannot be served from the pool.
+ */
+char *
+xnd_pool_alloc(uint16_t align, int64_t size, bool zero)
+{
+    const int c = pool_class(size);
+    char *ptr = NULL;
+    bool enabled;
+
+    if (align > XND_POOL_ALIGN || c < 0) {
+        return NULL;
+    }
+
+    POOL_LOCK();
+    enabled = pool_limit > 0;
+    if (enabled && pool_classes[c].n > 0) {
+        ptr = pool_classes[c].blocks[--pool_classes[c].n];
+        pool_cached -= class_size(c);
+    }
+    POOL_UNLOCK();
+
+    if (!enabled) {
+        return NULL;
+    }
+
+    if (ptr == NULL) {
+        ptr = zero ? ndt_aligned_calloc(XND_POOL_ALIGN, class_size(c))
+                   : ndt_aligned_alloc(XND_POOL_ALIGN, class_size(c));
+    }
+    else if (zero) {
+        memset(ptr, 0, (size_t)size);
+    }
+
+    return ptr;
+}
+
+/* Release a block that has been allocated with xnd_pool_alloc(). */
+void
+xnd_pool_free(char *ptr, int64_t size)
+{
+    const int c = pool_class(size);
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    assert(c >= 0);
+
+    POOL_LOCK();
+    if (pool_classes[c].n < XND_POOL_CLASS_DEPTH &&
+        pool_cached + class_size(c) <= pool_limit) {
+        pool_classes[c].blocks[pool_classes[c].n++] = ptr;
+        pool_cached += class_size(c);
+        ptr = NULL;
+    }
+    POOL_UNLOCK();
+
+    ndt_aligned_free(ptr);
+}
+
+/* Must be called with the pool lock held. */
+static void
+pool_clear(void)
+{
+    for (int c = 0; c < XND_POOL_NCLASSES; c++) {
+        while (pool_classes[c].n > 0) {
+            ndt_aligned_free(pool_classes[c].blocks[--pool_classes[c].n]);
+        }
+    }
+    pool_cached = 0;
+}
+
+/* Release all cached blocks. */
+void
+xnd_pool_clear(void)
+{
+    POOL_LOCK();
+    pool_clear();
+    POOL_UNLOCK();
+}
+
+int64_t
+xnd_pool_get_limit(void)
+{
+    int64_t limit;
+
+    POOL_LOCK();
+    limit = pool_limit;
+    POOL_UNLOCK();
+
+    return limit;
+}
+
+/* Set the maximum number of cached bytes.  A limit of 0 disables the pool. */
+int
+xnd_pool_set_limit(int64_t limit, ndt_context_t *ctx)
+{
+    if (limit < 0) {
+        ndt_err_format(ctx, NDT_ValueError,
+            "pool limit must be non-negative");
+        return -1;
+    }
+
+#ifndef HAVE_PTHREAD_H
+    if (limit > 0) {
+        ndt_err_format(ctx, NDT_NotImplementedError,
+            "the buffer pool requires pthreads");
+        return -1;
+    }
+#endif
+
+    POOL_LOCK();
+    pool_limit = limit;
+    if (pool_cached > limit) {
+        pool_clear();
+    }
+    POOL_UNLOCK();
+
+    return 0;
+}
+
+/* Number of bytes currently held by the pool. */
+int64_t
+xnd_pool_cached(void)
+{
+    int64_t n;
+
+    POOL_LOCK();
+    n = pool_cached;
+    POOL_UNLOCK();
+
+    return n;
+}
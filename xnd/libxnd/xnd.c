@@ -166,12 +166,21 @@ xnd_cuda_new(const ndt_t * const t, ndt_context_t *ctx)
 }
 #endif
 
+/*
+ * Allocate the data for a master buffer.  XND_NO_ZERO is only honored for
+ * pointer-free types and is always removed from 'flags'.  XND_POOL_DATA is
+ * removed if the pool cannot serve the request.
+ */
 static char *
-xnd_new(const ndt_t * const t, const uint32_t flags, ndt_context_t *ctx)
+xnd_new(const ndt_t * const t, uint32_t *flags, ndt_context_t *ctx)
 {
+    const bool zero = !(*flags & XND_NO_ZERO) || !ndt_is_pointer_free(t);
     xnd_t x;
 
-    if (flags & XND_CUDA_MANAGED) {
+    *flags &= ~XND_NO_ZERO;
+
+    if (*flags & XND_CUDA_MANAGED) {
+        *flags &= ~XND_POOL_DATA;
         return xnd_cuda_new(t, ctx);
     }
 
@@ -181,15 +190,31 @@ xnd_new(const ndt_t * const t, const uint32_t flags, ndt_context_t *ctx)
 
     x.index = 0;
     x.type = t;
+    x.ptr = NULL;
+
+    if (*flags & XND_POOL_DATA) {
+        x.ptr = xnd_pool_alloc(t->align, t->datasize, zero);
+        if (x.ptr == NULL) {
+            *flags &= ~XND_POOL_DATA;
+        }
+    }
 
-    x.ptr = ndt_aligned_calloc(t->align, t->datasize);
     if (x.ptr == NULL) {
-        ndt_memory_error(ctx);
-        return NULL;
+        x.ptr = zero ? ndt_aligned_calloc(t->align, t->datasize)
+                     : ndt_aligned_alloc(t->align, t->datasize);
+        if (x.ptr == NULL) {
+            ndt_memory_error(ctx);
+            return NULL;
+        }
     }
 
-    if (requires_init(t) && xnd_init(&x, flags, ctx) < 0) {
-        ndt_aligned_free(x.ptr);
+    if (requires_init(t) && xnd_init(&x, *flags, ctx) < 0) {
+        if (*flags & XND_POOL_DATA) {
+            xnd_pool_free(x.ptr, t->datasize);
+        }
+        else {
+            ndt_aligned_free(x.ptr);
+        }
         return NULL;
     }
 
@@ -425,7 +450,7 @@ xnd_empty_from_string(const char *s, uint32_t flags, ndt_context_t *ctx)
         return NULL;
     }
 
-    ptr = xnd_new(t, flags, ctx);
+    ptr = xnd_new(t, &flags, ctx);
     if (ptr == NULL) {
         xnd_bitmap_clear(&b);
         ndt_decref(t);
@@ -474,7 +499,7 @@ xnd_empty_from_type(const ndt_t *t, uint32_t flags, ndt_context_t *ctx)
         return NULL;
     }
 
-    ptr = xnd_new(t, flags, ctx);
+    ptr = xnd_new(t, &flags, ctx);
     if (ptr == NULL) {
         xnd_bitmap_clear(&b);
         ndt_free(x);
@@ -769,6 +794,9 @@ xnd_del_buffer(xnd_t *x, uint32_t flags)
                         "without cuda support\n");
                 #endif
                 }
+                else if (flags & XND_POOL_DATA) {
+                    xnd_pool_free(x->ptr, x->type->datasize);
+                }
                 else {
                     ndt_aligned_free(x->ptr);
                 }
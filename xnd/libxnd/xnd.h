@@ -92,6 +92,8 @@ extern "C" {
 #define XND_OWN_ARRAYS   0x00000010U /* embedded array pointers */
 #define XND_OWN_POINTERS 0x00000020U /* embedded pointers */
 #define XND_CUDA_MANAGED 0x00000040U /* cuda managed memory */
+#define XND_POOL_DATA    0x00000080U /* data is recycled through the buffer pool */
+#define XND_NO_ZERO      0x00000100U /* allocation only: skip zeroing the data */
 
 #define XND_OWN_ALL (XND_OWN_TYPE |    \
                      XND_OWN_DATA |    \
@@ -210,6 +212,32 @@ XND_API int xnd_bounds_check(const ndt_t *t, const int64_t linear_index,
                              const int64_t bufsize, ndt_context_t *ctx);
 
 
+/*****************************************************************************/
+/*                                Buffer pool                                */
+/*****************************************************************************/
+
+#define XND_POOL_ALIGN 64
+#define XND_POOL_DEFAULT_LIMIT ((int64_t)1 << 27)
+
+XND_API char *xnd_pool_alloc(uint16_t align, int64_t size, bool zero);
+XND_API void xnd_pool_free(char *ptr, int64_t size);
+XND_API void xnd_pool_clear(void);
+XND_API int64_t xnd_pool_cached(void);
+XND_API int64_t xnd_pool_get_limit(void);
+XND_API int xnd_pool_set_limit(int64_t limit, ndt_context_t *ctx);
+
+
+/*****************************************************************************/
+/*                               Memory overlap                              */
+/*****************************************************************************/
+
+#define XND_OVERLAP_NONE  0  /* disjoint memory */
+#define XND_OVERLAP_SAME  1  /* identical elements in identical order */
+#define XND_OVERLAP_MAYBE 2  /* partial or unknown overlap */
+
+XND_API int xnd_overlap(const xnd_t *x, const xnd_t *y);
+
+
 /*****************************************************************************/
 /*                                  Bitmaps                                  */
 /*****************************************************************************/